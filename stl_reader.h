@@ -122,17 +122,55 @@
  * If you do not want to use exceptions, you may define the macro
  * STL_READER_NO_EXCEPTIONS before including 'stl_reader.h'. In that case,
  * functions will return `false` if an error occurred.
+ *
+ * If compiled as C++11 or later, some mesh processing functions distribute
+ * their work to several threads. Define the macro STL_READER_NO_THREADS
+ * before including 'stl_reader.h' to disable this.
+ *
+ * To record a timeline of the phases of file reading and of the work items of
+ * parallel loops, define the macro STL_READER_TRACE before including
+ * 'stl_reader.h' (requires C++11) and install a `TraceSink`. Without the
+ * macro, no tracing code is compiled.
+ *
+ * A mesh can be written as a relocatable image with `StlMesh::write_image` and
+ * accessed without copying or parsing through `StlMeshView`. To share such an
+ * image between processes through POSIX shared memory or a memfd, define the
+ * macro STL_READER_SHARED_MEMORY before including 'stl_reader.h' (POSIX only)
+ * and use `PublishStlMeshImage_SHM`, `PublishStlMeshImage_MEMFD` and
+ * `SharedStlMeshImage`.
  */
 
 #ifndef __H__STL_READER
 #define __H__STL_READER
 
 #include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
 #include <exception>
 #include <fstream>
+#include <limits>
+#include <map>
 #include <sstream>
+#include <utility>
 #include <vector>
 
+#if !defined(STL_READER_NO_THREADS) && \
+    (__cplusplus >= 201103L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201103L))
+  /// Defined if stl_reader distributes work of mesh processing functions to several threads.
+  #define STL_READER_THREADS
+  #include <atomic>
+  #include <thread>
+#endif
+
+#ifdef STL_READER_SHARED_MEMORY
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
 #ifdef STL_READER_NO_EXCEPTIONS
   #define STL_READER_THROW(msg) return false;
   #define STL_READER_COND_THROW(cond, msg) if(cond) return false;
@@ -144,9 +182,199 @@
   #define STL_READER_COND_THROW(cond, msg)  if(cond){std::stringstream ss; ss << msg; throw(std::runtime_error(ss.str()));}
 #endif
 
+#ifdef STL_READER_TRACE
+  #if !(__cplusplus >= 201103L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201103L))
+    #error "STL_READER_TRACE requires C++11 or later"
+  #endif
+  #include <chrono>
+  #include <mutex>
+  #include <ostream>
+  #include <string>
+  #include <thread>
+
+namespace stl_reader {
+
+/// Collects timed events of stl_reader functions (only with STL_READER_TRACE)
+/** Install a sink with `SetTraceSink`. Afterwards, scoped events of file
+ * reading (open, detect, chunk read, parse, weld, reindex) and of each work
+ * item of parallel loops are recorded together with the thread which
+ * executed them. Use `write_chrome_trace` to write them in the Chrome trace
+ * event format, which can be inspected with Perfetto or chrome://tracing.
+ * Events may be recorded concurrently from several threads.
+ */
+class TraceSink {
+public:
+  TraceSink () : m_start (std::chrono::steady_clock::now()) {}
+
+  /// removes all events
+  void clear ()
+  {
+    std::lock_guard<std::mutex> lock (m_mutex);
+    m_events.clear();
+  }
+
+  /// returns the number of recorded events
+  size_t num_events () const
+  {
+    std::lock_guard<std::mutex> lock (m_mutex);
+    return m_events.size();
+  }
+
+  /// returns the summed duration in microseconds of all events named `name`
+  long long total_duration (const char* name) const
+  {
+    std::lock_guard<std::mutex> lock (m_mutex);
+    long long duration = 0;
+    for(size_t i = 0; i < m_events.size(); ++i){
+      if(strcmp (m_events[i].name, name) == 0)
+        duration += m_events[i].duration;
+    }
+    return duration;
+  }
+
+  /// records an event which started at `begin` and ended at `end`
+  void add_event (const char* name,
+                  const std::chrono::steady_clock::time_point begin,
+                  const std::chrono::steady_clock::time_point end)
+  {
+    using namespace std::chrono;
+    Event e;
+    e.name = name;
+    e.begin = duration_cast<microseconds> (begin - m_start).count();
+    e.duration = duration_cast<microseconds> (end - begin).count();
+
+    std::lock_guard<std::mutex> lock (m_mutex);
+    const std::thread::id id = std::this_thread::get_id();
+    e.thread = 0;
+    while(e.thread < m_threads.size() && m_threads[e.thread] != id)
+      ++e.thread;
+    if(e.thread == m_threads.size())
+      m_threads.push_back (id);
+    m_events.push_back (e);
+  }
+
+  /// writes all events as Chrome trace JSON
+  void write_chrome_trace (std::ostream& out) const
+  {
+    std::lock_guard<std::mutex> lock (m_mutex);
+    out << "{\"traceEvents\":[";
+    for(size_t i = 0; i < m_events.size(); ++i){
+      const Event& e = m_events[i];
+      out << (i == 0 ? "\n" : ",\n")
+          << "{\"name\":\"" << e.name << "\",\"cat\":\"stl_reader\",\"ph\":\"X\""
+          << ",\"ts\":" << e.begin << ",\"dur\":" << e.duration
+          << ",\"pid\":1,\"tid\":" << e.thread << "}";
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+  }
+
+  /// writes all events as Chrome trace JSON to the specified file
+  bool write_chrome_trace (const char* filename) const
+  {
+    std::ofstream out (filename);
+    STL_READER_COND_THROW (!out, "Couldn't open file " << filename);
+    write_chrome_trace (out);
+    return static_cast<bool> (out);
+  }
+
+private:
+  struct Event {
+    const char* name;
+    long long   begin;
+    long long   duration;
+    size_t      thread;
+  };
+
+  std::chrono::steady_clock::time_point m_start;
+  mutable std::mutex                    m_mutex;
+  std::vector<Event>                    m_events;
+  std::vector<std::thread::id>          m_threads;
+};
+
+namespace stl_reader_impl {
+  inline TraceSink*& ActiveTraceSink ()
+  {
+    static TraceSink* sink = NULL;
+    return sink;
+  }
+}// end of namespace stl_reader_impl
+
+/// installs the sink which receives trace events. Pass `NULL` to stop tracing.
+/** The sink has to outlive its use. It must not be changed while stl_reader
+ * functions are running.*/
+inline void SetTraceSink (TraceSink* sink)
+{
+  stl_reader_impl::ActiveTraceSink () = sink;
+}
+
+namespace stl_reader_impl {
+  // records an event spanning its lifetime or the time until 'end' is called
+  class TraceScope {
+  public:
+    explicit TraceScope (const char* name) :
+      m_name (name),
+      m_sink (ActiveTraceSink ())
+    {
+      if(m_sink)
+        m_begin = std::chrono::steady_clock::now();
+    }
+
+    ~TraceScope () {end();}
+
+    void end ()
+    {
+      if(m_sink)
+        m_sink->add_event (m_name, m_begin, std::chrono::steady_clock::now());
+      m_sink = NULL;
+    }
+
+  private:
+    const char*                           m_name;
+    TraceSink*                            m_sink;
+    std::chrono::steady_clock::time_point m_begin;
+  };
+}// end of namespace stl_reader_impl
+
+}// end of namespace stl_reader
+
+  #define STL_READER_TRACE_CONCAT2(a, b) a##b
+  #define STL_READER_TRACE_CONCAT(a, b) STL_READER_TRACE_CONCAT2(a, b)
+
+  /// Records a trace event for the enclosing scope.
+  #define STL_READER_TRACE_SCOPE(name) \
+    stl_reader::stl_reader_impl::TraceScope STL_READER_TRACE_CONCAT(stlReaderTraceScope, __LINE__) (name)
+  /// Starts a trace event which is ended by STL_READER_TRACE_END(var).
+  #define STL_READER_TRACE_BEGIN(var, name) \
+    stl_reader::stl_reader_impl::TraceScope var (name)
+  #define STL_READER_TRACE_END(var) var.end()
+#else
+  #define STL_READER_TRACE_SCOPE(name)
+  #define STL_READER_TRACE_BEGIN(var, name)
+  #define STL_READER_TRACE_END(var)
+#endif
+
 
 namespace stl_reader {
 
+/// Additional information gathered while reading a stl file
+struct StlReadInfo {
+  StlReadInfo () : peakScratchBytes (0), numTrisMissing (0), geometryHash (0) {}
+
+  /// the maximal number of bytes held by temporary arrays during the read
+  size_t peakScratchBytes;
+
+  /// number of triangles declared by a truncated binary file which were not
+  /// contained in the file. Only set by `RecoverStlFile_BINARY`.
+  size_t numTrisMissing;
+
+  /// order independent fingerprint of the triangles which were read.
+  /// Equals `ComputeGeometryHash` of the arrays written by the reader, for
+  /// `ReadStlFileRelative` of the welded coordinates before the origin is
+  /// subtracted.
+  unsigned long long geometryHash;
+};
+
+
 /// Reads an ASCII or binary stl file into several arrays
 /** Reads a stl file and writes its coordinates, normals and triangle-corner-indices
  * to the provided containers. It also fills a container solidRangesOut, which
@@ -186,6 +414,9 @@ namespace stl_reader {
  *                              The type TIndexContainer should have the same interface
  *                              as std::vector<size_t>.
  *
+ * \param infoOut [out] Optional. If not `NULL`, additional information about
+ *                      the read is written to it.
+ *
  * \returns true if the file was successfully read into the provided container.
  */
 template <class TNumberContainer1, class TNumberContainer2,
@@ -194,7 +425,8 @@ bool ReadStlFile(const char* filename,
                  TNumberContainer1& coordsOut,
                  TNumberContainer2& normalsOut,
                  TIndexContainer1& trisOut,
-                 TIndexContainer2& solidRangesOut);
+                 TIndexContainer2& solidRangesOut,
+                 StlReadInfo* infoOut = NULL);
 
 
 /// Reads an ASCII stl file into several arrays
@@ -207,7 +439,8 @@ bool ReadStlFile_ASCII(const char* filename,
                        TNumberContainer1& coordsOut,
                        TNumberContainer2& normalsOut,
                        TIndexContainer1& trisOut,
-                       TIndexContainer2& solidRangesOut);
+                       TIndexContainer2& solidRangesOut,
+                       StlReadInfo* infoOut = NULL);
 
 /// Reads a binary stl file into several arrays
 /** \copydetails ReadStlFile
@@ -220,7 +453,48 @@ bool ReadStlFile_BINARY(const char* filename,
                         TNumberContainer1& coordsOut,
                         TNumberContainer2& normalsOut,
                         TIndexContainer1& trisOut,
-                        TIndexContainer2& solidRangesOut);
+                        TIndexContainer2& solidRangesOut,
+                        StlReadInfo* infoOut = NULL);
+
+/// Reads the complete triangles of a possibly truncated binary stl file
+/** `ReadStlFile_BINARY` rejects files which hold less triangles than declared
+ * in their header. This function instead compares the declared number of
+ * triangles with the size of the file up front and reads all complete
+ * triangle records. The number of missing triangles is written to
+ * `infoOut->numTrisMissing`.
+ * \copydetails ReadStlFile
+ * \sa ReadStlFile_BINARY
+ */
+template <class TNumberContainer1, class TNumberContainer2,
+          class TIndexContainer1, class TIndexContainer2>
+bool RecoverStlFile_BINARY(const char* filename,
+                           TNumberContainer1& coordsOut,
+                           TNumberContainer2& normalsOut,
+                           TIndexContainer1& trisOut,
+                           TIndexContainer2& solidRangesOut,
+                           StlReadInfo* infoOut = NULL);
+
+/// Reads a stl file and stores coordinates relative to an origin
+/** Works like `ReadStlFile`, but coordinates of ASCII files are parsed and
+ * welded in double precision. The center of the bounding box of the welded
+ * vertices is written to `originOut` and `coordsOut` receives the offsets of
+ * all vertices from this origin. This preserves small details of meshes far
+ * away from the coordinate origin, e.g. georeferenced data, even if the
+ * offsets are stored as `float`. Binary files hold single precision
+ * coordinates, those are welded as usual and then offset as well.
+ *
+ * \param originOut  [out] Array of size 3, receives the origin.
+ * \sa ReadStlFile
+ */
+template <class TNumberContainer1, class TNumberContainer2,
+          class TIndexContainer1, class TIndexContainer2>
+bool ReadStlFileRelative(const char* filename,
+                         double* originOut,
+                         TNumberContainer1& coordsOut,
+                         TNumberContainer2& normalsOut,
+                         TIndexContainer1& trisOut,
+                         TIndexContainer2& solidRangesOut,
+                         StlReadInfo* infoOut = NULL);
 
 /// Determines whether a stl file has ASCII format
 /** The underlying mechanism is simply checks whether the provided file starts
@@ -230,516 +504,6189 @@ bool ReadStlFile_BINARY(const char* filename,
 inline bool StlFileHasASCIIFormat(const char* filename);
 
 
-/// convenience mesh class which makes accessing the stl data more easy
-template <class TNumber = float, class TIndex = unsigned int>
-class StlMesh {
-public:
-  /// initializes an empty mesh
-  StlMesh ()
-  {
-    solids.resize (2, 0);
-  }
+/// Makes the orientation of triangles consistent in each connected component
+/** Two triangles are considered adjacent if they share an edge which is not
+ * shared by any other triangle. Starting from one triangle, each component is
+ * traversed and neighboring triangles are flipped where required, so that
+ * shared edges are traversed in opposite directions by the two triangles.
+ * Afterwards each component is oriented such that as few triangles as possible
+ * change their orientation with respect to the input.
+ *
+ * A triangle is flipped by swapping its second and third corner. Its normal is
+ * negated.
+ *
+ * \param trisInOut     [in,out] Triangle corner indices of a mesh with removed
+ *                               double vertices, as written by `ReadStlFile`.
+ *
+ * \param normalsInOut  [in,out] Triangle normals, as written by `ReadStlFile`.
+ *
+ * \param numThreads  [in] Maximal number of threads used to orient components.
+ *                         If 0, the number of hardware threads is used.
+ *
+ * \returns the number of flipped triangles.
+ */
+template <class TNumberContainer, class TIndexContainer>
+size_t OrientTriangles (TIndexContainer& trisInOut,
+                        TNumberContainer& normalsInOut,
+                        unsigned int numThreads = 0);
 
-  /// initializes the mesh from the stl-file specified through filename
-  /** \{ */
-  StlMesh (const char* filename)
+
+/// Closes small holes of a mesh by inserting new triangles
+/** A hole is a closed loop of boundary edges, i.e., of edges which belong to
+ * exactly one triangle. Loops with at most `maxLoopSize` edges are
+ * triangulated. Loops which pass through a vertex with more than one outgoing
+ * boundary edge are ignored. So are the loops of connected components in
+ * which every triangle has a boundary edge, e.g. of isolated triangles or of
+ * small open patches, since those are no surfaces with holes.
+ *
+ * New triangles are oriented consistently with the triangles surrounding the
+ * hole and are appended to the end of the solid of the adjacent triangles.
+ * Their normals are computed from their corner coordinates.
+ *
+ * \param coords  [in] Coordinates as written by `ReadStlFile`.
+ *
+ * \param trisInOut, normalsInOut, solidRangesInOut  [in,out] Arrays as written
+ *                  by `ReadStlFile`. New triangles are inserted.
+ *
+ * \param maxLoopSize [in] The maximal number of edges of holes to be filled.
+ *
+ * \returns the number of filled holes.
+ */
+template <class TNumberContainer1, class TNumberContainer2,
+          class TIndexContainer1, class TIndexContainer2>
+size_t FillHoles (const TNumberContainer1& coords,
+                  TIndexContainer1& trisInOut,
+                  TNumberContainer2& normalsInOut,
+                  TIndexContainer2& solidRangesInOut,
+                  size_t maxLoopSize);
+
+
+/// Topological properties of a triangle mesh as determined by `ValidateMesh`
+struct MeshValidation {
+  MeshValidation () :
+    numBoundaryEdges (0),
+    numNonManifoldEdges (0),
+    numNonManifoldVrts (0),
+    numInconsistentEdges (0)
+  {}
+
+  /// number of edges which belong to exactly one triangle
+  size_t numBoundaryEdges;
+  /// number of edges which belong to more than two triangles
+  size_t numNonManifoldEdges;
+  /// number of vertices whose triangles do not form a single fan
+  size_t numNonManifoldVrts;
+  /// number of edges whose two triangles traverse them in the same direction
+  size_t numInconsistentEdges;
+
+  /// returns true if there are no boundary and no non-manifold edges
+  bool is_closed () const
   {
-    read_file (filename);
+    return numBoundaryEdges == 0 && numNonManifoldEdges == 0;
   }
 
-  StlMesh (const std::string& filename)
+  /// returns true if there are no non-manifold edges and vertices
+  bool is_manifold () const
   {
-    read_file (filename);
+    return numNonManifoldEdges == 0 && numNonManifoldVrts == 0;
   }
-  /** \} */
 
-  /// fills the mesh with the contents of the specified stl-file
-  /** \{ */
-  bool read_file (const char* filename)
+  /// returns true if the mesh is closed, manifold and consistently oriented
+  bool is_watertight () const
   {
-    bool res = false;
+    return is_closed () && is_manifold () && numInconsistentEdges == 0;
+  }
+};
 
-    #ifndef STL_READER_NO_EXCEPTIONS
-    try {
-    #endif
 
-    res = ReadStlFile (filename, coords, normals, tris, solids);
+/// Checks each solid of a mesh for boundaries, non-manifold elements and orientation
+/** Edges are identified through the corner indices of triangles, i.e., the
+ * mesh should have been welded, as done by `ReadStlFile`. Each solid is
+ * validated on its own, edges shared by different solids are not considered.
+ * Edges are sorted by a radix sort on their vertex indices, so that the
+ * validation of each solid runs in linear time. Solids are validated
+ * concurrently.
+ *
+ * \param tris         [in] Triangle corner indices as written by `ReadStlFile`.
+ * \param solidRanges  [in] Solid ranges as written by `ReadStlFile`.
+ * \param reportsOut   [out] Resized to the number of solids. Holds the
+ *                           validation results of each solid.
+ * \param numThreads   [in] Maximal number of threads. If 0, the number of
+ *                           hardware threads is used.
+ */
+template <class TIndexContainer1, class TIndexContainer2>
+void ValidateMesh (const TIndexContainer1& tris,
+                   const TIndexContainer2& solidRanges,
+                   std::vector <MeshValidation>& reportsOut,
+                   unsigned int numThreads = 0);
 
-    #ifndef STL_READER_NO_EXCEPTIONS
-    } catch (std::exception& e) {
-    #else
-    if (!res) {
-    #endif
 
-      coords.clear ();
-      normals.clear ();
-      tris.clear ();
-      solids.clear ();
-      STL_READER_THROW (e.what());
-    }
+/// Finds pairs of triangles which intersect each other
+/** Candidate pairs are determined with a bounding volume hierarchy over the
+ * triangles and checked with an exact triangle-triangle intersection test
+ * (Möller 1997), including coplanar triangles. Pairs of triangles which share
+ * a corner index, i.e., which share a welded vertex or edge, are skipped.
+ * Triangles are processed concurrently.
+ *
+ * \param coords  [in] Coordinates as written by `ReadStlFile`.
+ * \param tris    [in] Triangle corner indices as written by `ReadStlFile`.
+ * \param pairsOut  [out] Two entries for each pair of intersecting triangles
+ *                        `(i, j)` with `i < j`. Pairs are sorted.
+ * \param numThreads  [in] Maximal number of threads. If 0, the number of
+ *                         hardware threads is used.
+ */
+template <class TNumberContainer, class TIndexContainer1, class TIndexContainer2>
+void FindSelfIntersections (const TNumberContainer& coords,
+                            const TIndexContainer1& tris,
+                            TIndexContainer2& pairsOut,
+                            unsigned int numThreads = 0);
 
-    return res;
-  }
+/// A signed distance field sampled on a regular grid and stored in sparse blocks
+/** The grid consists of `num_samples(0) * num_samples(1) * num_samples(2)`
+ * samples, where sample `(i, j, k)` is located at `origin() + spacing() * (i, j, k)`.
+ * Distances are negative inside and positive outside of the mesh.
+ *
+ * Samples are grouped into blocks of `block_size()^3` samples. Only blocks
+ * which intersect the narrow band around the surface are allocated. Samples of
+ * other blocks evaluate to `+/- band_width()`. The same value is returned for
+ * allocated samples whose distance exceeds the band width.
+ *
+ * Use `compute` or `StlMesh::signed_distance_field` to fill the field.
+ */
+template <class TNumber = float>
+class SignedDistanceField {
+public:
+  /// side length of a block in samples
+  static size_t block_size ()  {return 8;}
 
-  bool read_file (const std::string& filename)
+  SignedDistanceField () :
+    m_spacing (1),
+    m_bandWidth (0)
   {
-    return read_file (filename.c_str());
+    for(size_t i = 0; i < 3; ++i){
+      m_origin[i] = 0;
+      m_numSamples[i] = 0;
+      m_numBlocks[i] = 0;
+    }
   }
+
+  /// computes the signed distance field of a closed triangle mesh
+  /** The grid covers the bounding box of the mesh, enlarged by the band width
+   * (if it is finite) plus one sample on each side.
+   *
+   * The distance of each sample is obtained through a closest point query in
+   * a bounding volume hierarchy. Its sign is the sign of the scalar product of
+   * the offset to the closest point with the angle weighted pseudonormal of
+   * the closest feature (face, edge or vertex), following Bærentzen and
+   * Aanæs, "Signed distance computation using the angle weighted pseudonormal",
+   * 2005. Signs are only meaningful for closed, consistently oriented meshes.
+   *
+   * Blocks are processed concurrently.
+   *
+   * \param coords, tris  [in] Arrays as written by `ReadStlFile`.
+   * \param spacing       [in] Distance between neighboring samples.
+   * \param bandWidth     [in] Only blocks containing samples closer than this to
+   *                           the surface are allocated. Pass
+   *                           `std::numeric_limits<double>::infinity()` for a dense
+   *                           field.
+   * \param numThreads    [in] Maximal number of threads. If 0, the number of
+   *                           hardware threads is used.
+   */
+  template <class TNumberContainer, class TIndexContainer>
+  void compute (const TNumberContainer& coords,
+                const TIndexContainer& tris,
+                const double spacing,
+                const double bandWidth,
+                const unsigned int numThreads = 0);
+
+  /// position of sample (0, 0, 0)
+  const double* origin () const {return m_origin;}
+
+  /// distance between neighboring samples
+  double spacing () const {return m_spacing;}
+
+  /// the width of the narrow band
+  double band_width () const {return m_bandWidth;}
+
+  /// number of samples in direction `dim`
+  size_t num_samples (const size_t dim) const {return m_numSamples[dim];}
+
+  /// returns the total number of blocks and the number of allocated blocks
+  /** \{ */
+  size_t num_blocks () const {return m_blockOffsets.size();}
+  size_t num_allocated_blocks () const {return m_values.size() / block_volume();}
   /** \} */
 
-  /// returns the number of vertices in the mesh
-  size_t num_vrts () const
+  /// returns the signed distance at sample (i, j, k)
+  TNumber value (const size_t i, const size_t j, const size_t k) const
   {
-    return coords.size() / 3;
+    const size_t bs = block_size();
+    const size_t block = ((k / bs) * m_numBlocks[1] + j / bs) * m_numBlocks[0] + i / bs;
+    if(m_blockOffsets[block] < 0)
+      return m_blockSigns[block] < 0 ? static_cast<TNumber> (-m_bandWidth)
+                                     : static_cast<TNumber> (m_bandWidth);
+    return m_values[m_blockOffsets[block] +
+                    ((k % bs) * bs + j % bs) * bs + i % bs];
   }
 
-  /// returns an array of 3 floating point values, one for each coordinate of the vertex
-  const TNumber* vrt_coords (const size_t vi) const
+  /// trilinearly interpolates the signed distance at the given position
+  /** Positions outside of the grid are clamped to the grid.*/
+  TNumber interpolate (const double x, const double y, const double z) const
   {
-    return &coords[vi * 3];
-  }
+    const double p[3] = {x, y, z};
+    size_t i0[3];
+    double t[3];
+    for(size_t d = 0; d < 3; ++d){
+      const double maxCoord = static_cast<double> (m_numSamples[d] - 1);
+      const double c = std::max (0., std::min (maxCoord, (p[d] - m_origin[d]) / m_spacing));
+      i0[d] = std::min (static_cast<size_t> (c), m_numSamples[d] > 1 ? m_numSamples[d] - 2 : 0);
+      t[d] = m_numSamples[d] > 1 ? c - static_cast<double> (i0[d]) : 0;
+    }
 
-  /// returns the number of triangles in the mesh
-  size_t num_tris () const
-  {
-    return tris.size() / 3;
+    double result = 0;
+    for(size_t corner = 0; corner < 8; ++corner){
+      double w = 1;
+      size_t ind[3];
+      for(size_t d = 0; d < 3; ++d){
+        const size_t o = (corner >> d) & 1;
+        w *= o ? t[d] : 1 - t[d];
+        ind[d] = std::min (i0[d] + o, m_numSamples[d] - 1);
+      }
+      if(w > 0)
+        result += w * static_cast<double> (value (ind[0], ind[1], ind[2]));
+    }
+    return static_cast<TNumber> (result);
   }
 
-  /// returns an array of 3 indices, one for each corner vertex of the triangle
-  const TIndex* tri_corner_inds (const size_t ti) const
+private:
+  size_t block_volume () const
   {
-    return &tris [ti * 3];
+    return block_size() * block_size() * block_size();
   }
 
-  /// returns the index of the corner with index `0<=ci<3` of triangle ti
-  const TIndex tri_corner_ind (const size_t ti, const size_t ci) const
-  {
-    return tris [ti * 3 + ci];
-  }
+  double  m_origin[3];
+  double  m_spacing;
+  double  m_bandWidth;
+  size_t  m_numSamples[3];
+  size_t  m_numBlocks[3];
+  std::vector <long long>   m_blockOffsets;
+  std::vector <signed char> m_blockSigns;
+  std::vector <TNumber>     m_values;
+};
 
-  /** \brief  returns an array of 3 floating point values, one for each
-   *          coordinate of the specified corner of the specified tri.
-   * \note  same result as calling on a `StlMesh mesh`:
-   *        \code
-   *          mesh.vrt_coords (mesh.tri_corner_ind (itri, icorner))
-   *        \endcode
-   */
-  const TNumber* tri_corner_coords (const size_t ti, const size_t ci) const
+/// Points on the surface of a mesh, stored as separate arrays per component
+template <class TNumber = float>
+struct SurfaceSamples {
+  /// coordinates of the sample positions
+  std::vector <TNumber> x, y, z;
+  /// components of the unit normals of the triangles containing the samples
+  std::vector <TNumber> nx, ny, nz;
+  /// indices of the triangles containing the samples
+  std::vector <size_t>  tris;
+
+  size_t size () const {return x.size();}
+
+  void resize (const size_t n)
   {
-    return &coords[tri_corner_ind(ti, ci) * 3];
+    x.resize (n); y.resize (n); z.resize (n);
+    nx.resize (n); ny.resize (n); nz.resize (n);
+    tris.resize (n);
   }
+};
 
-  /// returns an array of 3 floating point values defining the normal of a tri
-  const TNumber* tri_normal (const size_t ti) const
+
+/// Draws random points from the surface of a triangle mesh
+/** On construction, the cumulative distribution of triangle areas is computed.
+ * Triangles are then chosen with a probability proportional to their area and
+ * points are distributed uniformly inside each chosen triangle.
+ *
+ * Random numbers are obtained from a counter-based generator: sample `i` only
+ * depends on the seed and on `i`. Results are thus reproducible and do not
+ * depend on the number of threads used.
+ *
+ * The sampler keeps references to the given containers, which have to outlive it.
+ */
+template <class TNumberContainer, class TIndexContainer>
+class SurfaceSampler {
+public:
+  /// computes the area distribution of the given mesh
+  /** \param coords, tris  Arrays as written by `ReadStlFile`.*/
+  SurfaceSampler (const TNumberContainer& coords, const TIndexContainer& tris);
+
+  /// returns the total surface area of the mesh
+  double area () const {return m_areaCdf.empty() ? 0 : m_areaCdf.back();}
+
+  /// draws `numSamples` points, distributed uniformly by area
+  /** Samples are computed concurrently.
+   * \param numThreads  Maximal number of threads. If 0, the number of hardware
+   *                    threads is used.*/
+  template <class TNumber>
+  void sample (const size_t numSamples,
+               const unsigned long long seed,
+               SurfaceSamples <TNumber>& samplesOut,
+               const unsigned int numThreads = 0) const
   {
-    return &normals [ti * 3];
+    sample (0, numSamples, seed, samplesOut, numThreads);
   }
 
-  /// returns the number of solids of the mesh
-  /** solids can be seen as a partitioning of the triangles of a mesh.
-   * By iterating consecutively from the index of the first triangle of a
-   * solid `si` (using `solid_tris_begin(si)`) to the index of the last
-   * triangle of a solid (using `solid_tris_end(...)-1`), one visits all
-   * triangles of the solid `si`.*/
-  size_t num_solids () const
+  /// draws the samples `[first, first + count)` of the sequence defined by `seed`
+  /** The samples are written to `samplesOut`, which is resized to `count`.
+   * This allows to compute a large set of samples in independent parts.*/
+  template <class TNumber>
+  void sample (const size_t first,
+               const size_t count,
+               const unsigned long long seed,
+               SurfaceSamples <TNumber>& samplesOut,
+               const unsigned int numThreads = 0) const;
+
+  /// draws points such that no two points are closer than `radius`
+  /** Candidates are drawn as in `sample` and accepted in order if no previously
+   * accepted point lies within `radius` (dart throwing on a hashed grid). The
+   * number of candidates is chosen proportional to `area() / radius^2`, so that
+   * the surface is covered densely.*/
+  template <class TNumber>
+  void sample_poisson_disk (const double radius,
+                            const unsigned long long seed,
+                            SurfaceSamples <TNumber>& samplesOut) const;
+
+private:
+  const TNumberContainer* m_coords;
+  const TIndexContainer*  m_tris;
+  std::vector <double>    m_areaCdf;
+};
+
+/// Computes the convex hull of a set of points
+/** The hull is computed with the quickhull algorithm on the given coordinates.
+ * When used with the welded coordinates written by `ReadStlFile`, each vertex
+ * is considered only once. The initial classification of all points against
+ * the first tetrahedron, which discards most interior points, runs concurrently.
+ *
+ * The resulting arrays have the same layout as those written by `ReadStlFile`.
+ * Only coordinates of hull vertices are written to `hullCoordsOut`. All
+ * triangles are oriented outwards and form a single solid.
+ *
+ * \param coords  [in] Coordinates, each triple of entries forms a point.
+ * \param hullCoordsOut, hullNormalsOut, hullTrisOut, hullSolidsOut  [out] The
+ *                hull, in the format written by `ReadStlFile`.
+ * \param numThreads  [in] Maximal number of threads. If 0, the number of
+ *                         hardware threads is used.
+ *
+ * \returns true if a hull was constructed. If all points are coplanar, false
+ *          is returned and the output arrays are empty.
+ */
+template <class TNumberContainer1, class TNumberContainer2, class TNumberContainer3,
+          class TIndexContainer1, class TIndexContainer2>
+bool ConvexHull (const TNumberContainer1& coords,
+                 TNumberContainer2& hullCoordsOut,
+                 TNumberContainer3& hullNormalsOut,
+                 TIndexContainer1& hullTrisOut,
+                 TIndexContainer2& hullSolidsOut,
+                 unsigned int numThreads = 0);
+
+/// A box with arbitrary orientation
+struct OrientedBox {
+  /// center of the box
+  double center[3];
+  /// orthonormal, right handed axes of the box, sorted by decreasing extent
+  double axes[3][3];
+  /// half of the box size along each axis
+  double halfExtents[3];
+
+  double volume () const
   {
-    if(solids.empty ())
-      return 0;
-    return solids.size () - 1;
+    return 8 * halfExtents[0] * halfExtents[1] * halfExtents[2];
   }
+};
 
-  /// returns the index of the first triangle in the given solid
-  TIndex solid_tris_begin (const size_t si) const
+
+/// Computes a tight oriented bounding box of a set of points
+/** The convex hull of the points is computed first. The initial axes are the
+ * principal axes of the hull vertices, i.e. the eigenvectors of their
+ * covariance matrix. The box is then refined by rotating it around each of
+ * its axes such that the area of the projection of the hull onto the plane
+ * orthogonal to that axis becomes minimal (minimal area rectangle of the
+ * projected points). Refinement is repeated while the volume decreases.
+ *
+ * \param coords  [in] Coordinates, each triple of entries forms a point.
+ * \returns the oriented bounding box. For an empty point set all entries are 0.
+ */
+template <class TNumberContainer>
+OrientedBox ComputeOrientedBox (const TNumberContainer& coords);
+
+
+/// Computes an oriented bounding box for each solid of a mesh
+/** Each box encloses the vertices referenced by the triangles of the solid.
+ * Solids are processed concurrently.
+ * \param coords, tris, solidRanges  [in] Arrays as written by `ReadStlFile`.
+ * \param boxesOut  [out] Resized to the number of solids, holds one box per solid.
+ * \param numThreads  [in] Maximal number of threads. If 0, the number of
+ *                         hardware threads is used.
+ * \sa ComputeOrientedBox
+ */
+template <class TNumberContainer, class TIndexContainer1, class TIndexContainer2>
+void ComputeOrientedBoxes (const TNumberContainer& coords,
+                           const TIndexContainer1& tris,
+                           const TIndexContainer2& solidRanges,
+                           std::vector <OrientedBox>& boxesOut,
+                           unsigned int numThreads = 0);
+
+/// A uniform grid over the triangles of a mesh for box and ray queries
+/** Each cell stores the indices of all triangles whose bounding boxes overlap
+ * the cell. Cell lists are stored in a compressed format (offsets into one
+ * array of triangle indices) and are built in counting sort style: first the
+ * number of cells covered by each triangle is computed, then each triangle
+ * writes its (cell, triangle) entries at the offset obtained from a prefix
+ * sum. The entries are then ordered by cell in the same way: consecutive
+ * blocks of triangles count their entries per cell, and after a prefix sum
+ * over cells and blocks each block scatters its triangles. All passes except
+ * the prefix sums run concurrently, and triangles are sorted within each cell.
+ *
+ * The grid keeps references to the given containers, which have to outlive it.
+ */
+template <class TNumberContainer, class TIndexContainer>
+class TriangleGrid {
+public:
+  /// builds the grid
+  /** \param coords, tris  Arrays as written by `ReadStlFile`.
+   * \param cellSize    Edge length of the cubic cells. If 0, it is chosen such
+   *                    that the number of cells is about the number of triangles.
+   * \param numThreads  Maximal number of threads. If 0, the number of hardware
+   *                    threads is used.*/
+  TriangleGrid (const TNumberContainer& coords,
+                const TIndexContainer& tris,
+                double cellSize = 0,
+                unsigned int numThreads = 0);
+
+  /// edge length of the cells
+  double cell_size () const {return m_cellSize;}
+
+  /// number of cells in direction `dim`
+  size_t num_cells (const size_t dim) const {return m_numCells[dim];}
+
+  /// returns the range `[begin, end)` of triangles stored in cell (i, j, k)
+  const size_t* cell_tris_begin (const size_t i, const size_t j, const size_t k) const
   {
-    return solids [si];
+    return m_cellTris.empty() ? NULL : &m_cellTris[0] + m_cellOffsets[cell_index (i, j, k)];
   }
 
-  /// returns the index of the triangle behind the last triangle in the given solid
-  TIndex solid_tris_end (const size_t si) const
+  const size_t* cell_tris_end (const size_t i, const size_t j, const size_t k) const
   {
-    return solids [si + 1];
+    return m_cellTris.empty() ? NULL : &m_cellTris[0] + m_cellOffsets[cell_index (i, j, k) + 1];
   }
 
-  /// returns a pointer to the coordinate array, containing `num_vrts()*3` entries.
-  /** Storage layout: `x0,y0,z0,x1,y1,z1,...`
-   * \returns pointer to a contiguous array of numbers, or `NULL` if no coords exist.*/
-  const TNumber* raw_coords () const
+  /// writes the sorted indices of all triangles whose boxes overlap the box (lo, hi)
+  void query_box (const double* lo, const double* hi, std::vector <size_t>& trisOut) const;
+
+  /// finds the first triangle hit by a ray
+  /** Cells are traversed along the ray with a 3d DDA (Amanatides and Woo,
+   * 1987) and the triangles of each cell are tested with the Möller-Trumbore
+   * test. The traversal stops at the first cell which contains a hit.
+   *
+   * \param origin, dir  Origin and direction of the ray. `dir` must not be the
+   *                    zero vector, otherwise no hit is reported.
+   * \param tMax         Only hits with ray parameter `0 <= t <= tMax` are reported.
+   * \param triOut       The index of the hit triangle.
+   * \param tOut         The ray parameter of the hit, i.e. `origin + tOut * dir`
+   *                     is the hit point.
+   * \returns true if a triangle was hit.*/
+  bool intersect_ray (const double* origin, const double* dir, double tMax,
+                      size_t& triOut, double& tOut) const;
+
+private:
+  size_t cell_index (const size_t i, const size_t j, const size_t k) const
   {
-    if(coords.empty())
-      return NULL;
-    return &coords[0];
+    return (k * m_numCells[1] + j) * m_numCells[0] + i;
   }
 
-  /// returns a pointer to the normal array, containing `num_tris()*3` entries.
-  /** Storage layout: `nx0,ny0,nz0,nx1,ny1,nz1,...`
-   * \returns pointer to a contiguous array of numbers, or `NULL` if no normals exist.*/
-  const TNumber* raw_normals () const
+  // writes the range of cells overlapped by the box (lo, hi) to cellLo, cellHi
+  // (inclusive). Returns false if the box does not overlap the grid.
+  bool cell_range (const double* lo, const double* hi, size_t* cellLo, size_t* cellHi) const;
+
+  const TNumberContainer* m_coords;
+  const TIndexContainer*  m_tris;
+  double                  m_origin[3];
+  double                  m_cellSize;
+  size_t                  m_numCells[3];
+  std::vector <size_t>    m_cellOffsets;
+  std::vector <size_t>    m_cellTris;
+};
+
+/// Distances between the surfaces of two meshes A and B
+struct MeshDeviation {
+  /// largest distance of a point of A to the surface of B
+  double maxDistAB;
+  /// largest distance of a point of B to the surface of A
+  double maxDistBA;
+  /// mean distance of the surface of A to the surface of B
+  double meanDistAB;
+  /// mean distance of the surface of B to the surface of A
+  double meanDistBA;
+
+  /// the symmetric Hausdorff distance
+  double hausdorff () const {return std::max (maxDistAB, maxDistBA);}
+
+  /// the mean of both directed mean distances
+  double mean_dist () const {return 0.5 * (meanDistAB + meanDistBA);}
+};
+
+
+/// Computes Hausdorff and mean distances between two triangle meshes
+/** The surface of each mesh is sampled with `SurfaceSampler` and the distance
+ * of each sample and of each vertex to the other mesh is computed with closest
+ * point queries on a bounding volume hierarchy. The triangle found for the
+ * previous sample bounds the search for the next one, which prunes most of the
+ * hierarchy since samples are processed ordered by triangle. Queries run
+ * concurrently.
+ *
+ * Maximal distances are taken over samples and vertices. Mean distances are
+ * area weighted and are estimated from the samples only. Results are
+ * reproducible for a given number of samples. If one mesh has no triangles,
+ * distances towards it are infinite.
+ *
+ * \param coordsA, trisA  [in] Mesh A, arrays as written by `ReadStlFile`.
+ * \param coordsB, trisB  [in] Mesh B, arrays as written by `ReadStlFile`.
+ * \param numSamples      [in] Number of samples drawn on each mesh.
+ * \param vrtDeviationsOut [out] The distance of each vertex of A to the surface
+ *                        of B, e.g. for color mapping.
+ * \param numThreads      [in] Maximal number of threads. If 0, the number of
+ *                        hardware threads is used.
+ */
+template <class TNumberContainer1, class TIndexContainer1,
+          class TNumberContainer2, class TIndexContainer2,
+          class TDeviationContainer>
+MeshDeviation ComputeMeshDeviation (const TNumberContainer1& coordsA,
+                                    const TIndexContainer1& trisA,
+                                    const TNumberContainer2& coordsB,
+                                    const TIndexContainer2& trisB,
+                                    const size_t numSamples,
+                                    TDeviationContainer& vrtDeviationsOut,
+                                    unsigned int numThreads = 0);
+
+
+/// Copies a single solid of a mesh to separate arrays
+/** Only the vertices referenced by the triangles of the solid are copied. They
+ * keep their relative order and the corner indices of the triangles are
+ * remapped accordingly. The output arrays hold exactly one solid.
+ *
+ * \param coords, normals, tris, solids  [in] Arrays as written by `ReadStlFile`.
+ * \param solidIndex  [in] Index of the solid which shall be extracted.
+ * \param coordsOut, normalsOut, trisOut, solidsOut  [out] The extracted solid,
+ *                    in the format written by `ReadStlFile`.
+ * \returns true on success. Throws or returns false if `solidIndex` is invalid.
+ */
+template <class TNumberContainer1, class TNumberContainer2,
+          class TIndexContainer1, class TIndexContainer2>
+bool ExtractSolid (const TNumberContainer1& coords,
+                   const TNumberContainer2& normals,
+                   const TIndexContainer1& tris,
+                   const TIndexContainer2& solids,
+                   const size_t solidIndex,
+                   TNumberContainer1& coordsOut,
+                   TNumberContainer2& normalsOut,
+                   TIndexContainer1& trisOut,
+                   TIndexContainer2& solidsOut);
+
+
+/// Placement of a solid as a rigid transformation of a prototype solid
+/** A point `p` of the prototype is mapped to `rotation * p + translation`.*/
+struct SolidInstance {
+  /// index of the solid whose geometry is repeated
+  size_t prototype;
+  /// proper rotation matrix, i.e. orthonormal with determinant 1
+  double rotation[3][3];
+  double translation[3];
+
+  /// maps the point `p` of the prototype to `pOut`
+  void transform (const double* p, double* pOut) const
   {
-    if(normals.empty())
-      return NULL;
-    return &normals[0];
+    for(size_t i = 0; i < 3; ++i){
+      pOut[i] = rotation[i][0] * p[0] + rotation[i][1] * p[1]
+                + rotation[i][2] * p[2] + translation[i];
+    }
   }
+};
 
-  /// returns a pointer to the triangle array, containing `num_tris()*3` entries.
-  /** Storage layout: `t0c0,t0c1,t0c2,t1c0,t1c1,t1c2,...`
-   * \returns pointer to a contiguous array of indices, or `NULL` if no tris exist.*/
-  const TIndex* raw_tris () const
+
+/// Finds solids which are rigid transformations of other solids
+/** Assemblies often contain many copies of the same part as separate solids.
+ * For each solid, the unique vertices, their centroid and their principal
+ * axes (eigenvectors of the covariance matrix) are computed concurrently.
+ * Solids with equal numbers of vertices and triangles and with matching
+ * principal moments are candidates. Candidate rotations map the principal
+ * axes of one solid onto those of the other. If principal moments (nearly)
+ * coincide, e.g. for rotationally symmetric parts like bolts, the axes are not
+ * unique and frames spanned by the vertices farthest from the centroid are
+ * used instead. A candidate is accepted only if each vertex is mapped onto a
+ * vertex of the other solid within `tolerance` and each triangle onto a
+ * triangle with the same orientation. Mirrored copies are thus not instances.
+ *
+ * Solids are visited in order and compared to the prototypes found so far,
+ * i.e. the first solid of each group of congruent solids is its prototype.
+ *
+ * \param coords, tris, solidRanges  [in] Arrays as written by `ReadStlFile`.
+ * \param instancesOut  [out] Resized to the number of solids. Entry `i` holds
+ *                      the prototype of solid `i` and the transformation which
+ *                      maps the prototype onto solid `i`. Prototypes refer to
+ *                      themselves with the identity transformation.
+ * \param tolerance  [in] Maximal deviation of mapped vertices in each direction.
+ *                   If 0, 1.e-5 times the largest absolute coordinate of the
+ *                   compared solids is used, which covers the rounding of
+ *                   transformed `float` coordinates.
+ * \param numThreads  [in] Maximal number of threads. If 0, the number of
+ *                         hardware threads is used.
+ * \returns the number of prototypes, i.e. of geometrically distinct solids.
+ */
+template <class TNumberContainer, class TIndexContainer1, class TIndexContainer2>
+size_t FindSolidInstances (const TNumberContainer& coords,
+                           const TIndexContainer1& tris,
+                           const TIndexContainer2& solidRanges,
+                           std::vector <SolidInstance>& instancesOut,
+                           const double tolerance = 0,
+                           unsigned int numThreads = 0);
+
+
+/// Parameters of `RenderThumbnail`
+struct ThumbnailOptions {
+  /// size of the image in pixels
+  size_t width, height;
+  /// direction in which the camera looks
+  double viewDir[3];
+  /// direction which appears upwards in the image
+  double up[3];
+  /// fraction of the width and height which is left empty on each side
+  double margin;
+  /// RGB colors of the mesh and of the background
+  unsigned char color[3], background[3];
+  /// side length of the square tiles in pixels, which are rendered concurrently
+  size_t tileSize;
+
+  ThumbnailOptions () :
+    width (128),
+    height (128),
+    margin (0.05),
+    tileSize (32)
   {
-    if(tris.empty())
-      return NULL;
-    return &tris[0];
+    viewDir[0] = -1; viewDir[1] = -1; viewDir[2] = -1;
+    up[0] = 0; up[1] = 0; up[2] = 1;
+    color[0] = 170; color[1] = 180; color[2] = 200;
+    background[0] = background[1] = background[2] = 255;
   }
+};
 
-  /// returns a pointer to the solids array, containing `num_solids()+1` entries.
-  /** Storage layout: `s0begin, s0end/s1begin, s1end/s2begin, ..., sNend`
-   * \returns pointer to a contiguous array of indices, or `NULL` if no solids exist.*/
-  const TIndex* raw_solids () const
+
+/// Depth, normal and color images of a mesh, as rendered by `RenderThumbnail`
+/** All images are stored row by row, starting with the top row.*/
+struct Thumbnail {
+  size_t width, height;
+  /// per pixel depth in [0, 1] from the nearest to the farthest vertex of the
+  /// mesh. Infinity where no triangle is visible.
+  std::vector <float> depth;
+  /// per pixel unit normal in view coordinates, i.e. x to the right, y upwards
+  /// and z towards the camera. Zero where no triangle is visible.
+  std::vector <float> normals;
+  /// per pixel RGB color
+  std::vector <unsigned char> rgb;
+
+  Thumbnail () : width (0), height (0) {}
+
+  /// returns true if a triangle is visible at pixel (x, y)
+  bool covered (const size_t x, const size_t y) const
   {
-    if(solids.empty())
-      return NULL;
-    return &solids[0];
+    return depth[y * width + x] <= 1;
   }
+};
 
-private:
-  std::vector<TNumber>  coords;
-  std::vector<TNumber>  normals;
-  std::vector<TIndex>   tris;
-  std::vector<TIndex>   solids;
+
+/// Renders a small shaded image of a triangle mesh on the CPU
+/** The mesh is projected orthographically along `options.viewDir` and scaled
+ * such that the projection of its vertices fills the image, apart from the margin.
+ *
+ * Vertices are projected concurrently. The triangles are then binned into
+ * square tiles of `options.tileSize` pixels in counting sort style: the
+ * number of tiles overlapped by each triangle is counted, offsets are obtained
+ * from a prefix sum and each triangle writes its entries. Tiles are finally
+ * rasterized concurrently, each with its own depth buffer, so that no
+ * synchronization between threads is required. Within a tile, the edge
+ * functions of a triangle are stepped incrementally along each row of pixels.
+ *
+ * Triangles are not culled by their orientation, since the orientation of
+ * triangles in stl files is often inconsistent. Pixels are shaded with the
+ * geometric normal of the visible triangle, turned towards the camera, and a
+ * light from the upper left. If triangles have the same depth at a pixel, the
+ * triangle with the smaller index is visible, i.e. the images do not depend on
+ * the number of threads.
+ *
+ * \param coords, tris  [in] Arrays as written by `ReadStlFile`.
+ * \param options  [in] Image size, camera and colors.
+ * \param thumbnailOut  [out] The rendered images.
+ * \param numThreads  [in] Maximal number of threads. If 0, the number of
+ *                         hardware threads is used.
+ */
+template <class TNumberContainer, class TIndexContainer>
+void RenderThumbnail (const TNumberContainer& coords,
+                      const TIndexContainer& tris,
+                      const ThumbnailOptions& options,
+                      Thumbnail& thumbnailOut,
+                      unsigned int numThreads = 0);
+
+
+/// Number of bytes used by the arrays of a `StlMesh`
+/** For each array, `...Size` counts the bytes of the stored entries and
+ * `...Capacity` the bytes which are actually allocated.*/
+struct MeshMemoryUsage {
+  size_t coordsSize, coordsCapacity;
+  size_t normalsSize, normalsCapacity;
+  size_t trisSize, trisCapacity;
+  size_t solidsSize, solidsCapacity;
+  /// maximal number of bytes of temporary arrays used while reading the mesh
+  size_t peakLoadScratch;
+
+  /// bytes of all stored entries
+  size_t size () const
+  {
+    return coordsSize + normalsSize + trisSize + solidsSize;
+  }
+
+  /// bytes allocated by all arrays
+  size_t capacity () const
+  {
+    return coordsCapacity + normalsCapacity + trisCapacity + solidsCapacity;
+  }
 };
 
+/// Header of a relocatable mesh image as written by `StlMesh::write_image`
+/** A mesh image is a single contiguous block of memory which holds this
+ * header followed by the coordinate, normal, triangle and solid arrays of a
+ * mesh. The arrays are referenced by byte offsets from the beginning of the
+ * image. An image can thus be copied, stored or mapped into shared memory at
+ * any address aligned to `ALIGNMENT` bytes and accessed through `StlMeshView`
+ * without copying or parsing.
+ */
+struct StlMeshImageHeader {
+  enum {ALIGNMENT = 16, VERSION = 1, BYTE_ORDER_MARK = 0x01020304};
 
-////////////////////////////////////////////////////////////////////////////////
-//  IMPLEMENTATION
-////////////////////////////////////////////////////////////////////////////////
+  /// "STLMESH", null terminated
+  char                magic[8];
+  unsigned int        version;
+  /// `BYTE_ORDER_MARK` in the byte order of the writer
+  unsigned int        byteOrderMark;
+  /// `sizeof(TNumber)` of the mesh which wrote the image
+  unsigned int        numberSize;
+  /// `sizeof(TIndex)` of the mesh which wrote the image
+  unsigned int        indexSize;
+  /// size of the image in bytes, including this header
+  unsigned long long  imageSize;
+  /// number of entries of the arrays
+  unsigned long long  coordsLength, normalsLength, trisLength, solidsLength;
+  /// byte offsets of the arrays from the beginning of the image
+  unsigned long long  coordsOffset, normalsOffset, trisOffset, solidsOffset;
+  /// origin of the mesh coordinates, see `StlMesh::origin`
+  double              origin[3];
+};
+
+/// Computes an order independent fingerprint of the geometry of a mesh
+/** The hash depends only on the set of triangles, given by the coordinates of
+ * their corners. It does not depend on the order of triangles, on which corner
+ * of a triangle is listed first, on vertex indices, normals, solids or on
+ * anything else stored in a file, e.g. its header or solid names. It does
+ * depend on the orientation of triangles. Coordinates are compared exactly,
+ * after conversion to double.
+ *
+ * Each triangle is hashed separately and the hashes are combined by addition,
+ * so that equal parts can be found through their hashes without comparing
+ * meshes pairwise. The readers compute the hash on the fly and write it to
+ * `StlReadInfo::geometryHash`.
+ *
+ * \param coords  [in] Coordinates as written by `ReadStlFile`.
+ * \param tris    [in] Triangle corner indices as written by `ReadStlFile`.
+ */
+template <class TNumberContainer, class TIndexContainer>
+unsigned long long ComputeGeometryHash (const TNumberContainer& coords,
+                                        const TIndexContainer& tris);
+
+/// convenience mesh class which makes accessing the stl data more easy
+template <class TNumber = float, class TIndex = unsigned int>
+class StlMesh {
+public:
+  /// initializes an empty mesh
+  StlMesh ()
+  {
+    solids.resize (2, 0);
+    originCoords[0] = originCoords[1] = originCoords[2] = 0;
+  }
+
+  /// initializes the mesh from the stl-file specified through filename
+  /** \{ */
+  StlMesh (const char* filename)
+  {
+    read_file (filename);
+  }
+
+  StlMesh (const std::string& filename)
+  {
+    read_file (filename);
+  }
+  /** \} */
+
+  /// initializes the mesh by adopting the storage of the given arrays
+  /** The arrays are expected in the format written by `ReadStlFile`. Their
+   * contents are swapped into the mesh without copying, the given arrays are
+   * left empty. If `solidsInOut` is empty, all triangles form a single solid.*/
+  StlMesh (std::vector<TNumber>& coordsInOut,
+           std::vector<TNumber>& normalsInOut,
+           std::vector<TIndex>& trisInOut,
+           std::vector<TIndex>& solidsInOut)
+  {
+    coords.swap (coordsInOut);
+    normals.swap (normalsInOut);
+    tris.swap (trisInOut);
+    solids.swap (solidsInOut);
+    if(solids.empty()){
+      solids.push_back (0);
+      solids.push_back (static_cast<TIndex> (num_tris()));
+    }
+    originCoords[0] = originCoords[1] = originCoords[2] = 0;
+  }
+
+  /// exchanges the contents of this mesh with the contents of `other`
+  void swap (StlMesh& other)
+  {
+    coords.swap (other.coords);
+    normals.swap (other.normals);
+    tris.swap (other.tris);
+    solids.swap (other.solids);
+    std::swap (readInfo, other.readInfo);
+    for(size_t i = 0; i < 3; ++i)
+      std::swap (originCoords[i], other.originCoords[i]);
+  }
+
+  /// moves the arrays of this mesh to the given arrays without copying
+  /** The previous contents of the given arrays are discarded. The mesh is
+   * left empty, as if it was default constructed.*/
+  void release (std::vector<TNumber>& coordsOut,
+                std::vector<TNumber>& normalsOut,
+                std::vector<TIndex>& trisOut,
+                std::vector<TIndex>& solidsOut)
+  {
+    StlMesh empty;
+    take_coords (coordsOut);
+    take_normals (normalsOut);
+    take_tris (trisOut);
+    take_solids (solidsOut);
+    swap (empty);
+  }
+
+  /// moves a single array of this mesh to `arrayOut` without copying
+  /** The previous contents of `arrayOut` are discarded and the corresponding
+   * array of the mesh is left empty. Note that the mesh is only consistent
+   * again once all arrays were taken or after `release` or `read_file`.
+   * \{ */
+  void take_coords (std::vector<TNumber>& arrayOut)   {take (coords, arrayOut);}
+  void take_normals (std::vector<TNumber>& arrayOut)  {take (normals, arrayOut);}
+  void take_tris (std::vector<TIndex>& arrayOut)      {take (tris, arrayOut);}
+  void take_solids (std::vector<TIndex>& arrayOut)    {take (solids, arrayOut);}
+  /** \} */
+
+  /// fills the mesh with the contents of the specified stl-file
+  /** \{ */
+  bool read_file (const char* filename)
+  {
+    return read (filename, READ_DEFAULT);
+  }
+
+  bool read_file (const std::string& filename)
+  {
+    return read_file (filename.c_str());
+  }
+  /** \} */
+
+  /// fills the mesh with the contents of the specified stl-file, relative to an origin
+  /** Coordinates of ASCII files are welded in double precision and stored as
+   * offsets from `origin()`. Use this for meshes far away from the coordinate
+   * origin if `TNumber` is `float`.
+   * \sa ReadStlFileRelative
+   * \{ */
+  bool read_file_relative (const char* filename)
+  {
+    return read (filename, READ_RELATIVE);
+  }
+
+  bool read_file_relative (const std::string& filename)
+  {
+    return read_file_relative (filename.c_str());
+  }
+  /** \} */
+
+  /// fills the mesh with the complete triangles of a possibly truncated binary stl-file
+  /** The number of missing triangles is available through
+   * `read_info().numTrisMissing`.
+   * \sa RecoverStlFile_BINARY
+   * \{ */
+  bool recover_file (const char* filename)
+  {
+    return read (filename, READ_RECOVER);
+  }
+
+  bool recover_file (const std::string& filename)
+  {
+    return recover_file (filename.c_str());
+  }
+  /** \} */
+
+  /// returns the origin of the coordinates of this mesh
+  /** The actual position of a vertex is its coordinates plus this origin.
+   * The origin is only different from (0, 0, 0) after `read_file_relative`.*/
+  const double* origin () const
+  {
+    return originCoords;
+  }
+
+  /// makes triangle orientation consistent and closes small holes
+  /** Calls `OrientTriangles` followed by `FillHoles` on the arrays of this mesh.
+   * \param maxHoleSize  holes with at most this number of boundary edges are
+   *                     closed. Pass 0 to only fix orientation.
+   * \param numThreads   maximal number of threads. If 0, the number of hardware
+   *                     threads is used.*/
+  void repair (const size_t maxHoleSize = 8, const unsigned int numThreads = 0)
+  {
+    OrientTriangles (tris, normals, numThreads);
+    if (maxHoleSize > 0)
+      FillHoles (coords, tris, normals, solids, maxHoleSize);
+  }
+
+  /// returns the results of `ValidateMesh` for each solid of the mesh
+  std::vector <MeshValidation> validate (const unsigned int numThreads = 0) const
+  {
+    std::vector <MeshValidation> reports;
+    ValidateMesh (tris, solids, reports, numThreads);
+    return reports;
+  }
+
+  /// writes pairs of intersecting triangles to pairsOut
+  /** \sa FindSelfIntersections*/
+  void self_intersections (std::vector <TIndex>& pairsOut,
+                           const unsigned int numThreads = 0) const
+  {
+    FindSelfIntersections (coords, tris, pairsOut, numThreads);
+  }
+
+  /// computes a signed distance field of the mesh
+  /** \sa SignedDistanceField::compute*/
+  template <class TSdfNumber>
+  void signed_distance_field (SignedDistanceField <TSdfNumber>& sdfOut,
+                              const double spacing,
+                              const double bandWidth,
+                              const unsigned int numThreads = 0) const
+  {
+    sdfOut.compute (coords, tris, spacing, bandWidth, numThreads);
+  }
+
+  /// returns a sampler for random points on the surface of the mesh
+  /** The sampler refers to the arrays of this mesh, which has to outlive it.
+   * \sa SurfaceSampler*/
+  SurfaceSampler <std::vector <TNumber>, std::vector <TIndex> > surface_sampler () const
+  {
+    return SurfaceSampler <std::vector <TNumber>, std::vector <TIndex> > (coords, tris);
+  }
+
+  /// returns the convex hull of the vertices of this mesh
+  /** If all vertices are coplanar, the returned mesh is empty.
+   * \sa ConvexHull*/
+  StlMesh convex_hull (const unsigned int numThreads = 0) const
+  {
+    StlMesh hull;
+    ConvexHull (coords, hull.coords, hull.normals, hull.tris, hull.solids, numThreads);
+    std::copy (originCoords, originCoords + 3, hull.originCoords);
+    return hull;
+  }
+
+  /// returns an oriented bounding box of all vertices of the mesh
+  /** \sa ComputeOrientedBox*/
+  OrientedBox oriented_box () const
+  {
+    return ComputeOrientedBox (coords);
+  }
+
+  /// returns an oriented bounding box for each solid of the mesh
+  /** \sa ComputeOrientedBoxes*/
+  std::vector <OrientedBox> solid_oriented_boxes (const unsigned int numThreads = 0) const
+  {
+    std::vector <OrientedBox> boxes;
+    ComputeOrientedBoxes (coords, tris, solids, boxes, numThreads);
+    return boxes;
+  }
+
+  /// returns a uniform grid over the triangles of this mesh
+  /** The grid refers to the arrays of this mesh, which has to outlive it.
+   * \sa TriangleGrid*/
+  TriangleGrid <std::vector <TNumber>, std::vector <TIndex> >
+  triangle_grid (const double cellSize = 0, const unsigned int numThreads = 0) const
+  {
+    return TriangleGrid <std::vector <TNumber>, std::vector <TIndex> > (coords, tris, cellSize, numThreads);
+  }
+
+  /// computes distances between the surfaces of this mesh (A) and `other` (B)
+  /** \sa ComputeMeshDeviation*/
+  MeshDeviation deviation (const StlMesh& other,
+                           const size_t numSamples,
+                           std::vector <double>& vrtDeviationsOut,
+                           const unsigned int numThreads = 0) const
+  {
+    return ComputeMeshDeviation (coords, tris, other.coords, other.tris, numSamples,
+                                 vrtDeviationsOut, numThreads);
+  }
+
+  /// writes a compact copy of the solid `si` to `meshOut`
+  /** \sa ExtractSolid*/
+  bool extract_solid (const size_t si, StlMesh& meshOut) const
+  {
+    std::copy (originCoords, originCoords + 3, meshOut.originCoords);
+    return ExtractSolid (coords, normals, tris, solids, si,
+                         meshOut.coords, meshOut.normals, meshOut.tris, meshOut.solids);
+  }
+
+  /// returns a compact copy of the solid `si`
+  /** \sa ExtractSolid*/
+  StlMesh extract_solid (const size_t si) const
+  {
+    StlMesh mesh;
+    extract_solid (si, mesh);
+    return mesh;
+  }
+
+  /// returns a compact copy of each solid of the mesh
+  /** Solids are extracted concurrently.
+   * \param numThreads  Maximal number of threads. If 0, the number of hardware
+   *                    threads is used.
+   * \sa ExtractSolid*/
+  std::vector <StlMesh> split_solids (const unsigned int numThreads = 0) const;
+
+  /// finds solids which are rigid transformations of other solids
+  /** \sa FindSolidInstances*/
+  std::vector <SolidInstance> solid_instances (const double tolerance = 0,
+                                               const unsigned int numThreads = 0) const
+  {
+    std::vector <SolidInstance> instances;
+    FindSolidInstances (coords, tris, solids, instances, tolerance, numThreads);
+    return instances;
+  }
+
+  /// stores the geometry of congruent solids only once
+  /** `prototypesOut` receives a compact copy of each prototype solid found by
+   * `FindSolidInstances`, in the order of the solids. `instancesOut` holds one
+   * entry per solid of this mesh, whose `prototype` member is the index of a
+   * solid in `prototypesOut`.
+   * \sa FindSolidInstances*/
+  void instance_solids (StlMesh& prototypesOut,
+                        std::vector <SolidInstance>& instancesOut,
+                        const double tolerance = 0,
+                        const unsigned int numThreads = 0) const;
+
+  /// renders a small shaded image of this mesh
+  /** \sa RenderThumbnail*/
+  Thumbnail thumbnail (const ThumbnailOptions& options = ThumbnailOptions(),
+                       const unsigned int numThreads = 0) const
+  {
+    Thumbnail image;
+    RenderThumbnail (coords, tris, options, image, numThreads);
+    return image;
+  }
+
+  /// returns the number of bytes used by the arrays of this mesh
+  MeshMemoryUsage memory_usage () const
+  {
+    MeshMemoryUsage usage;
+    usage.coordsSize = coords.size() * sizeof(TNumber);
+    usage.coordsCapacity = coords.capacity() * sizeof(TNumber);
+    usage.normalsSize = normals.size() * sizeof(TNumber);
+    usage.normalsCapacity = normals.capacity() * sizeof(TNumber);
+    usage.trisSize = tris.size() * sizeof(TIndex);
+    usage.trisCapacity = tris.capacity() * sizeof(TIndex);
+    usage.solidsSize = solids.size() * sizeof(TIndex);
+    usage.solidsCapacity = solids.capacity() * sizeof(TIndex);
+    usage.peakLoadScratch = readInfo.peakScratchBytes;
+    return usage;
+  }
+
+  /// releases memory which is allocated but not used by the arrays of this mesh
+  /** Each array is replaced by a copy of exact size.*/
+  void shrink_to_fit ()
+  {
+    std::vector<TNumber> (coords).swap (coords);
+    std::vector<TNumber> (normals).swap (normals);
+    std::vector<TIndex> (tris).swap (tris);
+    std::vector<TIndex> (solids).swap (solids);
+  }
+
+  /// returns information gathered during the last call to `read_file`
+  const StlReadInfo& read_info () const
+  {
+    return readInfo;
+  }
+
+  /// returns the size in bytes of the image written by `write_image`
+  size_t image_size () const
+  {
+    size_t offsets[4];
+    return image_layout (offsets);
+  }
+
+  /// writes a relocatable image of this mesh to `imageOut`
+  /** `imageOut` has to point to at least `image_size()` bytes and has to be
+   * aligned to `StlMeshImageHeader::ALIGNMENT` bytes. The image can be
+   * accessed through `StlMeshView` without copying or parsing, also from
+   * other processes if it is placed in shared memory.
+   * \sa StlMeshImageHeader, PublishStlMeshImage_SHM*/
+  bool write_image (void* imageOut, const size_t size) const
+  {
+    size_t offsets[4];
+    const size_t imageSize = image_layout (offsets);
+    STL_READER_COND_THROW (size < imageSize, "Buffer of " << size
+                           << " bytes is too small for a mesh image of " << imageSize << " bytes");
+    STL_READER_COND_THROW (reinterpret_cast<size_t> (imageOut) % StlMeshImageHeader::ALIGNMENT != 0,
+                           "Buffer for mesh image is not aligned to "
+                           << StlMeshImageHeader::ALIGNMENT << " bytes");
+
+    StlMeshImageHeader header;
+    memset (&header, 0, sizeof(header));
+    memcpy (header.magic, "STLMESH", 8);
+    header.version = StlMeshImageHeader::VERSION;
+    header.byteOrderMark = StlMeshImageHeader::BYTE_ORDER_MARK;
+    header.numberSize = sizeof(TNumber);
+    header.indexSize = sizeof(TIndex);
+    header.imageSize = imageSize;
+    header.coordsLength = coords.size();
+    header.normalsLength = normals.size();
+    header.trisLength = tris.size();
+    header.solidsLength = solids.size();
+    header.coordsOffset = offsets[0];
+    header.normalsOffset = offsets[1];
+    header.trisOffset = offsets[2];
+    header.solidsOffset = offsets[3];
+    std::copy (originCoords, originCoords + 3, header.origin);
+
+    char* image = static_cast<char*> (imageOut);
+    memset (image, 0, imageSize);
+    memcpy (image, &header, sizeof(header));
+    if(!coords.empty())
+      memcpy (image + offsets[0], &coords[0], coords.size() * sizeof(TNumber));
+    if(!normals.empty())
+      memcpy (image + offsets[1], &normals[0], normals.size() * sizeof(TNumber));
+    if(!tris.empty())
+      memcpy (image + offsets[2], &tris[0], tris.size() * sizeof(TIndex));
+    if(!solids.empty())
+      memcpy (image + offsets[3], &solids[0], solids.size() * sizeof(TIndex));
+    return true;
+  }
+
+  /// returns an order independent fingerprint of the triangles of the mesh
+  /** The hash is computed from the current arrays of the mesh. The hash
+   * computed while reading the file is available as `read_info().geometryHash`.
+   * \sa ComputeGeometryHash*/
+  unsigned long long geometry_hash () const
+  {
+    return ComputeGeometryHash (coords, tris);
+  }
+
+  /// returns the number of vertices in the mesh
+  size_t num_vrts () const
+  {
+    return coords.size() / 3;
+  }
+
+  /// returns an array of 3 floating point values, one for each coordinate of the vertex
+  const TNumber* vrt_coords (const size_t vi) const
+  {
+    return &coords[vi * 3];
+  }
+
+  /// returns the number of triangles in the mesh
+  size_t num_tris () const
+  {
+    return tris.size() / 3;
+  }
+
+  /// returns an array of 3 indices, one for each corner vertex of the triangle
+  const TIndex* tri_corner_inds (const size_t ti) const
+  {
+    return &tris [ti * 3];
+  }
+
+  /// returns the index of the corner with index `0<=ci<3` of triangle ti
+  const TIndex tri_corner_ind (const size_t ti, const size_t ci) const
+  {
+    return tris [ti * 3 + ci];
+  }
+
+  /** \brief  returns an array of 3 floating point values, one for each
+   *          coordinate of the specified corner of the specified tri.
+   * \note  same result as calling on a `StlMesh mesh`:
+   *        \code
+   *          mesh.vrt_coords (mesh.tri_corner_ind (itri, icorner))
+   *        \endcode
+   */
+  const TNumber* tri_corner_coords (const size_t ti, const size_t ci) const
+  {
+    return &coords[tri_corner_ind(ti, ci) * 3];
+  }
+
+  /// returns an array of 3 floating point values defining the normal of a tri
+  const TNumber* tri_normal (const size_t ti) const
+  {
+    return &normals [ti * 3];
+  }
+
+  /// returns the number of solids of the mesh
+  /** solids can be seen as a partitioning of the triangles of a mesh.
+   * By iterating consecutively from the index of the first triangle of a
+   * solid `si` (using `solid_tris_begin(si)`) to the index of the last
+   * triangle of a solid (using `solid_tris_end(...)-1`), one visits all
+   * triangles of the solid `si`.*/
+  size_t num_solids () const
+  {
+    if(solids.empty ())
+      return 0;
+    return solids.size () - 1;
+  }
+
+  /// returns the index of the first triangle in the given solid
+  TIndex solid_tris_begin (const size_t si) const
+  {
+    return solids [si];
+  }
+
+  /// returns the index of the triangle behind the last triangle in the given solid
+  TIndex solid_tris_end (const size_t si) const
+  {
+    return solids [si + 1];
+  }
+
+  /// returns a pointer to the coordinate array, containing `num_vrts()*3` entries.
+  /** Storage layout: `x0,y0,z0,x1,y1,z1,...`
+   * \returns pointer to a contiguous array of numbers, or `NULL` if no coords exist.*/
+  const TNumber* raw_coords () const
+  {
+    if(coords.empty())
+      return NULL;
+    return &coords[0];
+  }
+
+  /// returns a pointer to the normal array, containing `num_tris()*3` entries.
+  /** Storage layout: `nx0,ny0,nz0,nx1,ny1,nz1,...`
+   * \returns pointer to a contiguous array of numbers, or `NULL` if no normals exist.*/
+  const TNumber* raw_normals () const
+  {
+    if(normals.empty())
+      return NULL;
+    return &normals[0];
+  }
+
+  /// returns a pointer to the triangle array, containing `num_tris()*3` entries.
+  /** Storage layout: `t0c0,t0c1,t0c2,t1c0,t1c1,t1c2,...`
+   * \returns pointer to a contiguous array of indices, or `NULL` if no tris exist.*/
+  const TIndex* raw_tris () const
+  {
+    if(tris.empty())
+      return NULL;
+    return &tris[0];
+  }
+
+  /// returns a pointer to the solids array, containing `num_solids()+1` entries.
+  /** Storage layout: `s0begin, s0end/s1begin, s1end/s2begin, ..., sNend`
+   * \returns pointer to a contiguous array of indices, or `NULL` if no solids exist.*/
+  const TIndex* raw_solids () const
+  {
+    if(solids.empty())
+      return NULL;
+    return &solids[0];
+  }
+
+private:
+  enum ReadMode {READ_DEFAULT, READ_RELATIVE, READ_RECOVER};
+
+  bool read (const char* filename, const ReadMode mode)
+  {
+    bool res = false;
+    originCoords[0] = originCoords[1] = originCoords[2] = 0;
+
+    #ifndef STL_READER_NO_EXCEPTIONS
+    try {
+    #endif
+
+    if(mode == READ_RELATIVE)
+      res = ReadStlFileRelative (filename, originCoords, coords, normals, tris, solids, &readInfo);
+    else if(mode == READ_RECOVER)
+      res = RecoverStlFile_BINARY (filename, coords, normals, tris, solids, &readInfo);
+    else
+      res = ReadStlFile (filename, coords, normals, tris, solids, &readInfo);
+
+    #ifndef STL_READER_NO_EXCEPTIONS
+    } catch (std::exception& e) {
+    #else
+    if (!res) {
+    #endif
+
+      coords.clear ();
+      normals.clear ();
+      tris.clear ();
+      solids.clear ();
+      readInfo = StlReadInfo ();
+      originCoords[0] = originCoords[1] = originCoords[2] = 0;
+      STL_READER_THROW (e.what());
+    }
+
+    return res;
+  }
+
+  // computes the offsets of the arrays in an image of the mesh and returns its size
+  size_t image_layout (size_t* offsetsOut) const
+  {
+    const size_t align = StlMeshImageHeader::ALIGNMENT;
+    const size_t bytes[4] = {coords.size() * sizeof(TNumber),
+                             normals.size() * sizeof(TNumber),
+                             tris.size() * sizeof(TIndex),
+                             solids.size() * sizeof(TIndex)};
+    size_t offset = sizeof(StlMeshImageHeader);
+    for(size_t i = 0; i < 4; ++i){
+      offset = (offset + align - 1) / align * align;
+      offsetsOut[i] = offset;
+      offset += bytes[i];
+    }
+    return offset;
+  }
+
+  template <class T>
+  static void take (std::vector<T>& array, std::vector<T>& arrayOut)
+  {
+    arrayOut.swap (array);
+    std::vector<T> ().swap (array);
+  }
+
+  std::vector<TNumber>  coords;
+  std::vector<TNumber>  normals;
+  std::vector<TIndex>   tris;
+  std::vector<TIndex>   solids;
+  StlReadInfo           readInfo;
+  double                originCoords[3];
+};
+
+/// exchanges the contents of two meshes
+template <class TNumber, class TIndex>
+void swap (StlMesh <TNumber, TIndex>& a, StlMesh <TNumber, TIndex>& b)
+{
+  a.swap (b);
+}
+
+
+/// read-only access to a mesh image, without copying or parsing it
+/** The view refers to the image, which has to outlive it. It offers the same
+ * accessors as `StlMesh`. `TNumber` and `TIndex` have to match the types of
+ * the mesh which wrote the image. The header and the array bounds of the image
+ * are checked when attaching, the triangle indices are not.
+ * \sa StlMesh::write_image, SharedStlMeshImage
+ */
+template <class TNumber = float, class TIndex = unsigned int>
+class StlMeshView {
+public:
+  /// initializes an empty view
+  StlMeshView ()
+  {
+    reset ();
+  }
+
+  /// initializes the view from the image at `image` of `size` bytes
+  StlMeshView (const void* image, const size_t size)
+  {
+    reset ();
+    attach (image, size);
+  }
+
+  /// makes the view refer to the image at `image` of `size` bytes
+  bool attach (const void* image, const size_t size)
+  {
+    reset ();
+    STL_READER_COND_THROW (image == NULL || size < sizeof(StlMeshImageHeader),
+                           "Mesh image of " << size << " bytes is too small");
+    STL_READER_COND_THROW (reinterpret_cast<size_t> (image) % StlMeshImageHeader::ALIGNMENT != 0,
+                           "Mesh image is not aligned to " << StlMeshImageHeader::ALIGNMENT << " bytes");
+
+    const StlMeshImageHeader& h = *static_cast<const StlMeshImageHeader*> (image);
+    STL_READER_COND_THROW (memcmp (h.magic, "STLMESH", 8) != 0, "Data is not a mesh image");
+    STL_READER_COND_THROW (h.version != StlMeshImageHeader::VERSION,
+                           "Unsupported mesh image version " << h.version);
+    STL_READER_COND_THROW (h.byteOrderMark != StlMeshImageHeader::BYTE_ORDER_MARK,
+                           "Mesh image was written with a different byte order");
+    STL_READER_COND_THROW (h.numberSize != sizeof(TNumber) || h.indexSize != sizeof(TIndex),
+                           "Mesh image holds numbers of " << h.numberSize << " bytes and indices of "
+                           << h.indexSize << " bytes, expected " << sizeof(TNumber) << " and "
+                           << sizeof(TIndex) << " bytes");
+    STL_READER_COND_THROW (h.imageSize > size, "Mesh image of " << h.imageSize
+                           << " bytes is truncated to " << size << " bytes");
+    STL_READER_COND_THROW (!array_fits (h, h.coordsOffset, h.coordsLength, sizeof(TNumber)) ||
+                           !array_fits (h, h.normalsOffset, h.normalsLength, sizeof(TNumber)) ||
+                           !array_fits (h, h.trisOffset, h.trisLength, sizeof(TIndex)) ||
+                           !array_fits (h, h.solidsOffset, h.solidsLength, sizeof(TIndex)),
+                           "Mesh image has arrays outside of its bounds");
+    STL_READER_COND_THROW (h.coordsLength % 3 != 0 || h.trisLength % 3 != 0 ||
+                           h.normalsLength != h.trisLength || h.solidsLength == 1,
+                           "Mesh image has inconsistent array sizes");
+
+    const char* data = static_cast<const char*> (image);
+    m_image = data;
+    m_imageSize = static_cast<size_t> (h.imageSize);
+    m_coords = reinterpret_cast<const TNumber*> (data + h.coordsOffset);
+    m_normals = reinterpret_cast<const TNumber*> (data + h.normalsOffset);
+    m_tris = reinterpret_cast<const TIndex*> (data + h.trisOffset);
+    m_solids = reinterpret_cast<const TIndex*> (data + h.solidsOffset);
+    m_numVrts = static_cast<size_t> (h.coordsLength / 3);
+    m_numTris = static_cast<size_t> (h.trisLength / 3);
+    m_numSolids = h.solidsLength == 0 ? 0 : static_cast<size_t> (h.solidsLength - 1);
+    std::copy (h.origin, h.origin + 3, m_origin);
+    return true;
+  }
+
+  /// returns the image the view refers to or `NULL`
+  const void* image () const                {return m_image;}
+
+  /// returns the size in bytes of the image the view refers to
+  size_t image_size () const                {return m_imageSize;}
+
+  /// returns the origin of the coordinates, see `StlMesh::origin`
+  const double* origin () const             {return m_origin;}
+
+  /// accessors to vertices, triangles and solids, as offered by `StlMesh`
+  /** \{ */
+  size_t num_vrts () const                  {return m_numVrts;}
+  const TNumber* vrt_coords (const size_t vi) const   {return m_coords + vi * 3;}
+  size_t num_tris () const                  {return m_numTris;}
+  const TIndex* tri_corner_inds (const size_t ti) const {return m_tris + ti * 3;}
+  TIndex tri_corner_ind (const size_t ti, const size_t ci) const {return m_tris[ti * 3 + ci];}
+  const TNumber* tri_corner_coords (const size_t ti, const size_t ci) const
+  {
+    return m_coords + tri_corner_ind (ti, ci) * 3;
+  }
+  const TNumber* tri_normal (const size_t ti) const   {return m_normals + ti * 3;}
+  size_t num_solids () const                {return m_numSolids;}
+  TIndex solid_tris_begin (const size_t si) const     {return m_solids[si];}
+  TIndex solid_tris_end (const size_t si) const       {return m_solids[si + 1];}
+  /** \} */
+
+  /// raw access to the arrays of the image. `NULL` if an array is empty.
+  /** \{ */
+  const TNumber* raw_coords () const        {return m_numVrts ? m_coords : NULL;}
+  const TNumber* raw_normals () const       {return m_numTris ? m_normals : NULL;}
+  const TIndex* raw_tris () const           {return m_numTris ? m_tris : NULL;}
+  const TIndex* raw_solids () const         {return m_numSolids ? m_solids : NULL;}
+  /** \} */
+
+private:
+  void reset ()
+  {
+    m_image = NULL;
+    m_imageSize = 0;
+    m_coords = m_normals = NULL;
+    m_tris = m_solids = NULL;
+    m_numVrts = m_numTris = m_numSolids = 0;
+    m_origin[0] = m_origin[1] = m_origin[2] = 0;
+  }
+
+  static bool array_fits (const StlMeshImageHeader& h, const unsigned long long offset,
+                          const unsigned long long length, const size_t entrySize)
+  {
+    return offset >= sizeof(StlMeshImageHeader) &&
+           offset % StlMeshImageHeader::ALIGNMENT == 0 &&
+           offset <= h.imageSize &&
+           length <= (h.imageSize - offset) / entrySize;
+  }
+
+  const char*     m_image;
+  size_t          m_imageSize;
+  const TNumber*  m_coords;
+  const TNumber*  m_normals;
+  const TIndex*   m_tris;
+  const TIndex*   m_solids;
+  size_t          m_numVrts;
+  size_t          m_numTris;
+  size_t          m_numSolids;
+  double          m_origin[3];
+};
+
+
+#ifdef STL_READER_SHARED_MEMORY
+
+/// writes an image of `mesh` to a new POSIX shared memory object (only with STL_READER_SHARED_MEMORY)
+/** The object is created with `shm_open` and fails to be created if an object
+ * called `name` exists already. Other processes attach to it with
+ * `SharedStlMeshImage::open_shm`. Remove it with `shm_unlink` once it is no
+ * longer needed.*/
+template <class TNumber, class TIndex>
+bool PublishStlMeshImage_SHM (const StlMesh <TNumber, TIndex>& mesh, const char* name);
+
+
+#ifdef __linux__
+/// writes an image of `mesh` to a new sealed memfd (only with STL_READER_SHARED_MEMORY, linux)
+/** The file descriptor of the anonymous file is written to `fdOut`. The file
+ * is sealed against writes and size changes. Processes forked afterwards
+ * inherit the descriptor and attach with `SharedStlMeshImage::open_fd`, other
+ * processes may receive it through a unix domain socket. The caller closes it.*/
+template <class TNumber, class TIndex>
+bool PublishStlMeshImage_MEMFD (const StlMesh <TNumber, TIndex>& mesh, const char* name, int& fdOut);
+#endif
+
+
+/// maps a mesh image from shared memory read-only (only with STL_READER_SHARED_MEMORY)
+/** All processes which map the same image share its physical memory. The
+ * mapping is released by `close` or on destruction.
+ * \sa PublishStlMeshImage_SHM, PublishStlMeshImage_MEMFD
+ */
+template <class TNumber = float, class TIndex = unsigned int>
+class SharedStlMeshImage {
+public:
+  SharedStlMeshImage () : m_data (NULL), m_size (0) {}
+  ~SharedStlMeshImage ()  {close ();}
+
+  /// maps the POSIX shared memory object called `name`
+  bool open_shm (const char* name)
+  {
+    close ();
+    const int fd = shm_open (name, O_RDONLY, 0);
+    STL_READER_COND_THROW (fd < 0, "Couldn't open shared memory object " << name);
+    const bool res = map (fd);
+    ::close (fd);
+    return res;
+  }
+
+  /// maps the image in the file referred to by `fd`, which stays open
+  bool open_fd (const int fd)
+  {
+    close ();
+    return map (fd);
+  }
+
+  /// releases the mapping
+  void close ()
+  {
+    m_view = StlMeshView <TNumber, TIndex> ();
+    if(m_data)
+      munmap (m_data, m_size);
+    m_data = NULL;
+    m_size = 0;
+  }
+
+  /// returns a view of the mapped image
+  const StlMeshView <TNumber, TIndex>& view () const {return m_view;}
+
+private:
+  SharedStlMeshImage (const SharedStlMeshImage&);
+  SharedStlMeshImage& operator = (const SharedStlMeshImage&);
+
+  bool map (const int fd)
+  {
+    struct stat st;
+    STL_READER_COND_THROW (fstat (fd, &st) != 0, "Couldn't determine size of shared mesh image");
+    const size_t size = static_cast<size_t> (st.st_size);
+    STL_READER_COND_THROW (size == 0, "Shared mesh image is empty");
+    void* data = mmap (NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    STL_READER_COND_THROW (data == MAP_FAILED, "Couldn't map shared mesh image");
+    m_data = data;
+    m_size = size;
+
+    #ifndef STL_READER_NO_EXCEPTIONS
+    try {
+      m_view.attach (m_data, m_size);
+    } catch (std::exception&) {
+      close ();
+      throw;
+    }
+    #else
+    if(!m_view.attach (m_data, m_size)){
+      close ();
+      return false;
+    }
+    #endif
+    return true;
+  }
+
+  void*                         m_data;
+  size_t                        m_size;
+  StlMeshView <TNumber, TIndex> m_view;
+};
+
+#endif // STL_READER_SHARED_MEMORY
+
+////////////////////////////////////////////////////////////////////////////////
+//  IMPLEMENTATION
+////////////////////////////////////////////////////////////////////////////////
+
+
+namespace stl_reader_impl {
+
+  // a coordinate triple with an additional index. The index is required
+  // for RemoveDoubles, so that triangles can be reindexed properly.
+  template <typename number_t, typename index_t>
+  struct CoordWithIndex {
+    number_t data[3];
+    index_t index;
+
+    bool operator == (const CoordWithIndex& c) const
+    {
+      return (c[0] == data[0]) && (c[1] == data[1]) && (c[2] == data[2]);
+    }
+
+    bool operator != (const CoordWithIndex& c) const
+    {
+      return (c[0] != data[0]) || (c[1] != data[1]) || (c[2] != data[2]);
+    }
+
+    bool operator < (const CoordWithIndex& c) const
+    {
+      return (data[0] < c[0])
+          || (data[0] == c[0] && data[1] < c[1])
+          || (data[0] == c[0] && data[1] == c[1] && data[2] < c[2]);
+    }
+
+    inline number_t& operator [] (const size_t i)   {return data[i];}
+    inline number_t operator [] (const size_t i) const  {return data[i];}
+  };
+
+  // number of bytes of the temporary arrays held while RemoveDoubles runs
+  template <class number_t, class index_t>
+  size_t RemoveDoublesScratchBytes (const std::vector <CoordWithIndex <number_t, index_t> >& coordsWithIndex)
+  {
+    return coordsWithIndex.capacity() * sizeof(CoordWithIndex <number_t, index_t>) +
+           coordsWithIndex.size() * sizeof(index_t);
+  }
+
+  // parses a floating point number from an ASCII token. The overloads make sure
+  // that float output is parsed directly as float, avoiding the conversion from
+  // double and the associated double rounding.
+  template <typename number_t>
+  inline void ParseNumber (const char* str, number_t& numOut)
+  {
+    numOut = static_cast<number_t> (strtod (str, NULL));
+  }
+
+  inline void ParseNumber (const char* str, float& numOut)
+  {
+    numOut = strtof (str, NULL);
+  }
+
+  inline void ParseNumber (const char* str, double& numOut)
+  {
+    numOut = strtod (str, NULL);
+  }
+
+  // splits the null-terminated 'line' at whitespace without copying it. Begin
+  // and length of the first maxNumTokens tokens are written to tokensOut and
+  // tokenLengthsOut. Returns the total number of tokens in the line.
+  inline size_t TokenizeLine (const char* line, const char** tokensOut,
+                              size_t* tokenLengthsOut, const size_t maxNumTokens)
+  {
+    size_t tokenCount = 0;
+    for(const char* c = line; *c;){
+      if(isspace (static_cast<unsigned char> (*c))){
+        ++c;
+        continue;
+      }
+      const char* tokenBegin = c;
+      while(*c && !isspace (static_cast<unsigned char> (*c)))
+        ++c;
+      if(tokenCount < maxNumTokens){
+        tokensOut[tokenCount] = tokenBegin;
+        tokenLengthsOut[tokenCount] = static_cast<size_t> (c - tokenBegin);
+      }
+      ++tokenCount;
+    }
+    return tokenCount;
+  }
+
+  // returns true if the token of length tokenLength starting at 'token' equals 'str'
+  inline bool TokenEquals (const char* token, const size_t tokenLength, const char* str)
+  {
+    return (strncmp (token, str, tokenLength) == 0) && (str[tokenLength] == 0);
+  }
+
+  // copies the 3 float coordinates 'src' of a binary stl record to 'dst'.
+  // For float output this is a plain copy, for all other types the values are
+  // converted in a loop which the compiler can widen with vector instructions.
+  template <typename number_t>
+  inline void CopyCoords (number_t* dst, const float* src)
+  {
+    for(size_t i = 0; i < 3; ++i)
+      dst[i] = static_cast<number_t> (src[i]);
+  }
+
+  inline void CopyCoords (float* dst, const float* src)
+  {
+    memcpy (dst, src, 3 * sizeof(float));
+  }
+
+  // finalizer of splitmix64, a fast bijective 64 bit mix function
+  inline unsigned long long HashMix (unsigned long long h)
+  {
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+    return h ^ (h >> 31);
+  }
+
+  // bit pattern of a coordinate converted to double. -0 and +0 are identified.
+  template <typename number_t>
+  inline unsigned long long CoordBits (const number_t v)
+  {
+    const double d = static_cast<double> (v) + 0.0;
+    unsigned long long bits;
+    memcpy (&bits, &d, sizeof(bits));
+    return bits;
+  }
+
+  template <typename number_t>
+  inline bool CoordsLess (const number_t* a, const number_t* b)
+  {
+    return (a[0] < b[0])
+        || (a[0] == b[0] && a[1] < b[1])
+        || (a[0] == b[0] && a[1] == b[1] && a[2] < b[2]);
+  }
+
+  // hash of a triangle given by its corner coordinates. The corners are
+  // rotated so that the lexicographically smallest one comes first, which
+  // makes the hash independent of the first corner but not of the orientation.
+  template <typename number_t>
+  inline unsigned long long HashTriangle (const number_t* c0, const number_t* c1, const number_t* c2)
+  {
+    const number_t* c[3] = {c0, c1, c2};
+    size_t first = 0;
+    for(size_t i = 1; i < 3; ++i){
+      if(CoordsLess (c[i], c[first]))
+        first = i;
+    }
+
+    unsigned long long h = 0x9e3779b97f4a7c15ULL;
+    for(size_t i = 0; i < 3; ++i){
+      const number_t* corner = c[(first + i) % 3];
+      for(size_t j = 0; j < 3; ++j)
+        h = HashMix (h ^ CoordBits (corner[j]));
+    }
+    return h;
+  }
+
+  // combines the sum of all triangle hashes with the number of triangles.
+  // Addition is commutative, so that the order of triangles doesn't matter.
+  inline unsigned long long FinishGeometryHash (const unsigned long long hashSum, const size_t numTris)
+  {
+    return HashMix (hashSum ^ HashMix (static_cast<unsigned long long> (numTris)));
+  }
+
+  // sorts the array coordsWithIndexInOut and copies unique indices to coordsOut.
+  // Triangle-corners are re-indexed on the fly and degenerated triangles are removed.
+  template <class TNumberContainer1, class TNumberContainer2,
+            class TIndexContainer1, class TIndexContainer2>
+  void RemoveDoubles (TNumberContainer1& uniqueCoordsOut,
+                      TIndexContainer1& trisInOut,
+                      TNumberContainer2& normalsInOut,
+                      TIndexContainer2& solidsInOut,
+                      std::vector <CoordWithIndex<
+                        typename TNumberContainer1::value_type,
+                        typename TIndexContainer1::value_type> >
+                        &coordsWithIndexInOut,
+                      unsigned long long* geometryHashOut = NULL)
+  {
+    using namespace std;
+
+    typedef typename TNumberContainer1::value_type number_t;
+    typedef typename TIndexContainer1::value_type  index_t;
+
+    if(coordsWithIndexInOut.empty()){
+      uniqueCoordsOut.clear();
+      if(geometryHashOut)
+        *geometryHashOut = FinishGeometryHash (0, 0);
+      return;
+    }
+
+    STL_READER_TRACE_BEGIN (traceWeld, "weld");
+    sort (coordsWithIndexInOut.begin(), coordsWithIndexInOut.end());
+  
+  //  first count unique indices
+    index_t numUnique = 1;
+    for(size_t i = 1; i < coordsWithIndexInOut.size(); ++i){
+      if(coordsWithIndexInOut[i] != coordsWithIndexInOut[i - 1])
+        ++numUnique;
+    }
+
+    uniqueCoordsOut.resize (numUnique * 3);
+    vector<index_t> newIndex (coordsWithIndexInOut.size());
+
+    TIndexContainer2 newSolids;
+
+  //  copy unique coordinates to 'uniqueCoordsOut' and create an index-map
+  //  'newIndex', which allows to re-index triangles later on.
+    index_t curInd = 0;
+    newIndex[coordsWithIndexInOut[0].index] = 0;
+    for(index_t i = 0; i < 3; ++i)
+      uniqueCoordsOut[i] = coordsWithIndexInOut[0][i];
+
+    for(size_t i = 1; i < coordsWithIndexInOut.size(); ++i){
+      const CoordWithIndex <number_t, index_t> c = coordsWithIndexInOut[i];
+      if(c != coordsWithIndexInOut[i - 1]){
+        ++curInd;
+        for(index_t j = 0; j < 3; ++j)
+          uniqueCoordsOut[curInd * 3 + j] = coordsWithIndexInOut[i][j];
+      }
+
+      newIndex[c.index] = static_cast<index_t> (curInd);
+    }
+
+    STL_READER_TRACE_END (traceWeld);
+    STL_READER_TRACE_SCOPE ("reindex");
+
+  //  re-index triangles, so that they refer to 'uniqueCoordsOut'
+  //  make sure to only add triangles which refer to three different indices.
+  //  The geometry hash is accumulated on the fly for the remaining triangles.
+    unsigned long long hashSum = 0;
+    index_t numUniqueTriInds = 0;
+    for(index_t i = 0; i < trisInOut.size(); i+=3){
+      
+      const index_t triInd = i / 3;
+      const index_t newTriInd = numUniqueTriInds / 3;
+      if (newSolids.size () < solidsInOut.size () &&
+          solidsInOut [newSolids.size ()] <= triInd)
+      {
+        newSolids.push_back (newTriInd);
+      }
+
+      index_t ni[3];
+      for(index_t j = 0; j < 3; ++j)
+        ni[j] = newIndex[trisInOut[i+j]];
+
+      if((ni[0] != ni[1]) && (ni[0] != ni[2]) && (ni[1] != ni[2])){
+        for(index_t j = 0; j < 3; ++j)
+        {
+          trisInOut[numUniqueTriInds + j] = ni[j];
+          normalsInOut[numUniqueTriInds + j] = normalsInOut [i + j];
+        }
+        numUniqueTriInds += 3;
+        if(geometryHashOut)
+          hashSum += HashTriangle (&uniqueCoordsOut[ni[0] * 3],
+                                   &uniqueCoordsOut[ni[1] * 3],
+                                   &uniqueCoordsOut[ni[2] * 3]);
+      }
+    }
+
+    if(geometryHashOut)
+      *geometryHashOut = FinishGeometryHash (hashSum, numUniqueTriInds / 3);
+
+    if(numUniqueTriInds < trisInOut.size())
+    {
+      trisInOut.resize (numUniqueTriInds);
+      normalsInOut.resize (numUniqueTriInds);
+    }
+
+    if (!newSolids.empty ())
+      newSolids.push_back (numUniqueTriInds / 3);
+    
+    using std::swap;
+    swap (solidsInOut, newSolids);
+  }
+
+  // Calls func(begin, end) for subranges which together cover [0, n). If threads
+  // are enabled, the subranges of size 'grainSize' are processed concurrently
+  // by up to 'numThreads' threads (all hardware threads if numThreads == 0).
+  // 'func' must not throw.
+  template <class TFunc>
+  void ParallelFor (const size_t n, size_t grainSize, TFunc& func,
+                    unsigned int numThreads)
+  {
+    if(n == 0)
+      return;
+
+    #ifdef STL_READER_THREADS
+      if(numThreads == 0)
+        numThreads = std::thread::hardware_concurrency();
+      if(grainSize == 0)
+        grainSize = 1;
+      const size_t numChunks = (n + grainSize - 1) / grainSize;
+      if(numThreads > numChunks)
+        numThreads = static_cast<unsigned int> (numChunks);
+
+      if(numThreads > 1){
+        std::atomic<size_t> nextChunk (0);
+        auto worker = [&] () {
+          for(size_t chunk = nextChunk++; chunk < numChunks; chunk = nextChunk++){
+            const size_t begin = chunk * grainSize;
+            STL_READER_TRACE_SCOPE ("work item");
+            func (begin, std::min (n, begin + grainSize));
+          }
+        };
+
+        std::vector<std::thread> threads;
+        for(unsigned int i = 1; i < numThreads; ++i)
+          threads.push_back (std::thread (worker));
+        worker ();
+        for(size_t i = 0; i < threads.size(); ++i)
+          threads[i].join();
+        return;
+      }
+    #else
+      (void) grainSize;
+      (void) numThreads;
+    #endif
+
+    STL_READER_TRACE_SCOPE ("work item");
+    func (0, n);
+  }
+
+
+  // an edge of a triangle. 'vrt' is sorted, 'reversed' indicates whether the
+  // triangle traverses the edge from vrt[1] to vrt[0].
+  template <typename index_t>
+  struct EdgeWithTri {
+    index_t vrt[2];
+    index_t tri;
+    bool    reversed;
+
+    bool operator < (const EdgeWithTri& e) const
+    {
+      return (vrt[0] < e.vrt[0]) || (vrt[0] == e.vrt[0] && vrt[1] < e.vrt[1]);
+    }
+
+    bool same_edge (const EdgeWithTri& e) const
+    {
+      return vrt[0] == e.vrt[0] && vrt[1] == e.vrt[1];
+    }
+  };
+
+  // returns the number of bits required to represent 'value'
+  inline unsigned int NumBits (unsigned long long value)
+  {
+    unsigned int bits = 0;
+    while(value > 0){
+      ++bits;
+      value >>= 1;
+    }
+    return bits;
+  }
+
+  struct IdentityKey {
+    unsigned long long operator () (const unsigned long long key) const {return key;}
+  };
+
+  template <typename T, class TKeyFunc>
+  struct KeyLess {
+    TKeyFunc keyFunc;
+    bool operator () (const T& a, const T& b) const {return keyFunc (a) < keyFunc (b);}
+  };
+
+  // Sorts 'items' by the integer keys returned by 'keyFunc', which must not
+  // exceed 'numKeyBits' bits. This is a stable least significant digit radix
+  // sort with 11 bit digits, so that the buckets of a pass fit into the cache.
+  // The histograms of all passes are computed in a single sweep and passes in
+  // which all items share the same digit are skipped. Small arrays are sorted
+  // by comparison instead.
+  template <typename T, class TKeyFunc>
+  void RadixSort (std::vector <T>& items,
+                  std::vector <T>& scratch,
+                  const TKeyFunc& keyFunc,
+                  const unsigned int numKeyBits)
+  {
+    const size_t n = items.size();
+    if(n < 4096){
+      KeyLess <T, TKeyFunc> less;
+      less.keyFunc = keyFunc;
+      std::stable_sort (items.begin(), items.end(), less);
+      return;
+    }
+
+    const unsigned int digitBits = 11;
+    const size_t numBuckets = size_t(1) << digitBits;
+    const unsigned long long digitMask = numBuckets - 1;
+    const unsigned int numPasses = (numKeyBits + digitBits - 1) / digitBits;
+
+    std::vector <size_t> offsets (numPasses * numBuckets, 0);
+    for(size_t i = 0; i < n; ++i){
+      const unsigned long long key = keyFunc (items[i]);
+      for(unsigned int pass = 0; pass < numPasses; ++pass)
+        ++offsets[pass * numBuckets + ((key >> (pass * digitBits)) & digitMask)];
+    }
+
+    scratch.resize (n);
+    for(unsigned int pass = 0; pass < numPasses; ++pass){
+      size_t* passOffsets = &offsets[pass * numBuckets];
+      bool trivialPass = false;
+      size_t sum = 0;
+      for(size_t i = 0; i < numBuckets; ++i){
+        trivialPass |= (passOffsets[i] == n);
+        const size_t count = passOffsets[i];
+        passOffsets[i] = sum;
+        sum += count;
+      }
+      if(trivialPass)
+        continue;
+
+      const unsigned int shift = pass * digitBits;
+      for(size_t i = 0; i < n; ++i)
+        scratch[passOffsets[(keyFunc (items[i]) >> shift) & digitMask]++] = items[i];
+      items.swap (scratch);
+    }
+  }
+
+  template <typename index_t>
+  struct EdgeKey {
+    unsigned int vrtBits;
+    unsigned long long operator () (const EdgeWithTri <index_t>& e) const
+    {
+      return (static_cast<unsigned long long> (e.vrt[0]) << vrtBits) |
+              static_cast<unsigned long long> (e.vrt[1]);
+    }
+  };
+
+  // collects the edges of the triangles [triBegin, triEnd) and sorts them, so
+  // that the entries of identical edges are adjacent in 'edgesOut'. Entries of
+  // the same edge are ordered by triangle index.
+  template <class TIndexContainer>
+  void CollectSortedEdges (const TIndexContainer& tris,
+                           const size_t triBegin,
+                           const size_t triEnd,
+                           std::vector <EdgeWithTri <
+                              typename TIndexContainer::value_type> >& edgesOut)
+  {
+    typedef typename TIndexContainer::value_type index_t;
+
+    edgesOut.resize ((triEnd - triBegin) * 3);
+    unsigned long long maxVrt = 0;
+    for(size_t itri = triBegin; itri < triEnd; ++itri){
+      for(size_t i = 0; i < 3; ++i){
+        const index_t v0 = tris[itri * 3 + i];
+        const index_t v1 = tris[itri * 3 + (i + 1) % 3];
+        EdgeWithTri <index_t>& e = edgesOut[(itri - triBegin) * 3 + i];
+        e.reversed = v1 < v0;
+        e.vrt[0] = e.reversed ? v1 : v0;
+        e.vrt[1] = e.reversed ? v0 : v1;
+        e.tri = static_cast<index_t> (itri);
+        maxVrt = std::max (maxVrt, static_cast<unsigned long long> (e.vrt[1]));
+      }
+    }
+
+    EdgeKey <index_t> key;
+    key.vrtBits = NumBits (maxVrt);
+    if(key.vrtBits <= 32){
+      std::vector <EdgeWithTri <index_t> > scratch;
+      RadixSort (edgesOut, scratch, key, 2 * key.vrtBits);
+    }
+    else
+      std::stable_sort (edgesOut.begin(), edgesOut.end());
+  }
+
+  template <class TIndexContainer>
+  void CollectSortedEdges (const TIndexContainer& tris,
+                           std::vector <EdgeWithTri <
+                              typename TIndexContainer::value_type> >& edgesOut)
+  {
+    CollectSortedEdges (tris, 0, tris.size() / 3, edgesOut);
+  }
+
+  // returns the representative of the set containing i and compresses the path
+  template <typename index_t>
+  index_t FindRoot (std::vector <index_t>& parents, index_t i)
+  {
+    index_t root = i;
+    while(parents[root] != root)
+      root = parents[root];
+    while(parents[i] != root){
+      const index_t next = parents[i];
+      parents[i] = root;
+      i = next;
+    }
+    return root;
+  }
+
+  // orients the components of a mesh by breadth first traversals. 'compTris'
+  // holds the triangles of each component consecutively, 'compRanges' the
+  // ranges of the individual components in 'compTris'. 'adjacency' holds for
+  // each triangle corner i the neighbor across the edge (i, i+1) in the form
+  // 2 * neighbor + (1 if the edge is traversed in the same direction), or -1.
+  template <typename index_t>
+  struct OrientComponentsFunc {
+    const std::vector <index_t>*  compTris;
+    const std::vector <size_t>*   compRanges;
+    const std::vector <long long>* adjacency;
+    std::vector <signed char>*    flip;
+    std::vector <size_t>*         numFlipped;
+
+    void operator () (const size_t compBegin, const size_t compEnd)
+    {
+      std::vector <signed char>& f = *flip;
+      std::vector <index_t> queue;
+      for(size_t icomp = compBegin; icomp < compEnd; ++icomp){
+        const size_t begin = (*compRanges)[icomp];
+        const size_t end = (*compRanges)[icomp + 1];
+        const index_t first = (*compTris)[begin];
+
+        queue.clear();
+        queue.push_back (first);
+        f[first] = 0;
+        size_t numFlips = 0;
+
+        for(size_t iq = 0; iq < queue.size(); ++iq){
+          const index_t t = queue[iq];
+          for(size_t i = 0; i < 3; ++i){
+            const long long adj = (*adjacency)[t * 3 + i];
+            if(adj < 0)
+              continue;
+            const index_t nbr = static_cast<index_t> (adj / 2);
+            if(f[nbr] != -1)
+              continue;
+            const signed char sameDir = static_cast<signed char> (adj % 2);
+            f[nbr] = static_cast<signed char> (f[t] ^ sameDir);
+            numFlips += f[nbr];
+            queue.push_back (nbr);
+          }
+        }
+
+      //  flip the whole component if that changes fewer triangles
+        const size_t compSize = end - begin;
+        if(2 * numFlips > compSize){
+          for(size_t i = begin; i < end; ++i)
+            f[(*compTris)[i]] ^= 1;
+          numFlips = compSize - numFlips;
+        }
+        (*numFlipped)[icomp] = numFlips;
+      }
+    }
+  };
+
+  // returns the position of vertex v in triangle tri
+  template <class TIndexContainer, typename index_t>
+  size_t CornerOfVrt (const TIndexContainer& tris, const index_t tri, const index_t v)
+  {
+    for(size_t i = 0; i < 2; ++i){
+      if(tris[tri * 3 + i] == v)
+        return i;
+    }
+    return 2;
+  }
+
+  // validates the triangles [triBegin, triEnd) of tris
+  template <class TIndexContainer>
+  MeshValidation ValidateTriRange (const TIndexContainer& tris,
+                                   const size_t triBegin,
+                                   const size_t triEnd)
+  {
+    typedef typename TIndexContainer::value_type index_t;
+
+    MeshValidation report;
+    const size_t numCorners = (triEnd - triBegin) * 3;
+    if(numCorners == 0)
+      return report;
+
+    std::vector <EdgeWithTri <index_t> > edges;
+    CollectSortedEdges (tris, triBegin, triEnd, edges);
+
+  //  corners of adjacent triangles at the vertices of a manifold edge belong
+  //  to the same fan. A vertex is non-manifold if its corners form several fans.
+    std::vector <index_t> fans (numCorners);
+    for(size_t i = 0; i < numCorners; ++i)
+      fans[i] = static_cast<index_t> (i);
+
+    for(size_t i = 0; i < edges.size();){
+      size_t j = i + 1;
+      while(j < edges.size() && edges[j].same_edge (edges[i]))
+        ++j;
+
+      const size_t numEdgeTris = j - i;
+      if(numEdgeTris == 1)
+        ++report.numBoundaryEdges;
+      else if(numEdgeTris > 2)
+        ++report.numNonManifoldEdges;
+      else{
+        const EdgeWithTri <index_t>& e0 = edges[i];
+        const EdgeWithTri <index_t>& e1 = edges[i + 1];
+        if(e0.reversed == e1.reversed)
+          ++report.numInconsistentEdges;
+
+        for(size_t k = 0; k < 2; ++k){
+          const index_t c0 = static_cast<index_t> (
+                (e0.tri - triBegin) * 3 + CornerOfVrt (tris, e0.tri, e0.vrt[k]));
+          const index_t c1 = static_cast<index_t> (
+                (e1.tri - triBegin) * 3 + CornerOfVrt (tris, e1.tri, e1.vrt[k]));
+          const index_t r0 = FindRoot (fans, c0);
+          const index_t r1 = FindRoot (fans, c1);
+          if(r0 != r1)
+            fans[std::max (r0, r1)] = std::min (r0, r1);
+        }
+      }
+      i = j;
+    }
+
+  //  sort (vertex, fan) pairs and count vertices with more than one fan
+    std::vector <unsigned long long> vrtFans (numCorners);
+    unsigned long long maxVrt = 0;
+    for(size_t i = 0; i < numCorners; ++i)
+      maxVrt = std::max (maxVrt, static_cast<unsigned long long> (tris[triBegin * 3 + i]));
+
+    const unsigned int fanBits = NumBits (numCorners);
+    const unsigned int vrtBits = NumBits (maxVrt);
+    for(size_t i = 0; i < numCorners; ++i){
+      vrtFans[i] = (static_cast<unsigned long long> (tris[triBegin * 3 + i]) << fanBits) |
+                    static_cast<unsigned long long> (FindRoot (fans, static_cast<index_t> (i)));
+    }
+
+    if(fanBits + vrtBits <= 64){
+      std::vector <unsigned long long> scratch;
+      RadixSort (vrtFans, scratch, IdentityKey(), fanBits + vrtBits);
+    }
+    else
+      std::sort (vrtFans.begin(), vrtFans.end());
+
+    for(size_t i = 0; i < numCorners;){
+      const unsigned long long vrt = vrtFans[i] >> fanBits;
+      size_t numFans = 1;
+      size_t j = i + 1;
+      for(; j < numCorners && (vrtFans[j] >> fanBits) == vrt; ++j){
+        if(vrtFans[j] != vrtFans[j - 1])
+          ++numFans;
+      }
+      if(numFans > 1)
+        ++report.numNonManifoldVrts;
+      i = j;
+    }
+
+    return report;
+  }
+
+  template <class TIndexContainer1, class TIndexContainer2>
+  struct ValidateSolidsFunc {
+    const TIndexContainer1*       tris;
+    const TIndexContainer2*       solidRanges;
+    std::vector <MeshValidation>* reports;
+
+    void operator () (const size_t solidBegin, const size_t solidEnd)
+    {
+      for(size_t i = solidBegin; i < solidEnd; ++i){
+        (*reports)[i] = ValidateTriRange (*tris,
+                                          static_cast<size_t> ((*solidRanges)[i]),
+                                          static_cast<size_t> ((*solidRanges)[i + 1]));
+      }
+    }
+  };
+
+  // returns the angle at corner c of the triangle (p, c, n)
+  template <class TNumberContainer, typename index_t>
+  double CornerAngle (const TNumberContainer& coords,
+                      const index_t p, const index_t c, const index_t n)
+  {
+    double a[3], b[3];
+    for(size_t i = 0; i < 3; ++i){
+      a[i] = static_cast<double> (coords[p * 3 + i]) - static_cast<double> (coords[c * 3 + i]);
+      b[i] = static_cast<double> (coords[n * 3 + i]) - static_cast<double> (coords[c * 3 + i]);
+    }
+    const double dot = a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+    const double cross[3] = {a[1] * b[2] - a[2] * b[1],
+                             a[2] * b[0] - a[0] * b[2],
+                             a[0] * b[1] - a[1] * b[0]};
+    const double crossLen = sqrt (cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]);
+    return atan2 (crossLen, dot);
+  }
+
+  // writes the normalized normal of the triangle (v0, v1, v2) to normalOut
+  template <class TNumberContainer, typename index_t, typename normal_t>
+  void ComputeTriNormal (const TNumberContainer& coords,
+                         const index_t v0, const index_t v1, const index_t v2,
+                         normal_t* normalOut)
+  {
+    double a[3], b[3];
+    for(size_t i = 0; i < 3; ++i){
+      a[i] = static_cast<double> (coords[v1 * 3 + i]) - static_cast<double> (coords[v0 * 3 + i]);
+      b[i] = static_cast<double> (coords[v2 * 3 + i]) - static_cast<double> (coords[v0 * 3 + i]);
+    }
+    double n[3] = {a[1] * b[2] - a[2] * b[1],
+                   a[2] * b[0] - a[0] * b[2],
+                   a[0] * b[1] - a[1] * b[0]};
+    const double len = sqrt (n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    for(size_t i = 0; i < 3; ++i)
+      normalOut[i] = static_cast<normal_t> (len > 0 ? n[i] / len : 0);
+  }
+
+  // triangulates the closed polygon 'loop' by repeatedly cutting off the corner
+  // with the smallest angle. The orientation of new triangles follows the
+  // order of the loop.
+  template <class TNumberContainer, typename index_t>
+  void TriangulateLoop (const TNumberContainer& coords,
+                        std::vector <index_t> loop,
+                        std::vector <index_t>& trisOut)
+  {
+    while(loop.size() > 3){
+      const size_t n = loop.size();
+      size_t best = 0;
+      double bestAngle = 0;
+      for(size_t i = 0; i < n; ++i){
+        const double angle = CornerAngle (coords, loop[(i + n - 1) % n],
+                                          loop[i], loop[(i + 1) % n]);
+        if(i == 0 || angle < bestAngle){
+          best = i;
+          bestAngle = angle;
+        }
+      }
+
+      trisOut.push_back (loop[(best + n - 1) % n]);
+      trisOut.push_back (loop[best]);
+      trisOut.push_back (loop[(best + 1) % n]);
+      loop.erase (loop.begin() + best);
+    }
+
+    if(loop.size() == 3)
+      trisOut.insert (trisOut.end(), loop.begin(), loop.end());
+  }
+
+  // A bounding volume hierarchy over the triangles of a mesh. Boxes are stored
+  // as (lo, hi). For inner nodes, 'first' and 'second' are the indices of the
+  // children. For leaves, the triangles are 'items[first, first + count)'.
+  class TriangleBvh {
+  public:
+    struct Node {
+      double box[6];
+      size_t first;
+      size_t count;
+      size_t second;
+    };
+
+    template <class TNumberContainer, class TIndexContainer>
+    void build (const TNumberContainer& coords, const TIndexContainer& tris)
+    {
+      const size_t numTris = tris.size() / 3;
+      triBoxes.resize (numTris * 6);
+      std::vector <double> centers (numTris * 3);
+      items.resize (numTris);
+      nodes.clear();
+
+      for(size_t itri = 0; itri < numTris; ++itri){
+        double* box = &triBoxes[itri * 6];
+        for(size_t icorner = 0; icorner < 3; ++icorner){
+          for(size_t i = 0; i < 3; ++i){
+            const double c = static_cast<double> (coords[tris[itri * 3 + icorner] * 3 + i]);
+            box[i] = icorner == 0 ? c : std::min (box[i], c);
+            box[3 + i] = icorner == 0 ? c : std::max (box[3 + i], c);
+          }
+        }
+        for(size_t i = 0; i < 3; ++i)
+          centers[itri * 3 + i] = 0.5 * (box[i] + box[3 + i]);
+        items[itri] = itri;
+      }
+
+      if(numTris > 0)
+        build_node (0, numTris, centers);
+    }
+
+    bool empty () const {return nodes.empty();}
+
+    // returns true if the boxes 'a' and 'b' (lo, hi) overlap
+    static bool overlaps (const double* a, const double* b)
+    {
+      for(size_t i = 0; i < 3; ++i){
+        if(a[i] > b[3 + i] || b[i] > a[3 + i])
+          return false;
+      }
+      return true;
+    }
+
+    // appends the indices of all triangles whose boxes overlap 'box' to 'trisOut'
+    void query_box (const double* box,
+                    std::vector <size_t>& trisOut,
+                    std::vector <size_t>& stack) const
+    {
+      if(nodes.empty())
+        return;
+      stack.clear();
+      stack.push_back (0);
+      while(!stack.empty()){
+        const Node& node = nodes[stack.back()];
+        stack.pop_back();
+        if(!overlaps (box, node.box))
+          continue;
+        if(node.count > 0){
+          for(size_t i = node.first; i < node.first + node.count; ++i){
+            if(overlaps (box, &triBoxes[items[i] * 6]))
+              trisOut.push_back (items[i]);
+          }
+        }
+        else{
+          stack.push_back (node.first);
+          stack.push_back (node.second);
+        }
+      }
+    }
+
+    const double* tri_box (const size_t itri) const {return &triBoxes[itri * 6];}
+
+    std::vector <Node>    nodes;
+    std::vector <size_t>  items;
+    std::vector <double>  triBoxes;
+
+  private:
+    struct CenterLess {
+      const double* centers;
+      size_t        axis;
+      bool operator () (const size_t a, const size_t b) const
+      {
+        return centers[a * 3 + axis] < centers[b * 3 + axis];
+      }
+    };
+
+    size_t build_node (const size_t begin, const size_t end,
+                       const std::vector <double>& centers)
+    {
+      const size_t inode = nodes.size();
+      nodes.push_back (Node());
+      double cLo[3], cHi[3];
+      for(size_t i = 0; i < 3; ++i){
+        nodes[inode].box[i] = cLo[i] = std::numeric_limits<double>::max();
+        nodes[inode].box[3 + i] = cHi[i] = -std::numeric_limits<double>::max();
+      }
+
+      for(size_t j = begin; j < end; ++j){
+        const double* box = &triBoxes[items[j] * 6];
+        const double* center = &centers[items[j] * 3];
+        for(size_t i = 0; i < 3; ++i){
+          nodes[inode].box[i] = std::min (nodes[inode].box[i], box[i]);
+          nodes[inode].box[3 + i] = std::max (nodes[inode].box[3 + i], box[3 + i]);
+          cLo[i] = std::min (cLo[i], center[i]);
+          cHi[i] = std::max (cHi[i], center[i]);
+        }
+      }
+
+      const size_t maxLeafSize = 4;
+      size_t axis = 0;
+      for(size_t i = 1; i < 3; ++i){
+        if(cHi[i] - cLo[i] > cHi[axis] - cLo[axis])
+          axis = i;
+      }
+
+      if(end - begin <= maxLeafSize || cHi[axis] == cLo[axis]){
+        nodes[inode].first = begin;
+        nodes[inode].count = end - begin;
+        nodes[inode].second = 0;
+        return inode;
+      }
+
+    //  split at the median of the triangle centers along the largest extent
+      const size_t mid = begin + (end - begin) / 2;
+      CenterLess less;
+      less.centers = &centers[0];
+      less.axis = axis;
+      std::nth_element (items.begin() + begin, items.begin() + mid,
+                        items.begin() + end, less);
+
+    //  'nodes' grows during the recursion, so references into it must not be
+    //  held across the calls.
+      const size_t first = build_node (begin, mid, centers);
+      const size_t second = build_node (mid, end, centers);
+      nodes[inode].count = 0;
+      nodes[inode].first = first;
+      nodes[inode].second = second;
+      return inode;
+    }
+  };
+
+  // computes the interval in which a triangle intersects the line of
+  // intersection of the planes of two triangles. Returns false if the triangle
+  // lies in the plane of the other triangle.
+  inline bool TriLineInterval (const double vv0, const double vv1, const double vv2,
+                               const double d0, const double d1, const double d2,
+                               double& isect0, double& isect1)
+  {
+    double a, b, c, da, db, dc;
+    if(d0 * d1 > 0){
+      a = vv2; b = vv0; c = vv1; da = d2; db = d0; dc = d1;
+    }
+    else if(d0 * d2 > 0){
+      a = vv1; b = vv0; c = vv2; da = d1; db = d0; dc = d2;
+    }
+    else if(d1 * d2 > 0 || d0 != 0){
+      a = vv0; b = vv1; c = vv2; da = d0; db = d1; dc = d2;
+    }
+    else if(d1 != 0){
+      a = vv1; b = vv0; c = vv2; da = d1; db = d0; dc = d2;
+    }
+    else if(d2 != 0){
+      a = vv2; b = vv0; c = vv1; da = d2; db = d0; dc = d1;
+    }
+    else
+      return false;
+
+    isect0 = a + (b - a) * da / (da - db);
+    isect1 = a + (c - a) * da / (da - dc);
+    if(isect0 > isect1)
+      std::swap (isect0, isect1);
+    return true;
+  }
+
+  // returns true if the 2d segments (a0, a1) and (b0, b1) intersect
+  inline bool SegmentsIntersect2d (const double* a0, const double* a1,
+                                   const double* b0, const double* b1)
+  {
+    const double d1 = (b1[0] - b0[0]) * (a0[1] - b0[1]) - (b1[1] - b0[1]) * (a0[0] - b0[0]);
+    const double d2 = (b1[0] - b0[0]) * (a1[1] - b0[1]) - (b1[1] - b0[1]) * (a1[0] - b0[0]);
+    const double d3 = (a1[0] - a0[0]) * (b0[1] - a0[1]) - (a1[1] - a0[1]) * (b0[0] - a0[0]);
+    const double d4 = (a1[0] - a0[0]) * (b1[1] - a0[1]) - (a1[1] - a0[1]) * (b1[0] - a0[0]);
+    if(((d1 > 0 && d2 < 0) || (d1 < 0 && d2 > 0)) &&
+       ((d3 > 0 && d4 < 0) || (d3 < 0 && d4 > 0)))
+    {
+      return true;
+    }
+
+  //  collinear configurations
+    const double* pts[4] = {a0, a1, b0, b1};
+    const double ds[4] = {d3, d4, d1, d2};
+    for(size_t i = 0; i < 4; ++i){
+      if(ds[i] != 0)
+        continue;
+      const double* p = pts[i < 2 ? i + 2 : i - 2];
+      const double* s0 = i < 2 ? a0 : b0;
+      const double* s1 = i < 2 ? a1 : b1;
+      if(std::min (s0[0], s1[0]) <= p[0] && p[0] <= std::max (s0[0], s1[0]) &&
+         std::min (s0[1], s1[1]) <= p[1] && p[1] <= std::max (s0[1], s1[1]))
+      {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // returns true if the 2d point p lies inside or on the triangle (t0, t1, t2)
+  inline bool PointInTri2d (const double* p, const double* t0,
+                            const double* t1, const double* t2)
+  {
+    const double* t[3] = {t0, t1, t2};
+    bool hasPos = false, hasNeg = false;
+    for(size_t i = 0; i < 3; ++i){
+      const double* a = t[i];
+      const double* b = t[(i + 1) % 3];
+      const double d = (b[0] - a[0]) * (p[1] - a[1]) - (b[1] - a[1]) * (p[0] - a[0]);
+      hasPos |= d > 0;
+      hasNeg |= d < 0;
+    }
+    return !(hasPos && hasNeg);
+  }
+
+  // tests two coplanar triangles for intersection by projecting them onto the
+  // coordinate plane in which the common normal n has its largest extent.
+  inline bool CoplanarTrisIntersect (const double* n, const double* const* v,
+                                     const double* const* u)
+  {
+    size_t i0 = 1, i1 = 2;
+    if(fabs (n[1]) > fabs (n[0]) && fabs (n[1]) >= fabs (n[2])){
+      i0 = 0; i1 = 2;
+    }
+    else if(fabs (n[2]) > fabs (n[0]) && fabs (n[2]) > fabs (n[1])){
+      i0 = 0; i1 = 1;
+    }
+
+    double pv[3][2], pu[3][2];
+    for(size_t i = 0; i < 3; ++i){
+      pv[i][0] = v[i][i0]; pv[i][1] = v[i][i1];
+      pu[i][0] = u[i][i0]; pu[i][1] = u[i][i1];
+    }
+
+    for(size_t i = 0; i < 3; ++i){
+      for(size_t j = 0; j < 3; ++j){
+        if(SegmentsIntersect2d (pv[i], pv[(i + 1) % 3], pu[j], pu[(j + 1) % 3]))
+          return true;
+      }
+    }
+
+    return PointInTri2d (pv[0], pu[0], pu[1], pu[2]) ||
+           PointInTri2d (pu[0], pv[0], pv[1], pv[2]);
+  }
+
+  // computes the signed distances of the corners of u to the plane of v.
+  // Distances below a tolerance relative to the extent of both triangles are
+  // snapped to 0. Returns false if all corners of u lie strictly on one side.
+  inline bool PlaneDistances (const double* const* v, const double* const* u,
+                              const double scale, double* nOut, double* dOut)
+  {
+    double e1[3], e2[3];
+    for(size_t i = 0; i < 3; ++i){
+      e1[i] = v[1][i] - v[0][i];
+      e2[i] = v[2][i] - v[0][i];
+    }
+    nOut[0] = e1[1] * e2[2] - e1[2] * e2[1];
+    nOut[1] = e1[2] * e2[0] - e1[0] * e2[2];
+    nOut[2] = e1[0] * e2[1] - e1[1] * e2[0];
+    const double len = sqrt (nOut[0] * nOut[0] + nOut[1] * nOut[1] + nOut[2] * nOut[2]);
+    if(len == 0)
+      return false;
+    for(size_t i = 0; i < 3; ++i)
+      nOut[i] /= len;
+
+    const double eps = 1.e-12 * scale;
+    for(size_t j = 0; j < 3; ++j){
+      dOut[j] = nOut[0] * (u[j][0] - v[0][0]) +
+                nOut[1] * (u[j][1] - v[0][1]) +
+                nOut[2] * (u[j][2] - v[0][2]);
+      if(fabs (dOut[j]) < eps)
+        dOut[j] = 0;
+    }
+
+    return !((dOut[0] > 0 && dOut[1] > 0 && dOut[2] > 0) ||
+             (dOut[0] < 0 && dOut[1] < 0 && dOut[2] < 0));
+  }
+
+  // Triangle-triangle intersection test following T. Möller, "A Fast
+  // Triangle-Triangle Intersection Test", 1997. Degenerate triangles never
+  // intersect.
+  inline bool TrisIntersect (const double* const* v, const double* const* u)
+  {
+    double scale = 0;
+    for(size_t j = 0; j < 3; ++j){
+      for(size_t i = 0; i < 3; ++i)
+        scale = std::max (scale, std::max (fabs (v[j][i] - v[0][i]), fabs (u[j][i] - v[0][i])));
+    }
+
+    double n1[3], du[3];
+    if(!PlaneDistances (v, u, scale, n1, du))
+      return false;
+
+    double n2[3], dv[3];
+    if(!PlaneDistances (u, v, scale, n2, dv))
+      return false;
+
+    if(du[0] == 0 && du[1] == 0 && du[2] == 0)
+      return CoplanarTrisIntersect (n1, v, u);
+
+  //  project onto the largest component of the direction of the intersection line
+    const double dir[3] = {n1[1] * n2[2] - n1[2] * n2[1],
+                           n1[2] * n2[0] - n1[0] * n2[2],
+                           n1[0] * n2[1] - n1[1] * n2[0]};
+    size_t axis = 0;
+    if(fabs (dir[1]) > fabs (dir[axis])) axis = 1;
+    if(fabs (dir[2]) > fabs (dir[axis])) axis = 2;
+
+    double iv0, iv1, iu0, iu1;
+    if(!TriLineInterval (v[0][axis], v[1][axis], v[2][axis], dv[0], dv[1], dv[2], iv0, iv1) ||
+       !TriLineInterval (u[0][axis], u[1][axis], u[2][axis], du[0], du[1], du[2], iu0, iu1))
+    {
+      return CoplanarTrisIntersect (n1, v, u);
+    }
+
+    return !(iv1 < iu0 || iu1 < iv0);
+  }
+
+  // loads the corner coordinates of a triangle as doubles
+  template <class TNumberContainer, class TIndexContainer>
+  void LoadTriCorners (const TNumberContainer& coords, const TIndexContainer& tris,
+                       const size_t itri, double (&cornersOut)[3][3])
+  {
+    for(size_t j = 0; j < 3; ++j){
+      for(size_t i = 0; i < 3; ++i)
+        cornersOut[j][i] = static_cast<double> (coords[tris[itri * 3 + j] * 3 + i]);
+    }
+  }
+
+  template <class TNumberContainer, class TIndexContainer>
+  struct SelfIntersectionsFunc {
+    const TNumberContainer*   coords;
+    const TIndexContainer*    tris;
+    const TriangleBvh*        bvh;
+    size_t                    grainSize;
+    std::vector <std::vector <size_t> >* pairsPerChunk;
+
+    void operator () (const size_t triBegin, const size_t triEnd)
+    {
+      std::vector <size_t>& pairs = (*pairsPerChunk)[triBegin / grainSize];
+      std::vector <size_t> candidates, stack;
+      const TIndexContainer& t = *tris;
+
+      for(size_t itri = triBegin; itri < triEnd; ++itri){
+        candidates.clear();
+        bvh->query_box (bvh->tri_box (itri), candidates, stack);
+        std::sort (candidates.begin(), candidates.end());
+
+        double v[3][3];
+        LoadTriCorners (*coords, t, itri, v);
+        const double* vp[3] = {v[0], v[1], v[2]};
+
+        for(size_t ic = 0; ic < candidates.size(); ++ic){
+          const size_t jtri = candidates[ic];
+          if(jtri <= itri)
+            continue;
+
+          bool sharesVrt = false;
+          for(size_t i = 0; i < 3 && !sharesVrt; ++i){
+            for(size_t j = 0; j < 3 && !sharesVrt; ++j)
+              sharesVrt = (t[itri * 3 + i] == t[jtri * 3 + j]);
+          }
+          if(sharesVrt)
+            continue;
+
+          double u[3][3];
+          LoadTriCorners (*coords, t, jtri, u);
+          const double* up[3] = {u[0], u[1], u[2]};
+          if(TrisIntersect (vp, up)){
+            pairs.push_back (itri);
+            pairs.push_back (jtri);
+          }
+        }
+      }
+    }
+  };
+
+  inline double Dot (const double* a, const double* b)
+  {
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+  }
+
+  // Writes the point of the triangle (a, b, c) closest to p to closestOut and
+  // returns the feature which contains it: 0, 1, 2 for the corners a, b, c,
+  // 3, 4, 5 for the edges ab, bc, ca and 6 for the interior. Follows
+  // C. Ericson, "Real-Time Collision Detection", 2004, section 5.1.5.
+  inline int ClosestPointOnTri (const double* p, const double* a,
+                                const double* b, const double* c,
+                                double* closestOut)
+  {
+    double ab[3], ac[3], ap[3], bp[3], cp[3];
+    for(size_t i = 0; i < 3; ++i){
+      ab[i] = b[i] - a[i];
+      ac[i] = c[i] - a[i];
+      ap[i] = p[i] - a[i];
+      bp[i] = p[i] - b[i];
+      cp[i] = p[i] - c[i];
+    }
+
+    const double d1 = Dot (ab, ap), d2 = Dot (ac, ap);
+    if(d1 <= 0 && d2 <= 0){
+      std::copy (a, a + 3, closestOut);
+      return 0;
+    }
+
+    const double d3 = Dot (ab, bp), d4 = Dot (ac, bp);
+    if(d3 >= 0 && d4 <= d3){
+      std::copy (b, b + 3, closestOut);
+      return 1;
+    }
+
+    const double vc = d1 * d4 - d3 * d2;
+    if(vc <= 0 && d1 >= 0 && d3 <= 0){
+      const double v = d1 / (d1 - d3);
+      for(size_t i = 0; i < 3; ++i)
+        closestOut[i] = a[i] + v * ab[i];
+      return 3;
+    }
+
+    const double d5 = Dot (ab, cp), d6 = Dot (ac, cp);
+    if(d6 >= 0 && d5 <= d6){
+      std::copy (c, c + 3, closestOut);
+      return 2;
+    }
+
+    const double vb = d5 * d2 - d1 * d6;
+    if(vb <= 0 && d2 >= 0 && d6 <= 0){
+      const double w = d2 / (d2 - d6);
+      for(size_t i = 0; i < 3; ++i)
+        closestOut[i] = a[i] + w * ac[i];
+      return 5;
+    }
+
+    const double va = d3 * d6 - d5 * d4;
+    if(va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0){
+      const double w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+      for(size_t i = 0; i < 3; ++i)
+        closestOut[i] = b[i] + w * (c[i] - b[i]);
+      return 4;
+    }
+
+    const double denom = 1. / (va + vb + vc);
+    const double v = vb * denom;
+    const double w = vc * denom;
+    for(size_t i = 0; i < 3; ++i)
+      closestOut[i] = a[i] + ab[i] * v + ac[i] * w;
+    return 6;
+  }
+
+  // returns the squared distance of p to the box (lo, hi)
+  inline double BoxDistSq (const double* p, const double* box)
+  {
+    double distSq = 0;
+    for(size_t i = 0; i < 3; ++i){
+      const double d = std::max (std::max (box[i] - p[i], p[i] - box[3 + i]), 0.);
+      distSq += d * d;
+    }
+    return distSq;
+  }
+
+  // result of a closest point query
+  struct ClosestPointHit {
+    size_t tri;
+    int    feature;
+    double distSq;
+    double point[3];
+  };
+
+  // Finds the triangle closest to p. Only triangles closer than sqrt(maxDistSq)
+  // are considered. Returns false if there is no such triangle.
+  template <class TNumberContainer, class TIndexContainer>
+  bool ClosestPoint (const TriangleBvh& bvh,
+                     const TNumberContainer& coords,
+                     const TIndexContainer& tris,
+                     const double* p,
+                     const double maxDistSq,
+                     ClosestPointHit& hitOut,
+                     std::vector <size_t>& stack)
+  {
+    hitOut.distSq = maxDistSq;
+    bool found = false;
+    if(bvh.empty())
+      return false;
+
+    stack.clear();
+    stack.push_back (0);
+    while(!stack.empty()){
+      const TriangleBvh::Node& node = bvh.nodes[stack.back()];
+      stack.pop_back();
+      if(BoxDistSq (p, node.box) >= hitOut.distSq)
+        continue;
+
+      if(node.count > 0){
+        for(size_t i = node.first; i < node.first + node.count; ++i){
+          const size_t itri = bvh.items[i];
+          if(BoxDistSq (p, bvh.tri_box (itri)) >= hitOut.distSq)
+            continue;
+          double corners[3][3];
+          LoadTriCorners (coords, tris, itri, corners);
+          double closest[3];
+          const int feature = ClosestPointOnTri (p, corners[0], corners[1], corners[2], closest);
+          const double d[3] = {p[0] - closest[0], p[1] - closest[1], p[2] - closest[2]};
+          const double distSq = Dot (d, d);
+          if(distSq < hitOut.distSq){
+            hitOut.distSq = distSq;
+            hitOut.tri = itri;
+            hitOut.feature = feature;
+            std::copy (closest, closest + 3, hitOut.point);
+            found = true;
+          }
+        }
+      }
+      else{
+      //  visit the closer child first
+        const double d0 = BoxDistSq (p, bvh.nodes[node.first].box);
+        const double d1 = BoxDistSq (p, bvh.nodes[node.second].box);
+        if(d0 < d1){
+          stack.push_back (node.second);
+          stack.push_back (node.first);
+        }
+        else{
+          stack.push_back (node.first);
+          stack.push_back (node.second);
+        }
+      }
+    }
+    return found;
+  }
+
+  // Angle weighted pseudonormals of the faces, edges and vertices of a mesh.
+  // 'edgeNormals' holds 3 normals for each triangle, one for each edge
+  // (corner i, corner i+1).
+  struct Pseudonormals {
+    std::vector <double> faceNormals;
+    std::vector <double> edgeNormals;
+    std::vector <double> vrtNormals;
+
+    template <class TNumberContainer, class TIndexContainer>
+    void compute (const TNumberContainer& coords, const TIndexContainer& tris)
+    {
+      typedef typename TIndexContainer::value_type index_t;
+
+      const size_t numTris = tris.size() / 3;
+      faceNormals.resize (numTris * 3);
+      edgeNormals.assign (numTris * 9, 0);
+      vrtNormals.assign (coords.size(), 0);
+
+      for(size_t itri = 0; itri < numTris; ++itri){
+        const index_t* t = &tris[itri * 3];
+        double* n = &faceNormals[itri * 3];
+        ComputeTriNormal (coords, t[0], t[1], t[2], n);
+        for(size_t i = 0; i < 3; ++i){
+          const double angle = CornerAngle (coords, t[(i + 2) % 3], t[i], t[(i + 1) % 3]);
+          for(size_t j = 0; j < 3; ++j)
+            vrtNormals[t[i] * 3 + j] += angle * n[j];
+        }
+      }
+
+      std::vector <EdgeWithTri <index_t> > edges;
+      CollectSortedEdges (tris, edges);
+      for(size_t i = 0; i < edges.size();){
+        size_t j = i + 1;
+        while(j < edges.size() && edges[j].same_edge (edges[i]))
+          ++j;
+
+        double sum[3] = {0, 0, 0};
+        for(size_t k = i; k < j; ++k){
+          for(size_t l = 0; l < 3; ++l)
+            sum[l] += faceNormals[edges[k].tri * 3 + l];
+        }
+
+        for(size_t k = i; k < j; ++k){
+          const index_t itri = edges[k].tri;
+          const size_t iedge = CornerOfVrt (tris, itri, edges[k].vrt[edges[k].reversed ? 1 : 0]);
+          std::copy (sum, sum + 3, &edgeNormals[(itri * 3 + iedge) * 3]);
+        }
+        i = j;
+      }
+    }
+
+    // returns the pseudonormal of the given feature of a triangle, as
+    // returned by ClosestPointOnTri.
+    template <class TIndexContainer>
+    const double* normal (const TIndexContainer& tris, const size_t itri, const int feature) const
+    {
+      if(feature < 3)
+        return &vrtNormals[tris[itri * 3 + feature] * 3];
+      if(feature < 6)
+        return &edgeNormals[(itri * 3 + (feature - 3)) * 3];
+      return &faceNormals[itri * 3];
+    }
+  };
+
+  // computes the signed distances of the samples in a range of sdf blocks.
+  // In a first pass ('computeValues == false') it only classifies blocks as
+  // inside or outside the narrow band, in a second pass the values of
+  // allocated blocks are computed.
+  template <class TNumberContainer, class TIndexContainer, class TNumber>
+  struct SdfBlocksFunc {
+    const TNumberContainer* coords;
+    const TIndexContainer*  tris;
+    const TriangleBvh*      bvh;
+    const Pseudonormals*    pseudonormals;
+    const double*           origin;
+    double                  spacing;
+    double                  bandWidth;
+    const size_t*           numSamples;
+    const size_t*           numBlocks;
+    size_t                  blockSize;
+    bool                    computeValues;
+    std::vector <long long>*    blockOffsets;
+    std::vector <signed char>*  blockSigns;
+    std::vector <TNumber>*      values;
+
+    double signed_distance (const double* p, std::vector <size_t>& stack) const
+    {
+      ClosestPointHit hit;
+      if(!ClosestPoint (*bvh, *coords, *tris, p, std::numeric_limits<double>::infinity(), hit, stack))
+        return std::numeric_limits<double>::infinity();
+      const double* n = pseudonormals->normal (*tris, hit.tri, hit.feature);
+      const double d[3] = {p[0] - hit.point[0], p[1] - hit.point[1], p[2] - hit.point[2]};
+      const double dist = sqrt (hit.distSq);
+      return Dot (d, n) < 0 ? -dist : dist;
+    }
+
+    void operator () (const size_t blockBegin, const size_t blockEnd)
+    {
+      std::vector <size_t> stack;
+      for(size_t iblock = blockBegin; iblock < blockEnd; ++iblock){
+        const size_t b[3] = {iblock % numBlocks[0],
+                             (iblock / numBlocks[0]) % numBlocks[1],
+                             iblock / (numBlocks[0] * numBlocks[1])};
+        if(!computeValues){
+          double center[3];
+          for(size_t i = 0; i < 3; ++i)
+            center[i] = origin[i] + spacing * (static_cast<double> (b[i] * blockSize) + 0.5 * static_cast<double> (blockSize - 1));
+          const double halfDiag = 0.5 * sqrt (3.) * spacing * static_cast<double> (blockSize - 1);
+          const double dist = signed_distance (center, stack);
+          (*blockSigns)[iblock] = dist < 0 ? -1 : 1;
+          (*blockOffsets)[iblock] = fabs (dist) - halfDiag < bandWidth ? 1 : -1;
+          continue;
+        }
+
+        if((*blockOffsets)[iblock] < 0)
+          continue;
+
+        TNumber* blockValues = &(*values)[(*blockOffsets)[iblock]];
+        for(size_t k = 0; k < blockSize; ++k){
+          for(size_t j = 0; j < blockSize; ++j){
+            for(size_t i = 0; i < blockSize; ++i){
+              const size_t s[3] = {b[0] * blockSize + i, b[1] * blockSize + j, b[2] * blockSize + k};
+              double dist = bandWidth;
+              if(s[0] < numSamples[0] && s[1] < numSamples[1] && s[2] < numSamples[2]){
+                double p[3];
+                for(size_t d = 0; d < 3; ++d)
+                  p[d] = origin[d] + spacing * static_cast<double> (s[d]);
+                dist = std::max (-bandWidth, std::min (bandWidth, signed_distance (p, stack)));
+              }
+              blockValues[(k * blockSize + j) * blockSize + i] = static_cast<TNumber> (dist);
+            }
+          }
+        }
+      }
+    }
+  };
+
+  // returns a pseudo random number in [0, 1) for the given seed and counter.
+  // The counter is scrambled with the SplitMix64 finalizer, which yields a
+  // counter-based generator with good statistical quality.
+  inline double CounterRandom (const unsigned long long seed,
+                               const unsigned long long counter)
+  {
+    unsigned long long z = seed + (counter + 1) * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z = z ^ (z >> 31);
+    return static_cast<double> (z >> 11) * (1. / 9007199254740992.);
+  }
+
+  template <class TNumberContainer, class TIndexContainer, class TNumber>
+  struct SurfaceSampleFunc {
+    const TNumberContainer*     coords;
+    const TIndexContainer*      tris;
+    const std::vector <double>* areaCdf;
+    size_t                      first;
+    unsigned long long          seed;
+    SurfaceSamples <TNumber>*   samples;
+
+    void operator () (const size_t begin, const size_t end)
+    {
+      const std::vector <double>& cdf = *areaCdf;
+      SurfaceSamples <TNumber>& s = *samples;
+      for(size_t i = begin; i < end; ++i){
+        const unsigned long long counter = 3 * static_cast<unsigned long long> (first + i);
+        const double target = CounterRandom (seed, counter) * cdf.back();
+        const size_t itri = std::min<size_t> (
+              std::upper_bound (cdf.begin(), cdf.end(), target) - cdf.begin(),
+              cdf.size() - 1);
+
+        const double r1 = sqrt (CounterRandom (seed, counter + 1));
+        const double r2 = CounterRandom (seed, counter + 2);
+        const double w[3] = {1 - r1, r1 * (1 - r2), r1 * r2};
+
+        double corners[3][3];
+        LoadTriCorners (*coords, *tris, itri, corners);
+        double p[3];
+        for(size_t d = 0; d < 3; ++d)
+          p[d] = w[0] * corners[0][d] + w[1] * corners[1][d] + w[2] * corners[2][d];
+
+        double n[3];
+        ComputeTriNormal (*coords, (*tris)[itri * 3], (*tris)[itri * 3 + 1],
+                          (*tris)[itri * 3 + 2], n);
+
+        s.x[i] = static_cast<TNumber> (p[0]);
+        s.y[i] = static_cast<TNumber> (p[1]);
+        s.z[i] = static_cast<TNumber> (p[2]);
+        s.nx[i] = static_cast<TNumber> (n[0]);
+        s.ny[i] = static_cast<TNumber> (n[1]);
+        s.nz[i] = static_cast<TNumber> (n[2]);
+        s.tris[i] = itri;
+      }
+    }
+  };
+
+  // hashes integer grid cell coordinates
+  inline size_t CellHash (const long long i, const long long j, const long long k)
+  {
+    const unsigned long long h = static_cast<unsigned long long> (i) * 73856093ULL ^
+                                 static_cast<unsigned long long> (j) * 19349663ULL ^
+                                 static_cast<unsigned long long> (k) * 83492791ULL;
+    return static_cast<size_t> (h ^ (h >> 29));
+  }
+
+  // A face of a convex hull under construction. 'nbrs[i]' is the face across
+  // the edge (v[i], v[i+1]). Points in 'outside' lie in front of the face.
+  struct HullFace {
+    size_t v[3];
+    size_t nbrs[3];
+    double normal[3];
+    double offset;
+    bool   alive;
+    std::vector <size_t> outside;
+
+    double distance (const double* p) const
+    {
+      return Dot (normal, p) - offset;
+    }
+  };
+
+  // Incremental construction of a 3d convex hull following Barber, Dobkin
+  // and Huhdanpaa, "The Quickhull Algorithm for Convex Hulls", 1996.
+  class QuickHull {
+  public:
+    QuickHull (const std::vector <double>& points, const double eps) :
+      m_pts (points),
+      m_eps (eps)
+    {}
+
+    // creates the initial tetrahedron. Returns false if all points are coplanar.
+    bool init (size_t* tetOut)
+    {
+      const size_t n = m_pts.size() / 3;
+      if(n < 4)
+        return false;
+
+    //  two extreme points along one of the coordinate axes
+      size_t ext[6] = {0, 0, 0, 0, 0, 0};
+      for(size_t i = 1; i < n; ++i){
+        for(size_t d = 0; d < 3; ++d){
+          if(pt (i)[d] < pt (ext[d])[d]) ext[d] = i;
+          if(pt (i)[d] > pt (ext[3 + d])[d]) ext[3 + d] = i;
+        }
+      }
+      size_t axis = 0;
+      for(size_t d = 1; d < 3; ++d){
+        if(pt (ext[3 + d])[d] - pt (ext[d])[d] > pt (ext[3 + axis])[axis] - pt (ext[axis])[axis])
+          axis = d;
+      }
+      tetOut[0] = ext[axis];
+      tetOut[1] = ext[3 + axis];
+      if(dist_sq (tetOut[0], tetOut[1]) <= m_eps * m_eps)
+        return false;
+
+    //  the point farthest from the line through the first two points
+      double dir[3], best = 0;
+      for(size_t d = 0; d < 3; ++d)
+        dir[d] = pt (tetOut[1])[d] - pt (tetOut[0])[d];
+      tetOut[2] = tetOut[0];
+      for(size_t i = 0; i < n; ++i){
+        double a[3];
+        for(size_t d = 0; d < 3; ++d)
+          a[d] = pt (i)[d] - pt (tetOut[0])[d];
+        const double c[3] = {a[1] * dir[2] - a[2] * dir[1],
+                             a[2] * dir[0] - a[0] * dir[2],
+                             a[0] * dir[1] - a[1] * dir[0]};
+        if(Dot (c, c) > best){
+          best = Dot (c, c);
+          tetOut[2] = i;
+        }
+      }
+      if(best <= m_eps * m_eps * Dot (dir, dir))
+        return false;
+
+    //  the point farthest from the plane through the first three points
+      HullFace f;
+      make_plane (tetOut[0], tetOut[1], tetOut[2], f);
+      best = 0;
+      tetOut[3] = tetOut[0];
+      for(size_t i = 0; i < n; ++i){
+        if(fabs (f.distance (pt (i))) > best){
+          best = fabs (f.distance (pt (i)));
+          tetOut[3] = i;
+        }
+      }
+      if(best <= m_eps)
+        return false;
+
+    //  orient the tetrahedron such that its faces point outwards
+      if(f.distance (pt (tetOut[3])) > 0)
+        std::swap (tetOut[1], tetOut[2]);
+
+      const size_t* t = tetOut;
+      const size_t faceVrts[4][3] = {{t[0], t[1], t[2]}, {t[0], t[3], t[1]},
+                                     {t[1], t[3], t[2]}, {t[2], t[3], t[0]}};
+      m_faces.resize (4);
+      for(size_t i = 0; i < 4; ++i)
+        make_plane (faceVrts[i][0], faceVrts[i][1], faceVrts[i][2], m_faces[i]);
+
+      for(size_t i = 0; i < 4; ++i){
+        for(size_t j = 0; j < 3; ++j)
+          m_faces[i].nbrs[j] = find_face_with_edge (m_faces[i].v[(j + 1) % 3], m_faces[i].v[j]);
+      }
+      return true;
+    }
+
+    // adds point i to the outside set of the first initial face it lies in front of
+    void assign_initial (const size_t i, std::vector <size_t>& faceOfPointOut) const
+    {
+      faceOfPointOut[i] = m_faces.size();
+      for(size_t f = 0; f < m_faces.size(); ++f){
+        if(m_faces[f].distance (pt (i)) > m_eps){
+          faceOfPointOut[i] = f;
+          return;
+        }
+      }
+    }
+
+    void set_outside (const std::vector <size_t>& faceOfPoint)
+    {
+      for(size_t i = 0; i < faceOfPoint.size(); ++i){
+        if(faceOfPoint[i] < m_faces.size())
+          m_faces[faceOfPoint[i]].outside.push_back (i);
+      }
+    }
+
+    // adds points until all outside sets are empty
+    void run ()
+    {
+      std::vector <size_t> visible, horizonA, horizonB, horizonNbr, stack;
+      std::vector <char> isVisible;
+      std::vector <size_t> startOf, endOf;
+      std::vector <size_t> orphans;
+
+      for(size_t iface = 0; iface < m_faces.size(); ++iface){
+        if(!m_faces[iface].alive || m_faces[iface].outside.empty())
+          continue;
+
+      //  the farthest outside point becomes the eye point
+        const std::vector <size_t>& outside = m_faces[iface].outside;
+        size_t eye = outside[0];
+        double bestDist = -1;
+        for(size_t i = 0; i < outside.size(); ++i){
+          const double d = m_faces[iface].distance (pt (outside[i]));
+          if(d > bestDist){
+            bestDist = d;
+            eye = outside[i];
+          }
+        }
+
+      //  collect faces visible from the eye and the horizon edges
+        visible.clear();
+        horizonA.clear();
+        horizonB.clear();
+        horizonNbr.clear();
+        isVisible.resize (m_faces.size(), 0);
+        stack.clear();
+        stack.push_back (iface);
+        isVisible[iface] = 1;
+        while(!stack.empty()){
+          const size_t f = stack.back();
+          stack.pop_back();
+          visible.push_back (f);
+          for(size_t j = 0; j < 3; ++j){
+            const size_t nbr = m_faces[f].nbrs[j];
+            if(isVisible[nbr])
+              continue;
+            if(m_faces[nbr].distance (pt (eye)) > m_eps){
+              isVisible[nbr] = 1;
+              stack.push_back (nbr);
+            }
+            else{
+              horizonA.push_back (m_faces[f].v[j]);
+              horizonB.push_back (m_faces[f].v[(j + 1) % 3]);
+              horizonNbr.push_back (nbr);
+            }
+          }
+        }
+
+      //  create a new face for each horizon edge and link it to its neighbors.
+      //  The horizon is a closed loop, so each vertex starts and ends one edge.
+        const size_t firstNew = m_faces.size();
+        startOf.resize (m_pts.size() / 3, 0);
+        endOf.resize (m_pts.size() / 3, 0);
+        for(size_t i = 0; i < horizonA.size(); ++i){
+          m_faces.push_back (HullFace());
+          HullFace& nf = m_faces.back();
+          make_plane (horizonA[i], horizonB[i], eye, nf);
+          nf.nbrs[0] = horizonNbr[i];
+          startOf[horizonA[i]] = firstNew + i;
+
+          HullFace& nbr = m_faces[horizonNbr[i]];
+          for(size_t j = 0; j < 3; ++j){
+            if(nbr.v[j] == horizonB[i] && nbr.v[(j + 1) % 3] == horizonA[i])
+              nbr.nbrs[j] = firstNew + i;
+          }
+        }
+        for(size_t i = firstNew; i < m_faces.size(); ++i)
+          endOf[m_faces[i].v[1]] = i;
+        for(size_t i = firstNew; i < m_faces.size(); ++i){
+          m_faces[i].nbrs[1] = startOf[m_faces[i].v[1]];
+          m_faces[i].nbrs[2] = endOf[m_faces[i].v[0]];
+        }
+        isVisible.resize (m_faces.size(), 0);
+
+      //  reassign the outside points of the visible faces
+        orphans.clear();
+        for(size_t i = 0; i < visible.size(); ++i){
+          HullFace& f = m_faces[visible[i]];
+          f.alive = false;
+          orphans.insert (orphans.end(), f.outside.begin(), f.outside.end());
+          std::vector <size_t>().swap (f.outside);
+        }
+        for(size_t i = 0; i < orphans.size(); ++i){
+          if(orphans[i] == eye)
+            continue;
+          for(size_t f = firstNew; f < m_faces.size(); ++f){
+            if(m_faces[f].distance (pt (orphans[i])) > m_eps){
+              m_faces[f].outside.push_back (orphans[i]);
+              break;
+            }
+          }
+        }
+      }
+    }
+
+    const std::vector <HullFace>& faces () const {return m_faces;}
+
+  private:
+    const double* pt (const size_t i) const {return &m_pts[i * 3];}
+
+    double dist_sq (const size_t a, const size_t b) const
+    {
+      const double d[3] = {pt (a)[0] - pt (b)[0], pt (a)[1] - pt (b)[1], pt (a)[2] - pt (b)[2]};
+      return Dot (d, d);
+    }
+
+    void make_plane (const size_t a, const size_t b, const size_t c, HullFace& f) const
+    {
+      f.v[0] = a; f.v[1] = b; f.v[2] = c;
+      f.alive = true;
+      ComputeTriNormal (m_pts, a, b, c, f.normal);
+      f.offset = Dot (f.normal, pt (a));
+    }
+
+    size_t find_face_with_edge (const size_t a, const size_t b) const
+    {
+      for(size_t i = 0; i < m_faces.size(); ++i){
+        for(size_t j = 0; j < 3; ++j){
+          if(m_faces[i].v[j] == a && m_faces[i].v[(j + 1) % 3] == b)
+            return i;
+        }
+      }
+      return 0;
+    }
+
+    const std::vector <double>& m_pts;
+    double                      m_eps;
+    std::vector <HullFace>      m_faces;
+  };
+
+  struct HullAssignFunc {
+    const QuickHull*      hull;
+    std::vector <size_t>* faceOfPoint;
+
+    void operator () (const size_t begin, const size_t end)
+    {
+      for(size_t i = begin; i < end; ++i)
+        hull->assign_initial (i, *faceOfPoint);
+    }
+  };
+
+  // Computes eigenvalues and eigenvectors of the symmetric 3x3 matrix 'a' with
+  // the cyclic Jacobi method. On return, the columns of 'vecsOut' hold the
+  // eigenvectors.
+  inline void SymmetricEigen3 (double (&a)[3][3], double (&valsOut)[3], double (&vecsOut)[3][3])
+  {
+    for(size_t i = 0; i < 3; ++i){
+      for(size_t j = 0; j < 3; ++j)
+        vecsOut[i][j] = (i == j) ? 1 : 0;
+    }
+
+    for(size_t sweep = 0; sweep < 50; ++sweep){
+      const double offDiag = fabs (a[0][1]) + fabs (a[0][2]) + fabs (a[1][2]);
+      const double diag = fabs (a[0][0]) + fabs (a[1][1]) + fabs (a[2][2]);
+      if(offDiag <= 1.e-15 * diag || offDiag == 0)
+        break;
+
+      for(size_t p = 0; p < 2; ++p){
+        for(size_t q = p + 1; q < 3; ++q){
+          if(a[p][q] == 0)
+            continue;
+          const double theta = (a[q][q] - a[p][p]) / (2 * a[p][q]);
+          const double t = (theta >= 0 ? 1. : -1.) / (fabs (theta) + sqrt (theta * theta + 1));
+          const double c = 1 / sqrt (t * t + 1);
+          const double s = t * c;
+          for(size_t k = 0; k < 3; ++k){
+            const double akp = a[k][p], akq = a[k][q];
+            a[k][p] = c * akp - s * akq;
+            a[k][q] = s * akp + c * akq;
+          }
+          for(size_t k = 0; k < 3; ++k){
+            const double apk = a[p][k], aqk = a[q][k];
+            a[p][k] = c * apk - s * aqk;
+            a[q][k] = s * apk + c * aqk;
+          }
+          for(size_t k = 0; k < 3; ++k){
+            const double vkp = vecsOut[k][p], vkq = vecsOut[k][q];
+            vecsOut[k][p] = c * vkp - s * vkq;
+            vecsOut[k][q] = s * vkp + c * vkq;
+          }
+        }
+      }
+    }
+
+    for(size_t i = 0; i < 3; ++i)
+      valsOut[i] = a[i][i];
+  }
+
+  inline void Cross (const double* a, const double* b, double* out)
+  {
+    out[0] = a[1] * b[2] - a[2] * b[1];
+    out[1] = a[2] * b[0] - a[0] * b[2];
+    out[2] = a[0] * b[1] - a[1] * b[0];
+  }
+
+  // computes the extents of 'points' along the rows of 'axes' and writes the
+  // resulting box. Returns its volume.
+  inline double FitBoxToAxes (const std::vector <double>& points,
+                              const double (&axes)[3][3],
+                              OrientedBox& boxOut)
+  {
+    double lo[3], hi[3];
+    for(size_t k = 0; k < 3; ++k){
+      lo[k] = std::numeric_limits<double>::max();
+      hi[k] = -std::numeric_limits<double>::max();
+    }
+    for(size_t i = 0; i < points.size(); i += 3){
+      for(size_t k = 0; k < 3; ++k){
+        const double d = Dot (axes[k], &points[i]);
+        lo[k] = std::min (lo[k], d);
+        hi[k] = std::max (hi[k], d);
+      }
+    }
+
+    for(size_t d = 0; d < 3; ++d)
+      boxOut.center[d] = 0;
+    for(size_t k = 0; k < 3; ++k){
+      boxOut.halfExtents[k] = 0.5 * (hi[k] - lo[k]);
+      for(size_t d = 0; d < 3; ++d){
+        boxOut.axes[k][d] = axes[k][d];
+        boxOut.center[d] += 0.5 * (hi[k] + lo[k]) * axes[k][d];
+      }
+    }
+    return boxOut.volume();
+  }
+
+  inline double Cross2d (const std::pair <double, double>& o,
+                         const std::pair <double, double>& a,
+                         const std::pair <double, double>& b)
+  {
+    return (a.first - o.first) * (b.second - o.second) -
+           (a.second - o.second) * (b.first - o.first);
+  }
+
+  // returns the direction (cos, sin) of the side of the minimal area rectangle
+  // enclosing the 2d points 'xy', by testing the directions of all edges of
+  // their convex hull (Andrew's monotone chain).
+  inline void MinAreaRectDir (std::vector <std::pair <double, double> >& xy,
+                              double& cosOut, double& sinOut)
+  {
+    cosOut = 1;
+    sinOut = 0;
+    std::sort (xy.begin(), xy.end());
+    xy.erase (std::unique (xy.begin(), xy.end()), xy.end());
+    const size_t n = xy.size();
+    if(n < 3)
+      return;
+
+    std::vector <std::pair <double, double> > hull (2 * n);
+    size_t k = 0;
+    for(size_t i = 0; i < n; ++i){
+      while(k >= 2 && Cross2d (hull[k - 2], hull[k - 1], xy[i]) <= 0)
+        --k;
+      hull[k++] = xy[i];
+    }
+    for(size_t i = n - 1, lowerSize = k + 1; i > 0; --i){
+      while(k >= lowerSize && Cross2d (hull[k - 2], hull[k - 1], xy[i - 1]) <= 0)
+        --k;
+      hull[k++] = xy[i - 1];
+    }
+    hull.resize (k - 1);
+
+    double bestArea = std::numeric_limits<double>::max();
+    for(size_t i = 0; i < hull.size(); ++i){
+      const std::pair <double, double>& a = hull[i];
+      const std::pair <double, double>& b = hull[(i + 1) % hull.size()];
+      double ux = b.first - a.first, uy = b.second - a.second;
+      const double len = sqrt (ux * ux + uy * uy);
+      if(len == 0)
+        continue;
+      ux /= len;
+      uy /= len;
+
+      double lo0 = std::numeric_limits<double>::max(), hi0 = -lo0, lo1 = lo0, hi1 = -lo0;
+      for(size_t j = 0; j < hull.size(); ++j){
+        const double d0 = ux * hull[j].first + uy * hull[j].second;
+        const double d1 = -uy * hull[j].first + ux * hull[j].second;
+        lo0 = std::min (lo0, d0); hi0 = std::max (hi0, d0);
+        lo1 = std::min (lo1, d1); hi1 = std::max (hi1, d1);
+      }
+      const double area = (hi0 - lo0) * (hi1 - lo1);
+      if(area < bestArea){
+        bestArea = area;
+        cosOut = ux;
+        sinOut = uy;
+      }
+    }
+  }
+
+  // fits an oriented box to 'points' as described in ComputeOrientedBox
+  inline OrientedBox FitOrientedBox (const std::vector <double>& points)
+  {
+    OrientedBox box;
+    for(size_t i = 0; i < 3; ++i){
+      box.center[i] = box.halfExtents[i] = 0;
+      for(size_t j = 0; j < 3; ++j)
+        box.axes[i][j] = (i == j) ? 1 : 0;
+    }
+    if(points.empty())
+      return box;
+
+    std::vector <double> hullCoords, hullNormals;
+    std::vector <size_t> hullTris, hullSolids;
+    const std::vector <double>& pts =
+        ConvexHull (points, hullCoords, hullNormals, hullTris, hullSolids, 1)
+        ? hullCoords : points;
+
+  //  covariance of the points. The accumulation is written as plain loops
+  //  over independent sums, which compilers vectorize.
+    const size_t n = pts.size() / 3;
+    double mean[3] = {0, 0, 0};
+    for(size_t i = 0; i < n; ++i){
+      for(size_t d = 0; d < 3; ++d)
+        mean[d] += pts[i * 3 + d];
+    }
+    for(size_t d = 0; d < 3; ++d)
+      mean[d] /= static_cast<double> (n);
+
+    double cov[3][3] = {{0, 0, 0}, {0, 0, 0}, {0, 0, 0}};
+    for(size_t i = 0; i < n; ++i){
+      const double c[3] = {pts[i * 3] - mean[0], pts[i * 3 + 1] - mean[1], pts[i * 3 + 2] - mean[2]};
+      for(size_t j = 0; j < 3; ++j){
+        for(size_t k = 0; k < 3; ++k)
+          cov[j][k] += c[j] * c[k];
+      }
+    }
+
+    double vals[3], vecs[3][3], axes[3][3];
+    SymmetricEigen3 (cov, vals, vecs);
+    for(size_t k = 0; k < 3; ++k){
+      for(size_t d = 0; d < 3; ++d)
+        axes[k][d] = vecs[d][k];
+    }
+    Cross (axes[0], axes[1], axes[2]);
+
+    double bestVolume = FitBoxToAxes (pts, axes, box);
+
+  //  refine by rotating around each axis
+    std::vector <std::pair <double, double> > xy (n);
+    for(size_t iter = 0; iter < 4; ++iter){
+      bool improved = false;
+      for(size_t k = 0; k < 3; ++k){
+        const size_t p = (k + 1) % 3, q = (k + 2) % 3;
+        xy.resize (n);
+        for(size_t i = 0; i < n; ++i)
+          xy[i] = std::make_pair (Dot (axes[p], &pts[i * 3]), Dot (axes[q], &pts[i * 3]));
+
+        double c, s;
+        MinAreaRectDir (xy, c, s);
+        double rotated[3][3];
+        for(size_t d = 0; d < 3; ++d){
+          rotated[k][d] = axes[k][d];
+          rotated[p][d] = c * axes[p][d] + s * axes[q][d];
+          rotated[q][d] = -s * axes[p][d] + c * axes[q][d];
+        }
+
+        OrientedBox candidate;
+        const double volume = FitBoxToAxes (pts, rotated, candidate);
+        if(volume < bestVolume * (1 - 1.e-12)){
+          bestVolume = volume;
+          box = candidate;
+          std::copy (&rotated[0][0], &rotated[0][0] + 9, &axes[0][0]);
+          improved = true;
+        }
+      }
+      if(!improved)
+        break;
+    }
+
+  //  sort axes by decreasing extent and keep them right handed
+    for(size_t i = 0; i < 2; ++i){
+      for(size_t j = 0; j < 2 - i; ++j){
+        if(box.halfExtents[j] < box.halfExtents[j + 1]){
+          std::swap (box.halfExtents[j], box.halfExtents[j + 1]);
+          for(size_t d = 0; d < 3; ++d)
+            std::swap (box.axes[j][d], box.axes[j + 1][d]);
+        }
+      }
+    }
+    Cross (box.axes[0], box.axes[1], box.axes[2]);
+    return box;
+  }
+
+  template <class TNumberContainer, class TIndexContainer1, class TIndexContainer2>
+  struct SolidBoxesFunc {
+    const TNumberContainer*   coords;
+    const TIndexContainer1*   tris;
+    const TIndexContainer2*   solidRanges;
+    std::vector <OrientedBox>* boxes;
+
+    void operator () (const size_t solidBegin, const size_t solidEnd)
+    {
+      std::vector <double> points;
+      std::vector <size_t> vrts;
+      for(size_t is = solidBegin; is < solidEnd; ++is){
+        const size_t begin = static_cast<size_t> ((*solidRanges)[is]) * 3;
+        const size_t end = static_cast<size_t> ((*solidRanges)[is + 1]) * 3;
+        vrts.assign (tris->begin() + begin, tris->begin() + end);
+        std::sort (vrts.begin(), vrts.end());
+        vrts.erase (std::unique (vrts.begin(), vrts.end()), vrts.end());
+
+        points.resize (vrts.size() * 3);
+        for(size_t i = 0; i < vrts.size(); ++i){
+          for(size_t d = 0; d < 3; ++d)
+            points[i * 3 + d] = static_cast<double> ((*coords)[vrts[i] * 3 + d]);
+        }
+        (*boxes)[is] = FitOrientedBox (points);
+      }
+    }
+  };
+
+  // an oriented triangle, rotated such that its smallest corner comes first
+  struct OrientedTriKey {
+    size_t v[3];
+
+    OrientedTriKey (const size_t a, const size_t b, const size_t c)
+    {
+      if(a < b && a < c)      {v[0] = a; v[1] = b; v[2] = c;}
+      else if(b < c)          {v[0] = b; v[1] = c; v[2] = a;}
+      else                    {v[0] = c; v[1] = a; v[2] = b;}
+    }
+
+    bool operator < (const OrientedTriKey& k) const
+    {
+      if(v[0] != k.v[0]) return v[0] < k.v[0];
+      if(v[1] != k.v[1]) return v[1] < k.v[1];
+      return v[2] < k.v[2];
+    }
+  };
+
+  // the unique vertices, triangles and principal axes of a solid
+  struct SolidShape {
+    std::vector <double>          points;
+    // sorted triangles, referring to 'points'
+    std::vector <OrientedTriKey>  tris;
+    // indices of 'points', sorted by x-coordinate
+    std::vector <size_t>          byX;
+    double  center[3];
+    // principal moments (eigenvalues of the covariance matrix) in decreasing order
+    double  moments[3];
+    // corresponding principal axes as rows, right handed
+    double  axes[3][3];
+    // maximal distance of a point from 'center'
+    double  radius;
+    double  maxAbsCoord;
+  };
+
+  struct PointXLess {
+    const std::vector <double>* points;
+
+    bool operator () (const size_t i, const size_t j) const
+    {
+      return (*points)[3 * i] < (*points)[3 * j];
+    }
+
+    bool operator () (const size_t i, const double x) const
+    {
+      return (*points)[3 * i] < x;
+    }
+  };
+
+  inline double SquaredDistance (const double* a, const double* b)
+  {
+    const double d[3] = {a[0] - b[0], a[1] - b[1], a[2] - b[2]};
+    return Dot (d, d);
+  }
+
+  template <class TNumberContainer, class TIndexContainer1, class TIndexContainer2>
+  struct SolidShapesFunc {
+    const TNumberContainer*   coords;
+    const TIndexContainer1*   tris;
+    const TIndexContainer2*   solidRanges;
+    std::vector <SolidShape>* shapes;
+
+    void operator () (const size_t solidBegin, const size_t solidEnd)
+    {
+      std::vector <size_t> vrts;
+      for(size_t is = solidBegin; is < solidEnd; ++is){
+        SolidShape& shape = (*shapes)[is];
+        const size_t begin = static_cast<size_t> ((*solidRanges)[is]) * 3;
+        const size_t end = static_cast<size_t> ((*solidRanges)[is + 1]) * 3;
+        vrts.assign (tris->begin() + begin, tris->begin() + end);
+        std::sort (vrts.begin(), vrts.end());
+        vrts.erase (std::unique (vrts.begin(), vrts.end()), vrts.end());
+
+        const size_t numPoints = vrts.size();
+        shape.points.resize (numPoints * 3);
+        shape.maxAbsCoord = 0;
+        for(size_t i = 0; i < numPoints; ++i){
+          for(size_t d = 0; d < 3; ++d){
+            const double x = static_cast<double> ((*coords)[vrts[i] * 3 + d]);
+            shape.points[i * 3 + d] = x;
+            shape.maxAbsCoord = std::max (shape.maxAbsCoord, fabs (x));
+          }
+        }
+
+        shape.tris.clear();
+        shape.tris.reserve ((end - begin) / 3);
+        for(size_t i = begin; i < end; i += 3){
+          size_t c[3];
+          for(size_t k = 0; k < 3; ++k){
+            const size_t vrt = static_cast<size_t> ((*tris)[i + k]);
+            c[k] = std::lower_bound (vrts.begin(), vrts.end(), vrt) - vrts.begin();
+          }
+          shape.tris.push_back (OrientedTriKey (c[0], c[1], c[2]));
+        }
+        std::sort (shape.tris.begin(), shape.tris.end());
+
+        PointXLess less;
+        less.points = &shape.points;
+        shape.byX.resize (numPoints);
+        for(size_t i = 0; i < numPoints; ++i)
+          shape.byX[i] = i;
+        std::sort (shape.byX.begin(), shape.byX.end(), less);
+
+        double cov[3][3] = {{0, 0, 0}, {0, 0, 0}, {0, 0, 0}};
+        for(size_t d = 0; d < 3; ++d)
+          shape.center[d] = 0;
+        for(size_t i = 0; i < numPoints; ++i){
+          for(size_t d = 0; d < 3; ++d)
+            shape.center[d] += shape.points[i * 3 + d];
+        }
+        for(size_t d = 0; d < 3; ++d)
+          shape.center[d] /= static_cast<double> (std::max<size_t> (numPoints, 1));
+
+        shape.radius = 0;
+        for(size_t i = 0; i < numPoints; ++i){
+          const double* p = &shape.points[i * 3];
+          const double v[3] = {p[0] - shape.center[0], p[1] - shape.center[1], p[2] - shape.center[2]};
+          for(size_t r = 0; r < 3; ++r){
+            for(size_t c = 0; c < 3; ++c)
+              cov[r][c] += v[r] * v[c];
+          }
+          shape.radius = std::max (shape.radius, sqrt (Dot (v, v)));
+        }
+        for(size_t r = 0; r < 3; ++r){
+          for(size_t c = 0; c < 3; ++c)
+            cov[r][c] /= static_cast<double> (std::max<size_t> (numPoints, 1));
+        }
+
+        double vals[3], vecs[3][3];
+        SymmetricEigen3 (cov, vals, vecs);
+        size_t order[3] = {0, 1, 2};
+        for(size_t i = 0; i < 3; ++i){
+          for(size_t j = i + 1; j < 3; ++j){
+            if(vals[order[j]] > vals[order[i]])
+              std::swap (order[i], order[j]);
+          }
+        }
+        for(size_t k = 0; k < 3; ++k){
+          shape.moments[k] = vals[order[k]];
+          for(size_t d = 0; d < 3; ++d)
+            shape.axes[k][d] = vecs[d][order[k]];
+        }
+        Cross (shape.axes[0], shape.axes[1], shape.axes[2]);
+      }
+    }
+  };
+
+  // builds the right handed orthonormal frame spanned by p1 - c and p2 - c.
+  // Returns false if the vectors are linearly dependent.
+  inline bool PointFrame (const double* c, const double* p1, const double* p2,
+                          double (&frameOut)[3][3])
+  {
+    double v[3];
+    for(size_t d = 0; d < 3; ++d){
+      frameOut[0][d] = p1[d] - c[d];
+      v[d] = p2[d] - c[d];
+    }
+    const double len1 = sqrt (Dot (frameOut[0], frameOut[0]));
+    if(len1 == 0)
+      return false;
+    for(size_t d = 0; d < 3; ++d)
+      frameOut[0][d] /= len1;
+
+    const double h = Dot (v, frameOut[0]);
+    for(size_t d = 0; d < 3; ++d)
+      frameOut[1][d] = v[d] - h * frameOut[0][d];
+    const double len2 = sqrt (Dot (frameOut[1], frameOut[1]));
+    if(len2 == 0)
+      return false;
+    for(size_t d = 0; d < 3; ++d)
+      frameOut[1][d] /= len2;
+
+    Cross (frameOut[0], frameOut[1], frameOut[2]);
+    return true;
+  }
+
+  // the rotation which maps the rows of 'from' onto the rows of 'to'
+  inline void FrameRotation (const double (&from)[3][3], const double (&to)[3][3],
+                             double (&rotOut)[3][3])
+  {
+    for(size_t i = 0; i < 3; ++i){
+      for(size_t j = 0; j < 3; ++j)
+        rotOut[i][j] = to[0][i] * from[0][j] + to[1][i] * from[1][j] + to[2][i] * from[2][j];
+    }
+  }
+
+  // checks whether x -> rot * (x - a.center) + b.center maps each point of 'a'
+  // onto a point of 'b' within 'tol' and each triangle onto a triangle of 'b'
+  inline bool VerifySolidTransform (const SolidShape& a, const SolidShape& b,
+                                    const double (&rot)[3][3], const double tol,
+                                    std::vector <size_t>& mapScratch,
+                                    std::vector <char>& usedScratch)
+  {
+    const size_t numPoints = a.points.size() / 3;
+    mapScratch.resize (numPoints);
+    usedScratch.assign (numPoints, 0);
+
+    PointXLess less;
+    less.points = &b.points;
+    for(size_t i = 0; i < numPoints; ++i){
+      const double* p = &a.points[i * 3];
+      const double v[3] = {p[0] - a.center[0], p[1] - a.center[1], p[2] - a.center[2]};
+      double y[3];
+      for(size_t d = 0; d < 3; ++d)
+        y[d] = Dot (rot[d], v) + b.center[d];
+
+      std::vector <size_t>::const_iterator iter =
+          std::lower_bound (b.byX.begin(), b.byX.end(), y[0] - tol, less);
+      bool found = false;
+      for(; iter != b.byX.end() && b.points[3 * *iter] <= y[0] + tol; ++iter){
+        const double* q = &b.points[3 * *iter];
+        if(!usedScratch[*iter] && fabs (q[1] - y[1]) <= tol && fabs (q[2] - y[2]) <= tol){
+          usedScratch[*iter] = 1;
+          mapScratch[i] = *iter;
+          found = true;
+          break;
+        }
+      }
+      if(!found)
+        return false;
+    }
+
+    for(size_t i = 0; i < a.tris.size(); ++i){
+      const size_t* v = a.tris[i].v;
+      const OrientedTriKey key (mapScratch[v[0]], mapScratch[v[1]], mapScratch[v[2]]);
+      if(!std::binary_search (b.tris.begin(), b.tris.end(), key))
+        return false;
+    }
+    return true;
+  }
+
+  // finds a rotation which maps solid 'a' onto solid 'b' as described in
+  // FindSolidInstances
+  inline bool MatchSolidShapes (const SolidShape& a, const SolidShape& b,
+                                const double tolerance, double (&rotOut)[3][3])
+  {
+    if(a.points.size() != b.points.size() || a.tris.size() != b.tris.size())
+      return false;
+
+    for(size_t i = 0; i < 3; ++i){
+      for(size_t j = 0; j < 3; ++j)
+        rotOut[i][j] = (i == j) ? 1 : 0;
+    }
+    if(a.points.empty())
+      return true;
+
+    const double tol = tolerance > 0 ? tolerance
+                     : std::max (1.e-5 * std::max (a.maxAbsCoord, b.maxAbsCoord),
+                                 std::numeric_limits<double>::min());
+  //  the maximal change of a distance if each coordinate is off by tol
+    const double distTol = 2 * tol;
+    if(fabs (a.radius - b.radius) > 2 * distTol)
+      return false;
+    const double momentTol = 4 * distTol * (a.radius + distTol);
+    for(size_t k = 0; k < 3; ++k){
+      if(fabs (a.moments[k] - b.moments[k]) > momentTol)
+        return false;
+    }
+
+    std::vector <size_t> mapScratch;
+    std::vector <char> usedScratch;
+
+  //  well separated principal moments determine the axes up to their signs
+    const double minGap = std::max (2 * momentTol, 1.e-3 * a.moments[0]);
+    if(a.moments[0] - a.moments[1] > minGap && a.moments[1] - a.moments[2] > minGap){
+      for(int s = 0; s < 4; ++s){
+        const double s0 = (s & 1) ? -1 : 1;
+        const double s1 = (s & 2) ? -1 : 1;
+        const double signs[3] = {s0, s1, s0 * s1};
+        double frame[3][3];
+        for(size_t k = 0; k < 3; ++k){
+          for(size_t d = 0; d < 3; ++d)
+            frame[k][d] = signs[k] * b.axes[k][d];
+        }
+        FrameRotation (a.axes, frame, rotOut);
+        if(VerifySolidTransform (a, b, rotOut, tol, mapScratch, usedScratch))
+          return true;
+      }
+    }
+
+  //  otherwise (or if noise flipped the axes) use frames spanned by the point
+  //  farthest from the center and the point farthest from that axis
+    const size_t numPoints = a.points.size() / 3;
+    size_t p1 = 0;
+    for(size_t i = 1; i < numPoints; ++i){
+      if(SquaredDistance (&a.points[i * 3], a.center) > SquaredDistance (&a.points[p1 * 3], a.center))
+        p1 = i;
+    }
+    const double d1 = sqrt (SquaredDistance (&a.points[p1 * 3], a.center));
+    if(d1 <= distTol)
+      return VerifySolidTransform (a, b, rotOut, tol, mapScratch, usedScratch);
+
+    double e1[3];
+    for(size_t d = 0; d < 3; ++d)
+      e1[d] = (a.points[p1 * 3 + d] - a.center[d]) / d1;
+    size_t p2 = 0;
+    double d2 = -1, h2 = 0;
+    for(size_t i = 0; i < numPoints; ++i){
+      const double* p = &a.points[i * 3];
+      const double v[3] = {p[0] - a.center[0], p[1] - a.center[1], p[2] - a.center[2]};
+      const double h = Dot (v, e1);
+      const double dist = sqrt (std::max (0., Dot (v, v) - h * h));
+      if(dist > d2){
+        p2 = i;
+        d2 = dist;
+        h2 = h;
+      }
+    }
+
+    double frameA[3][3];
+    if(d2 <= distTol || !PointFrame (a.center, &a.points[p1 * 3], &a.points[p2 * 3], frameA))
+      return false;
+
+  //  bounds the effort for highly symmetric solids
+    const size_t maxAttempts = 256;
+    size_t numAttempts = 0;
+    for(size_t q1 = 0; q1 < numPoints; ++q1){
+      const double* pq1 = &b.points[q1 * 3];
+      const double dq1 = sqrt (SquaredDistance (pq1, b.center));
+      if(fabs (dq1 - d1) > 2 * distTol)
+        continue;
+
+      double f1[3];
+      for(size_t d = 0; d < 3; ++d)
+        f1[d] = (pq1[d] - b.center[d]) / dq1;
+      for(size_t q2 = 0; q2 < numPoints; ++q2){
+        const double* pq2 = &b.points[q2 * 3];
+        const double v[3] = {pq2[0] - b.center[0], pq2[1] - b.center[1], pq2[2] - b.center[2]};
+        const double h = Dot (v, f1);
+        const double dist = sqrt (std::max (0., Dot (v, v) - h * h));
+        if(fabs (h - h2) > 2 * distTol || fabs (dist - d2) > 2 * distTol)
+          continue;
+
+        double frameB[3][3];
+        if(!PointFrame (b.center, pq1, pq2, frameB))
+          continue;
+        FrameRotation (frameA, frameB, rotOut);
+        if(VerifySolidTransform (a, b, rotOut, tol, mapScratch, usedScratch))
+          return true;
+        if(++numAttempts >= maxAttempts)
+          return false;
+      }
+    }
+    return false;
+  }
+
+  // maps view coordinates (u to the right, v upwards, w towards the camera) to
+  // pixel coordinates and normalized depth as described in RenderThumbnail
+  struct ThumbnailMapping {
+    double uLo, vHi, wHi;
+    double scale, offset[2];
+    double depthScale;
+
+    void to_screen (const double* view, double* screenOut) const
+    {
+      screenOut[0] = (view[0] - uLo) * scale + offset[0];
+      screenOut[1] = (vHi - view[1]) * scale + offset[1];
+      screenOut[2] = (wHi - view[2]) * depthScale;
+    }
+  };
+
+  // writes the view coordinates of a range of vertices
+  template <class TNumberContainer>
+  struct ProjectVerticesFunc {
+    const TNumberContainer* coords;
+    const double            (*axes)[3];
+    std::vector <double>*   view;
+
+    void operator () (const size_t vrtBegin, const size_t vrtEnd)
+    {
+      for(size_t i = vrtBegin; i < vrtEnd; ++i){
+        const double p[3] = {static_cast<double> ((*coords)[i * 3]),
+                             static_cast<double> ((*coords)[i * 3 + 1]),
+                             static_cast<double> ((*coords)[i * 3 + 2])};
+        for(size_t d = 0; d < 3; ++d)
+          (*view)[i * 3 + d] = Dot (axes[d], p);
+      }
+    }
+  };
+
+  // Computes the view space normals and counts (fill == false) or writes
+  // (fill == true) the tiles overlapped by the screen boxes of a range of
+  // triangles.
+  template <class TIndexContainer>
+  struct ThumbnailBinsFunc {
+    const std::vector <double>* view;
+    const TIndexContainer*      tris;
+    const ThumbnailMapping*     mapping;
+    size_t                      tileSize;
+    size_t                      numTiles[2];
+    size_t                      size[2];
+    bool                        fill;
+    std::vector <float>*        triNormals;
+    std::vector <size_t>*       entryOffsets;
+    std::vector <size_t>*       entryTiles;
+
+    // returns false if the triangle covers no pixel center
+    bool tile_range (const size_t itri, size_t* tLo, size_t* tHi) const
+    {
+      double lo[2], hi[2];
+      for(size_t k = 0; k < 3; ++k){
+        double s[3];
+        mapping->to_screen (&(*view)[static_cast<size_t> ((*tris)[itri * 3 + k]) * 3], s);
+        for(size_t d = 0; d < 2; ++d){
+          lo[d] = k == 0 ? s[d] : std::min (lo[d], s[d]);
+          hi[d] = k == 0 ? s[d] : std::max (hi[d], s[d]);
+        }
+      }
+      for(size_t d = 0; d < 2; ++d){
+      //  pixel i covers [i, i + 1), its center is i + 0.5
+        const double first = std::max (0., ceil (lo[d] - 0.5));
+        const double last = std::min (static_cast<double> (size[d]) - 1, floor (hi[d] - 0.5));
+        if(!(first <= last))
+          return false;
+        tLo[d] = static_cast<size_t> (first) / tileSize;
+        tHi[d] = static_cast<size_t> (last) / tileSize;
+      }
+      return true;
+    }
+
+    void operator () (const size_t triBegin, const size_t triEnd)
+    {
+      for(size_t itri = triBegin; itri < triEnd; ++itri){
+        size_t tLo[2], tHi[2];
+        const bool visible = tile_range (itri, tLo, tHi);
+        if(!fill){
+          const double* c[3];
+          for(size_t k = 0; k < 3; ++k)
+            c[k] = &(*view)[static_cast<size_t> ((*tris)[itri * 3 + k]) * 3];
+          double e1[3], e2[3], n[3];
+          for(size_t d = 0; d < 3; ++d){
+            e1[d] = c[1][d] - c[0][d];
+            e2[d] = c[2][d] - c[0][d];
+          }
+          Cross (e1, e2, n);
+          const double len = sqrt (Dot (n, n));
+          const double sign = n[2] < 0 ? -1 : 1;
+          for(size_t d = 0; d < 3; ++d){
+            (*triNormals)[itri * 3 + d] =
+                len > 0 ? static_cast<float> (sign * n[d] / len) : (d == 2 ? 1.f : 0.f);
+          }
+          (*entryOffsets)[itri + 1] = visible ? (tHi[0] - tLo[0] + 1) * (tHi[1] - tLo[1] + 1) : 0;
+          continue;
+        }
+
+        if(!visible)
+          continue;
+        size_t entry = (*entryOffsets)[itri];
+        for(size_t j = tLo[1]; j <= tHi[1]; ++j){
+          for(size_t i = tLo[0]; i <= tHi[0]; ++i)
+            (*entryTiles)[entry++] = j * numTiles[0] + i;
+        }
+      }
+    }
+  };
+
+  // rasterizes and shades a range of tiles of a thumbnail
+  template <class TIndexContainer>
+  struct RasterizeTilesFunc {
+    const std::vector <double>* view;
+    const TIndexContainer*      tris;
+    const ThumbnailMapping*     mapping;
+    const ThumbnailOptions*     options;
+    const std::vector <float>*  triNormals;
+    const std::vector <size_t>* tileOffsets;
+    const std::vector <size_t>* tileTris;
+    size_t                      numTilesX;
+    Thumbnail*                  thumbnail;
+
+    void operator () (const size_t tileBegin, const size_t tileEnd)
+    {
+      const size_t tileSize = options->tileSize;
+      const size_t width = thumbnail->width;
+      const size_t noTri = std::numeric_limits<size_t>::max();
+      std::vector <double> depth (tileSize * tileSize);
+      std::vector <size_t> visibleTri (tileSize * tileSize);
+
+      for(size_t tile = tileBegin; tile < tileEnd; ++tile){
+        const size_t x0 = (tile % numTilesX) * tileSize;
+        const size_t y0 = (tile / numTilesX) * tileSize;
+        const size_t x1 = std::min (x0 + tileSize, width);
+        const size_t y1 = std::min (y0 + tileSize, thumbnail->height);
+        std::fill (depth.begin(), depth.end(), std::numeric_limits<double>::infinity());
+        std::fill (visibleTri.begin(), visibleTri.end(), noTri);
+
+        for(size_t entry = (*tileOffsets)[tile]; entry < (*tileOffsets)[tile + 1]; ++entry){
+          const size_t itri = (*tileTris)[entry];
+          double s[3][3];
+          for(size_t k = 0; k < 3; ++k)
+            mapping->to_screen (&(*view)[static_cast<size_t> ((*tris)[itri * 3 + k]) * 3], s[k]);
+
+          const double area = (s[1][0] - s[0][0]) * (s[2][1] - s[0][1])
+                            - (s[1][1] - s[0][1]) * (s[2][0] - s[0][0]);
+          if(area == 0)
+            continue;
+
+        //  the barycentric coordinate of corner k is a linear function of the
+        //  pixel center (x, y): a[k] * x + b[k] * y + c[k]
+          double a[3], b[3], c[3];
+          for(size_t k = 0; k < 3; ++k){
+            const double* p = s[(k + 1) % 3];
+            const double* q = s[(k + 2) % 3];
+            a[k] = (p[1] - q[1]) / area;
+            b[k] = (q[0] - p[0]) / area;
+            c[k] = (p[0] * q[1] - p[1] * q[0]) / area;
+          }
+
+          double lo[2], hi[2];
+          for(size_t d = 0; d < 2; ++d){
+            lo[d] = std::min (s[0][d], std::min (s[1][d], s[2][d]));
+            hi[d] = std::max (s[0][d], std::max (s[1][d], s[2][d]));
+          }
+          const double xFirst = std::max (static_cast<double> (x0), ceil (lo[0] - 0.5));
+          const double xLast = std::min (static_cast<double> (x1) - 1, floor (hi[0] - 0.5));
+          const double yFirst = std::max (static_cast<double> (y0), ceil (lo[1] - 0.5));
+          const double yLast = std::min (static_cast<double> (y1) - 1, floor (hi[1] - 0.5));
+          if(!(xFirst <= xLast && yFirst <= yLast))
+            continue;
+
+        //  accept centers on the edges, small negative values avoid cracks
+        //  between neighboring triangles due to rounding
+          const double eps = -1.e-9;
+          const size_t xBegin = static_cast<size_t> (xFirst);
+          const size_t xEnd = static_cast<size_t> (xLast) + 1;
+          for(size_t y = static_cast<size_t> (yFirst); y <= static_cast<size_t> (yLast); ++y){
+            const double px = static_cast<double> (xBegin) + 0.5;
+            const double py = static_cast<double> (y) + 0.5;
+            double l0 = a[0] * px + b[0] * py + c[0];
+            double l1 = a[1] * px + b[1] * py + c[1];
+            double l2 = a[2] * px + b[2] * py + c[2];
+            double* rowDepth = &depth[(y - y0) * tileSize];
+            size_t* rowTri = &visibleTri[(y - y0) * tileSize];
+            for(size_t x = xBegin; x < xEnd; ++x){
+              if(l0 >= eps && l1 >= eps && l2 >= eps){
+                const double z = l0 * s[0][2] + l1 * s[1][2] + l2 * s[2][2];
+                if(z < rowDepth[x - x0]){
+                  rowDepth[x - x0] = z;
+                  rowTri[x - x0] = itri;
+                }
+              }
+              l0 += a[0];
+              l1 += a[1];
+              l2 += a[2];
+            }
+          }
+        }
+
+        shade (x0, y0, x1, y1, depth, visibleTri);
+      }
+    }
+
+    void shade (const size_t x0, const size_t y0, const size_t x1, const size_t y1,
+                const std::vector <double>& depth, const std::vector <size_t>& visibleTri)
+    {
+    //  light from the upper left, in view coordinates
+      double light[3] = {-0.4, 0.5, 1};
+      const double lightLen = sqrt (Dot (light, light));
+      for(size_t d = 0; d < 3; ++d)
+        light[d] /= lightLen;
+      const size_t tileSize = options->tileSize;
+      for(size_t y = y0; y < y1; ++y){
+        for(size_t x = x0; x < x1; ++x){
+          const size_t local = (y - y0) * tileSize + (x - x0);
+          const size_t pixel = y * thumbnail->width + x;
+          const size_t itri = visibleTri[local];
+          if(itri == std::numeric_limits<size_t>::max())
+            continue;
+
+          thumbnail->depth[pixel] = static_cast<float> (std::max (0., std::min (1., depth[local])));
+          double n[3];
+          for(size_t d = 0; d < 3; ++d){
+            n[d] = (*triNormals)[itri * 3 + d];
+            thumbnail->normals[pixel * 3 + d] = (*triNormals)[itri * 3 + d];
+          }
+          const double intensity = 0.3 + 0.7 * std::max (0., Dot (n, light));
+          for(size_t d = 0; d < 3; ++d){
+            thumbnail->rgb[pixel * 3 + d] = static_cast<unsigned char> (
+                std::min (255., intensity * options->color[d] + 0.5));
+          }
+        }
+      }
+    }
+  };
+
+  // computes the box (lo, hi) of triangle itri
+  template <class TNumberContainer, class TIndexContainer>
+  void TriBox (const TNumberContainer& coords, const TIndexContainer& tris,
+               const size_t itri, double* lo, double* hi)
+  {
+    double c[3][3];
+    LoadTriCorners (coords, tris, itri, c);
+    for(size_t d = 0; d < 3; ++d){
+      lo[d] = std::min (c[0][d], std::min (c[1][d], c[2][d]));
+      hi[d] = std::max (c[0][d], std::max (c[1][d], c[2][d]));
+    }
+  }
+
+  // Counts (fill == false) or writes (fill == true) the cells overlapped by
+  // the boxes of a range of triangles of a uniform grid.
+  template <class TNumberContainer, class TIndexContainer>
+  struct GridCellsFunc {
+    const TNumberContainer* coords;
+    const TIndexContainer*  tris;
+    const double*           origin;
+    double                  cellSize;
+    const size_t*           numCells;
+    bool                    fill;
+    std::vector <size_t>*   entryOffsets;
+    std::vector <size_t>*   entryCells;
+
+    void cell_range (const size_t itri, size_t* cLo, size_t* cHi) const
+    {
+      double lo[3], hi[3];
+      TriBox (*coords, *tris, itri, lo, hi);
+      for(size_t d = 0; d < 3; ++d){
+        const double maxCell = static_cast<double> (numCells[d] - 1);
+        cLo[d] = static_cast<size_t> (std::max (0., std::min (maxCell, floor ((lo[d] - origin[d]) / cellSize))));
+        cHi[d] = static_cast<size_t> (std::max (0., std::min (maxCell, floor ((hi[d] - origin[d]) / cellSize))));
+      }
+    }
+
+    void operator () (const size_t triBegin, const size_t triEnd)
+    {
+      for(size_t itri = triBegin; itri < triEnd; ++itri){
+        size_t cLo[3], cHi[3];
+        cell_range (itri, cLo, cHi);
+        if(!fill){
+          (*entryOffsets)[itri + 1] = (cHi[0] - cLo[0] + 1) * (cHi[1] - cLo[1] + 1) * (cHi[2] - cLo[2] + 1);
+          continue;
+        }
+
+        size_t entry = (*entryOffsets)[itri];
+        for(size_t k = cLo[2]; k <= cHi[2]; ++k){
+          for(size_t j = cLo[1]; j <= cHi[1]; ++j){
+            for(size_t i = cLo[0]; i <= cHi[0]; ++i)
+              (*entryCells)[entry++] = (k * numCells[1] + j) * numCells[0] + i;
+          }
+        }
+      }
+    }
+  };
+
+  // Counting sort of the (cell, triangle) entries of a uniform grid by cell.
+  // Triangles are split into consecutive blocks. Each block counts its entries
+  // per cell in its own row of 'blockCounts' (scatter == false). Once the rows
+  // hold the offsets of the blocks within each cell, each block writes its
+  // triangles to 'cellTris' (scatter == true). Since blocks are ordered and
+  // each block visits its triangles in order, triangles stay sorted within
+  // each cell.
+  struct GridSortFunc {
+    size_t                        numTris;
+    size_t                        numBlocks;
+    size_t                        numCells;
+    const std::vector <size_t>*   entryOffsets;
+    const std::vector <size_t>*   entryCells;
+    const std::vector <size_t>*   cellOffsets;
+    std::vector <size_t>*         blockCounts;
+    std::vector <size_t>*         cellTris;
+    bool                          scatter;
+
+    void operator () (const size_t blockBegin, const size_t blockEnd)
+    {
+      for(size_t iblock = blockBegin; iblock < blockEnd; ++iblock){
+        size_t* counts = &(*blockCounts)[iblock * numCells];
+        const size_t triBegin = numTris * iblock / numBlocks;
+        const size_t triEnd = numTris * (iblock + 1) / numBlocks;
+        for(size_t itri = triBegin; itri < triEnd; ++itri){
+          for(size_t i = (*entryOffsets)[itri]; i < (*entryOffsets)[itri + 1]; ++i){
+            const size_t cell = (*entryCells)[i];
+            if(scatter)
+              (*cellTris)[(*cellOffsets)[cell] + counts[cell]++] = itri;
+            else
+              ++counts[cell];
+          }
+        }
+      }
+    }
+  };
+
+  // Turns the per block counts of GridSortFunc into offsets of the blocks
+  // within each cell and writes the total count of each cell to
+  // cellOffsets[cell + 1].
+  struct GridBlockOffsetsFunc {
+    size_t                  numBlocks;
+    size_t                  numCells;
+    std::vector <size_t>*   blockCounts;
+    std::vector <size_t>*   cellOffsets;
+
+    void operator () (const size_t cellBegin, const size_t cellEnd)
+    {
+      for(size_t cell = cellBegin; cell < cellEnd; ++cell){
+        size_t offset = 0;
+        for(size_t iblock = 0; iblock < numBlocks; ++iblock){
+          size_t& count = (*blockCounts)[iblock * numCells + cell];
+          const size_t blockCount = count;
+          count = offset;
+          offset += blockCount;
+        }
+        (*cellOffsets)[cell + 1] = offset;
+      }
+    }
+  };
+
+  // Möller-Trumbore ray-triangle intersection. Returns the ray parameter of
+  // the hit in tOut.
+  inline bool RayTriIntersect (const double* origin, const double* dir,
+                               const double (&c)[3][3], double& tOut)
+  {
+    double e1[3], e2[3], s[3], p[3], q[3];
+    for(size_t d = 0; d < 3; ++d){
+      e1[d] = c[1][d] - c[0][d];
+      e2[d] = c[2][d] - c[0][d];
+      s[d] = origin[d] - c[0][d];
+    }
+    Cross (dir, e2, p);
+    const double det = Dot (e1, p);
+    if(det == 0)
+      return false;
+    const double invDet = 1 / det;
+    const double u = Dot (s, p) * invDet;
+    if(u < 0 || u > 1)
+      return false;
+    Cross (s, e1, q);
+    const double v = Dot (dir, q) * invDet;
+    if(v < 0 || u + v > 1)
+      return false;
+    tOut = Dot (e2, q) * invDet;
+    return true;
+  }
+
+  // Computes the distance of each point to the mesh in the given BVH. The
+  // closest triangle of the previous point of a chunk bounds the search.
+  template <class TNumberContainer, class TIndexContainer>
+  struct PointDistancesFunc {
+    const TNumberContainer*     coords;
+    const TIndexContainer*      tris;
+    const TriangleBvh*          bvh;
+    const std::vector <double>* points;
+    std::vector <double>*       distances;
+
+    void operator () (const size_t begin, const size_t end)
+    {
+      std::vector <size_t> stack;
+      bool hasPrev = false;
+      size_t prevTri = 0;
+      for(size_t i = begin; i < end; ++i){
+        const double* p = &(*points)[3 * i];
+        double maxDistSq = std::numeric_limits<double>::infinity();
+        if(hasPrev){
+          double corners[3][3], closest[3];
+          LoadTriCorners (*coords, *tris, prevTri, corners);
+          ClosestPointOnTri (p, corners[0], corners[1], corners[2], closest);
+          const double d[3] = {p[0] - closest[0], p[1] - closest[1], p[2] - closest[2]};
+          maxDistSq = Dot (d, d);
+        }
+
+        ClosestPointHit hit;
+        if(ClosestPoint (*bvh, *coords, *tris, p, maxDistSq, hit, stack)){
+          prevTri = hit.tri;
+          hasPrev = true;
+          maxDistSq = hit.distSq;
+        }
+        (*distances)[i] = sqrt (maxDistSq);
+      }
+    }
+  };
+
+  // computes the distances of 'points' to the mesh in 'bvh'
+  template <class TNumberContainer, class TIndexContainer>
+  void PointDistances (const TNumberContainer& coords,
+                       const TIndexContainer& tris,
+                       const TriangleBvh& bvh,
+                       const std::vector <double>& points,
+                       std::vector <double>& distancesOut,
+                       const unsigned int numThreads)
+  {
+    distancesOut.resize (points.size() / 3);
+    PointDistancesFunc <TNumberContainer, TIndexContainer> func;
+    func.coords = &coords;
+    func.tris = &tris;
+    func.bvh = &bvh;
+    func.points = &points;
+    func.distances = &distancesOut;
+    ParallelFor (distancesOut.size(), 1024, func, numThreads);
+  }
+
+  // draws area uniform samples of a mesh and writes them ordered by triangle
+  template <class TNumberContainer, class TIndexContainer>
+  void DeviationSamples (const TNumberContainer& coords,
+                         const TIndexContainer& tris,
+                         const size_t numSamples,
+                         const unsigned long long seed,
+                         std::vector <double>& pointsOut,
+                         const unsigned int numThreads)
+  {
+    pointsOut.clear();
+    SurfaceSampler <TNumberContainer, TIndexContainer> sampler (coords, tris);
+    if(sampler.area() <= 0)
+      return;
+
+    SurfaceSamples <double> samples;
+    sampler.sample (numSamples, seed, samples, numThreads);
+
+  //  sort the samples by triangle, so that consecutive queries are close
+    const unsigned int sampleBits = NumBits (numSamples);
+    const unsigned int triBits = NumBits (tris.size() / 3);
+    std::vector <unsigned long long> order (numSamples);
+    for(size_t i = 0; i < numSamples; ++i)
+      order[i] = (static_cast<unsigned long long> (samples.tris[i]) << sampleBits) | i;
+    if(sampleBits + triBits <= 64){
+      std::vector <unsigned long long> scratch;
+      RadixSort (order, scratch, IdentityKey(), sampleBits + triBits);
+    }
+    else{
+      for(size_t i = 0; i < numSamples; ++i)
+        order[i] = i;
+    }
+
+    pointsOut.resize (3 * numSamples);
+    const unsigned long long sampleMask = (1ULL << sampleBits) - 1;
+    for(size_t i = 0; i < numSamples; ++i){
+      const size_t j = static_cast<size_t> (order[i] & sampleMask);
+      pointsOut[3 * i] = samples.x[j];
+      pointsOut[3 * i + 1] = samples.y[j];
+      pointsOut[3 * i + 2] = samples.z[j];
+    }
+  }
+
+  // Directed maximal and mean distance from mesh 'from' to the mesh in 'toBvh'.
+  // The distances of the vertices of 'from' are written to vrtDistancesOut.
+  template <class TNumberContainer1, class TIndexContainer1,
+            class TNumberContainer2, class TIndexContainer2>
+  void DirectedDeviation (const TNumberContainer1& fromCoords,
+                          const TIndexContainer1& fromTris,
+                          const TNumberContainer2& toCoords,
+                          const TIndexContainer2& toTris,
+                          const TriangleBvh& toBvh,
+                          const size_t numSamples,
+                          const unsigned long long seed,
+                          const unsigned int numThreads,
+                          std::vector <double>& vrtDistancesOut,
+                          double& maxDistOut,
+                          double& meanDistOut)
+  {
+    std::vector <double> points (fromCoords.size());
+    for(size_t i = 0; i < points.size(); ++i)
+      points[i] = static_cast<double> (fromCoords[i]);
+    PointDistances (toCoords, toTris, toBvh, points, vrtDistancesOut, numThreads);
+
+    maxDistOut = 0;
+    for(size_t i = 0; i < vrtDistancesOut.size(); ++i)
+      maxDistOut = std::max (maxDistOut, vrtDistancesOut[i]);
+
+    meanDistOut = 0;
+    std::vector <double> sampleDistances;
+    DeviationSamples (fromCoords, fromTris, numSamples, seed, points, numThreads);
+    PointDistances (toCoords, toTris, toBvh, points, sampleDistances, numThreads);
+    for(size_t i = 0; i < sampleDistances.size(); ++i){
+      maxDistOut = std::max (maxDistOut, sampleDistances[i]);
+      meanDistOut += sampleDistances[i];
+    }
+    if(!sampleDistances.empty())
+      meanDistOut /= static_cast<double> (sampleDistances.size());
+  }
+
+  // extracts a range of solids of a mesh to separate meshes
+  template <class TMesh>
+  struct ExtractSolidsFunc {
+    const TMesh*          mesh;
+    std::vector <TMesh>*  meshes;
+
+    void operator () (const size_t begin, const size_t end)
+    {
+      for(size_t i = begin; i < end; ++i)
+        mesh->extract_solid (i, (*meshes)[i]);
+    }
+  };
+
+  // Parses an ASCII stl file. The corners of all triangles are written to
+  // coordsWithIndexOut, without identifying equal corners. The number of bytes
+  // used by the line buffers is written to bufferBytesOut.
+  template <class number_t, class TNumberContainer, class TIndexContainer1, class TIndexContainer2>
+  bool ParseStlAscii (const char* filename,
+                      std::vector <CoordWithIndex <number_t,
+                        typename TIndexContainer1::value_type> >& coordsWithIndexOut,
+                      TNumberContainer& normalsOut,
+                      TIndexContainer1& trisOut,
+                      TIndexContainer2& solidRangesOut,
+                      size_t& bufferBytesOut)
+  {
+    using namespace std;
+
+    typedef typename TNumberContainer::value_type normal_t;
+    typedef typename TIndexContainer1::value_type index_t;
+
+    STL_READER_TRACE_BEGIN (traceOpen, "open");
+    ifstream in(filename);
+    STL_READER_TRACE_END (traceOpen);
+    STL_READER_COND_THROW(!in, "Couldn't open file " << filename);
+    STL_READER_TRACE_SCOPE ("parse");
+
+    string buffer;
+    const size_t maxNumTokens = 5;
+    const char* tokens[maxNumTokens];
+    size_t tokenLengths[maxNumTokens];
+    int lineCount = 1;
+    size_t numFaceVrts = 0;
+
+    while(!(in.eof() || in.fail()))
+    {
+    //  read the line and tokenize it in place, so that no memory is allocated
+    //  per line once 'buffer' is large enough to hold the longest line.
+      getline(in, buffer);
+      const size_t tokenCount = TokenizeLine (buffer.c_str(), tokens, tokenLengths, maxNumTokens);
+
+      if(tokenCount > 0)
+      {
+        const char* tok = tokens[0];
+        const size_t tokLen = tokenLengths[0];
+        if(TokenEquals (tok, tokLen, "vertex")){
+          if(tokenCount < 4){
+            STL_READER_THROW("ERROR while reading from " << filename <<
+              ": vertex not specified correctly in line " << lineCount);
+          }
+        
+        //  read the position
+          CoordWithIndex <number_t, index_t> c;
+          for(size_t i = 0; i < 3; ++i)
+            ParseNumber (tokens[i+1], c[i]);
+          c.index = static_cast<index_t>(coordsWithIndexOut.size());
+          coordsWithIndexOut.push_back(c);
+          ++numFaceVrts;
+        }
+        else if(TokenEquals (tok, tokLen, "facet"))
+        {
+          STL_READER_COND_THROW(tokenCount < 5,
+            "ERROR while reading from " << filename <<
+            ": triangle not specified correctly in line " << lineCount);
+        
+          STL_READER_COND_THROW(!TokenEquals (tokens[1], tokenLengths[1], "normal"),
+            "ERROR while reading from " << filename <<
+            ": Missing normal specifier in line " << lineCount);
+        
+        //  read the normal
+          for(size_t i = 0; i < 3; ++i){
+            normal_t n;
+            ParseNumber (tokens[i+2], n);
+            normalsOut.push_back (n);
+          }
+
+          numFaceVrts = 0;
+        }
+        else if(TokenEquals (tok, tokLen, "outer")){
+          STL_READER_COND_THROW ((tokenCount < 2) || !TokenEquals (tokens[1], tokenLengths[1], "loop"),
+            "ERROR while reading from " << filename <<
+            ": expecting outer loop in line " << lineCount);
+        }
+        else if(TokenEquals (tok, tokLen, "endfacet")){
+          STL_READER_COND_THROW(numFaceVrts != 3,
+            "ERROR while reading from " << filename <<
+            ": bad number of vertices specified for face in line " << lineCount);
+
+          trisOut.push_back(static_cast<index_t> (coordsWithIndexOut.size() - 3));
+          trisOut.push_back(static_cast<index_t> (coordsWithIndexOut.size() - 2));
+          trisOut.push_back(static_cast<index_t> (coordsWithIndexOut.size() - 1));
+        }
+        else if(TokenEquals (tok, tokLen, "solid")){
+          solidRangesOut.push_back(static_cast<index_t> (trisOut.size() / 3));
+        }
+      }
+      lineCount++;
+    }
+
+    solidRangesOut.push_back(static_cast<index_t> (trisOut.size() / 3));
+
+    bufferBytesOut = buffer.capacity();
+    return true;
+  }
+
+  // Reads a binary stl file. If recoverTruncated is true, the complete records
+  // of a file which holds less triangles than declared in its header are read.
+  // Otherwise such files are rejected.
+  template <class TNumberContainer1, class TNumberContainer2,
+            class TIndexContainer1, class TIndexContainer2>
+  bool ReadBinaryStl (const char* filename,
+                      TNumberContainer1& coordsOut,
+                      TNumberContainer2& normalsOut,
+                      TIndexContainer1& trisOut,
+                      TIndexContainer2& solidRangesOut,
+                      const bool recoverTruncated,
+                      StlReadInfo* infoOut)
+  {
+    using namespace std;
+
+    typedef typename TNumberContainer1::value_type  number_t;
+    typedef typename TIndexContainer1::value_type index_t;
+
+    coordsOut.clear();
+    normalsOut.clear();
+    trisOut.clear();
+    solidRangesOut.clear();
+
+    STL_READER_TRACE_BEGIN (traceOpen, "open");
+    ifstream in(filename, ios::binary);
+    STL_READER_TRACE_END (traceOpen);
+    STL_READER_COND_THROW(!in, "Couldnt open file " << filename);
+
+    char stl_header[80];
+    in.read(stl_header, 80);
+    STL_READER_COND_THROW(!in, "Error while parsing binary stl header in file " << filename);
+
+    unsigned int numTris = 0;
+    in.read((char*)&numTris, 4);
+    STL_READER_COND_THROW(!in, "Couldnt determine number of triangles in binary stl file " << filename);
+
+  //  compare the triangle count with the size of the file before decoding, so
+  //  that truncated files are detected up front and a corrupt triangle count
+  //  does not lead to a huge allocation.
+    const streampos dataBegin = in.tellg();
+    in.seekg(0, ios::end);
+    const streampos dataEnd = in.tellg();
+    in.seekg(dataBegin);
+    STL_READER_COND_THROW(!in, "Couldnt determine size of binary stl file " << filename);
+
+    const size_t recordSize = 50;
+    const size_t numAvailable = static_cast<size_t> (dataEnd - dataBegin) / recordSize;
+    const unsigned int numTrisDeclared = numTris;
+    if(numAvailable < numTris){
+      STL_READER_COND_THROW(!recoverTruncated, "Binary stl file " << filename
+                            << " is truncated: it declares " << numTris
+                            << " triangles but only holds " << numAvailable);
+      numTris = static_cast<unsigned int> (numAvailable);
+    }
+    const size_t numReserve = numTris;
+
+    vector<CoordWithIndex <number_t, index_t> > coordsWithIndex;
+    coordsWithIndex.reserve(numReserve * 3);
+    normalsOut.reserve(numReserve * 3);
+    trisOut.reserve(numReserve * 3);
+
+  //  records are read in blocks to avoid the overhead of one stream access per field
+    const size_t blockSize = 1024;
+    vector<char> block (min<size_t> (max<size_t> (numReserve, 1), blockSize) * recordSize);
+
+    for(unsigned int blockBegin = 0; blockBegin < numTris;){
+      const unsigned int blockTris = static_cast<unsigned int> (
+                            min<size_t> (numTris - blockBegin, block.size() / recordSize));
+      STL_READER_TRACE_BEGIN (traceRead, "chunk read");
+      in.read(&block[0], blockTris * recordSize);
+      STL_READER_TRACE_END (traceRead);
+      STL_READER_COND_THROW(!in, "Error while parsing trianlge in binary stl file " << filename);
+
+      STL_READER_TRACE_SCOPE ("parse");
+
+      for(unsigned int tri = 0; tri < blockTris; ++tri){
+        float d[12];
+        memcpy(d, &block[tri * recordSize], 12 * 4);
+
+        for(int i = 0; i < 3; ++i)
+          normalsOut.push_back (d[i]);
+
+        for(size_t ivrt = 1; ivrt < 4; ++ivrt){
+          CoordWithIndex <number_t, index_t> c;
+          CopyCoords (c.data, d + ivrt * 3);
+          c.index = static_cast<index_t>(coordsWithIndex.size());
+          coordsWithIndex.push_back(c);
+        }
+
+        trisOut.push_back(static_cast<index_t> (coordsWithIndex.size() - 3));
+        trisOut.push_back(static_cast<index_t> (coordsWithIndex.size() - 2));
+        trisOut.push_back(static_cast<index_t> (coordsWithIndex.size() - 1));
+      }
+
+      blockBegin += blockTris;
+    }
+
+    solidRangesOut.push_back(0);
+    solidRangesOut.push_back(static_cast<index_t> (trisOut.size() / 3));
+
+    RemoveDoubles (coordsOut, trisOut, normalsOut, solidRangesOut, coordsWithIndex,
+                   infoOut ? &infoOut->geometryHash : NULL);
+
+    if(infoOut){
+      infoOut->peakScratchBytes = RemoveDoublesScratchBytes (coordsWithIndex) + block.capacity();
+      infoOut->numTrisMissing = numTrisDeclared - numTris;
+    }
+
+    return true;
+  }
+}// end of namespace stl_reader_impl
+
+
+template <class TNumberContainer1, class TNumberContainer2,
+          class TIndexContainer1, class TIndexContainer2>
+bool ReadStlFile(const char* filename,
+                 TNumberContainer1& coordsOut,
+                 TNumberContainer2& normalsOut,
+                 TIndexContainer1& trisOut,
+                 TIndexContainer2& solidRangesOut,
+                 StlReadInfo* infoOut)
+{
+  if(StlFileHasASCIIFormat(filename))
+    return ReadStlFile_ASCII(filename, coordsOut, normalsOut, trisOut, solidRangesOut, infoOut);
+  else
+    return ReadStlFile_BINARY(filename, coordsOut, normalsOut, trisOut, solidRangesOut, infoOut);
+}
+
+
+template <class TNumberContainer1, class TNumberContainer2,
+          class TIndexContainer1, class TIndexContainer2>
+bool ReadStlFile_ASCII(const char* filename,
+                       TNumberContainer1& coordsOut,
+                       TNumberContainer2& normalsOut,
+                       TIndexContainer1& trisOut,
+                       TIndexContainer2& solidRangesOut,
+                       StlReadInfo* infoOut)
+{
+  using namespace std;
+  using namespace stl_reader_impl;
+
+  typedef typename TNumberContainer1::value_type  number_t;
+  typedef typename TIndexContainer1::value_type index_t;
+
+  coordsOut.clear();
+  normalsOut.clear();
+  trisOut.clear();
+  solidRangesOut.clear();
+
+  vector<CoordWithIndex <number_t, index_t> > coordsWithIndex;
+  size_t bufferBytes = 0;
+  if(!ParseStlAscii (filename, coordsWithIndex, normalsOut, trisOut, solidRangesOut, bufferBytes))
+    return false;
+
+  RemoveDoubles (coordsOut, trisOut, normalsOut, solidRangesOut, coordsWithIndex,
+                 infoOut ? &infoOut->geometryHash : NULL);
+
+  if(infoOut){
+    infoOut->peakScratchBytes = RemoveDoublesScratchBytes (coordsWithIndex) + bufferBytes;
+    infoOut->numTrisMissing = 0;
+  }
+
+  return true;
+}
+
+
+template <class TNumberContainer1, class TNumberContainer2,
+          class TIndexContainer1, class TIndexContainer2>
+bool ReadStlFile_BINARY(const char* filename,
+                        TNumberContainer1& coordsOut,
+                        TNumberContainer2& normalsOut,
+                        TIndexContainer1& trisOut,
+                        TIndexContainer2& solidRangesOut,
+                        StlReadInfo* infoOut)
+{
+  return stl_reader_impl::ReadBinaryStl (filename, coordsOut, normalsOut, trisOut,
+                                         solidRangesOut, false, infoOut);
+}
+
+
+template <class TNumberContainer1, class TNumberContainer2,
+          class TIndexContainer1, class TIndexContainer2>
+bool RecoverStlFile_BINARY(const char* filename,
+                           TNumberContainer1& coordsOut,
+                           TNumberContainer2& normalsOut,
+                           TIndexContainer1& trisOut,
+                           TIndexContainer2& solidRangesOut,
+                           StlReadInfo* infoOut)
+{
+  return stl_reader_impl::ReadBinaryStl (filename, coordsOut, normalsOut, trisOut,
+                                         solidRangesOut, true, infoOut);
+}
+
+
+template <class TNumberContainer1, class TNumberContainer2,
+          class TIndexContainer1, class TIndexContainer2>
+bool ReadStlFileRelative(const char* filename,
+                         double* originOut,
+                         TNumberContainer1& coordsOut,
+                         TNumberContainer2& normalsOut,
+                         TIndexContainer1& trisOut,
+                         TIndexContainer2& solidRangesOut,
+                         StlReadInfo* infoOut)
+{
+  using namespace std;
+  using namespace stl_reader_impl;
+
+  typedef typename TNumberContainer1::value_type  number_t;
+  typedef typename TIndexContainer1::value_type index_t;
+
+  coordsOut.clear();
+  normalsOut.clear();
+  trisOut.clear();
+  solidRangesOut.clear();
+
+  vector<double> uniqueCoords;
+  size_t scratchBytes = 0;
+  unsigned long long geometryHash = 0;
+  if(StlFileHasASCIIFormat(filename)){
+    vector<CoordWithIndex <double, index_t> > coordsWithIndex;
+    size_t bufferBytes = 0;
+    if(!ParseStlAscii (filename, coordsWithIndex, normalsOut, trisOut, solidRangesOut, bufferBytes))
+      return false;
+    RemoveDoubles (uniqueCoords, trisOut, normalsOut, solidRangesOut, coordsWithIndex, &geometryHash);
+    scratchBytes = RemoveDoublesScratchBytes (coordsWithIndex) + bufferBytes;
+  }
+  else{
+    StlReadInfo info;
+    if(!ReadStlFile_BINARY(filename, uniqueCoords, normalsOut, trisOut, solidRangesOut, &info))
+      return false;
+    scratchBytes = info.peakScratchBytes;
+    geometryHash = info.geometryHash;
+  }
+
+  const size_t numVrts = uniqueCoords.size() / 3;
+  for(size_t d = 0; d < 3; ++d){
+    double lo = numVrts > 0 ? uniqueCoords[d] : 0;
+    double hi = lo;
+    for(size_t i = 1; i < numVrts; ++i){
+      lo = min (lo, uniqueCoords[3 * i + d]);
+      hi = max (hi, uniqueCoords[3 * i + d]);
+    }
+    originOut[d] = 0.5 * (lo + hi);
+  }
+
+  coordsOut.resize (uniqueCoords.size());
+  for(size_t i = 0; i < uniqueCoords.size(); ++i)
+    coordsOut[i] = static_cast<number_t> (uniqueCoords[i] - originOut[i % 3]);
+
+  if(infoOut){
+    infoOut->peakScratchBytes = scratchBytes + uniqueCoords.capacity() * sizeof(double);
+    infoOut->numTrisMissing = 0;
+    infoOut->geometryHash = geometryHash;
+  }
+
+  return true;
+}
+
+
+inline bool StlFileHasASCIIFormat(const char* filename)
+{
+  using namespace std;
+  STL_READER_TRACE_SCOPE ("detect");
+  ifstream in(filename);
+  STL_READER_COND_THROW(!in, "Couldnt open file " << filename);
+
+  char chars [256];
+  in.read (chars, 256);
+  string buffer (chars, in.gcount());
+  transform(buffer.begin(), buffer.end(), buffer.begin(), ::tolower);
+  return buffer.find ("solid") != string::npos &&
+         buffer.find ("\n") != string::npos &&
+         buffer.find ("facet") != string::npos &&
+         buffer.find ("normal") != string::npos;
+}
+
+
+template <class TNumberContainer, class TIndexContainer>
+size_t OrientTriangles (TIndexContainer& trisInOut,
+                        TNumberContainer& normalsInOut,
+                        unsigned int numThreads)
+{
+  using namespace std;
+  using namespace stl_reader_impl;
+
+  typedef typename TIndexContainer::value_type  index_t;
+
+  const size_t numTris = trisInOut.size() / 3;
+  if(numTris == 0)
+    return 0;
+
+  vector<EdgeWithTri <index_t> > edges;
+  CollectSortedEdges (trisInOut, edges);
+
+//  triangles which share a manifold edge are adjacent. Components are
+//  identified by a union-find over those adjacencies.
+  vector<long long> adjacency (numTris * 3, -1);
+  vector<index_t> parents (numTris);
+  for(size_t i = 0; i < numTris; ++i)
+    parents[i] = static_cast<index_t> (i);
+
+  for(size_t i = 0; i < edges.size();){
+    size_t j = i + 1;
+    while(j < edges.size() && edges[j].same_edge (edges[i]))
+      ++j;
+
+    if(j - i == 2){
+      const EdgeWithTri <index_t>& e0 = edges[i];
+      const EdgeWithTri <index_t>& e1 = edges[i + 1];
+      const long long sameDir = (e0.reversed == e1.reversed) ? 1 : 0;
+      for(size_t k = 0; k < 3; ++k){
+        const index_t* t0 = &trisInOut[e0.tri * 3];
+        if(t0[k] != e0.vrt[0] && t0[k] != e0.vrt[1])
+          adjacency[e0.tri * 3 + (k + 1) % 3] = 2 * static_cast<long long> (e1.tri) + sameDir;
+        const index_t* t1 = &trisInOut[e1.tri * 3];
+        if(t1[k] != e1.vrt[0] && t1[k] != e1.vrt[1])
+          adjacency[e1.tri * 3 + (k + 1) % 3] = 2 * static_cast<long long> (e0.tri) + sameDir;
+      }
+      const index_t r0 = FindRoot (parents, e0.tri);
+      const index_t r1 = FindRoot (parents, e1.tri);
+      if(r0 != r1)
+        parents[max(r0, r1)] = min(r0, r1);
+    }
+    i = j;
+  }
+
+//  sort triangles by component
+  vector<size_t> compOfRoot (numTris, 0);
+  vector<size_t> compRanges (1, 0);
+  for(size_t i = 0; i < numTris; ++i){
+    if(static_cast<size_t> (FindRoot (parents, static_cast<index_t> (i))) == i){
+      compOfRoot[i] = compRanges.size() - 1;
+      compRanges.push_back (0);
+    }
+  }
+
+  vector<index_t> compTris (numTris);
+  for(size_t i = 0; i < numTris; ++i)
+    ++compRanges[compOfRoot[parents[i]] + 1];
+  for(size_t i = 1; i < compRanges.size(); ++i)
+    compRanges[i] += compRanges[i - 1];
+  vector<size_t> compFill (compRanges.begin(), compRanges.end() - 1);
+  for(size_t i = 0; i < numTris; ++i)
+    compTris[compFill[compOfRoot[parents[i]]]++] = static_cast<index_t> (i);
+
+  vector<signed char> flip (numTris, -1);
+  vector<size_t> numFlipped (compRanges.size() - 1, 0);
+
+  OrientComponentsFunc <index_t> func;
+  func.compTris = &compTris;
+  func.compRanges = &compRanges;
+  func.adjacency = &adjacency;
+  func.flip = &flip;
+  func.numFlipped = &numFlipped;
+  ParallelFor (numFlipped.size(), 64, func, numThreads);
+
+  size_t totalFlipped = 0;
+  for(size_t i = 0; i < numFlipped.size(); ++i)
+    totalFlipped += numFlipped[i];
+
+  for(size_t i = 0; i < numTris; ++i){
+    if(flip[i] == 1){
+      std::swap (trisInOut[i * 3 + 1], trisInOut[i * 3 + 2]);
+      for(size_t j = 0; j < 3; ++j)
+        normalsInOut[i * 3 + j] = -normalsInOut[i * 3 + j];
+    }
+  }
+
+  return totalFlipped;
+}
+
+
+template <class TNumberContainer1, class TNumberContainer2,
+          class TIndexContainer1, class TIndexContainer2>
+size_t FillHoles (const TNumberContainer1& coords,
+                  TIndexContainer1& trisInOut,
+                  TNumberContainer2& normalsInOut,
+                  TIndexContainer2& solidRangesInOut,
+                  size_t maxLoopSize)
+{
+  using namespace std;
+  using namespace stl_reader_impl;
+
+  typedef typename TNumberContainer2::value_type  normal_t;
+  typedef typename TIndexContainer1::value_type   index_t;
+
+  const size_t numTris = trisInOut.size() / 3;
+  if(numTris == 0 || maxLoopSize < 3)
+    return 0;
+
+  vector<EdgeWithTri <index_t> > edges;
+  CollectSortedEdges (trisInOut, edges);
+
+//  Boundary edges are stored in the direction opposite to their triangle, so
+//  that loops traced along them are oriented like the triangles which fill them.
+//  Triangles which share an edge are joined to components.
+  vector<EdgeWithTri <index_t> > boundary;
+  vector<index_t> parents (numTris);
+  for(size_t i = 0; i < numTris; ++i)
+    parents[i] = static_cast<index_t> (i);
+  vector<char> onBoundary (numTris, 0);
+  for(size_t i = 0; i < edges.size();){
+    size_t j = i + 1;
+    while(j < edges.size() && edges[j].same_edge (edges[i]))
+      ++j;
+    if(j - i == 1){
+      EdgeWithTri <index_t> e = edges[i];
+      if(!e.reversed)
+        std::swap (e.vrt[0], e.vrt[1]);
+      boundary.push_back (e);
+      onBoundary[e.tri] = 1;
+    }
+    for(size_t k = i + 1; k < j; ++k){
+      const index_t r0 = FindRoot (parents, edges[i].tri);
+      const index_t r1 = FindRoot (parents, edges[k].tri);
+      if(r0 != r1)
+        parents[max(r0, r1)] = min(r0, r1);
+    }
+    i = j;
+  }
+
+  if(boundary.empty())
+    return 0;
+
+//  Components in which every triangle has a boundary edge, e.g. stray
+//  triangles or small open patches, are no surfaces with holes. Their
+//  loops are left open.
+  vector<char> hasInterior (numTris, 0);
+  for(size_t i = 0; i < numTris; ++i){
+    if(!onBoundary[i])
+      hasInterior[FindRoot (parents, static_cast<index_t> (i))] = 1;
+  }
+
+//  sort boundary edges by their start vertex, so that the successor of an
+//  edge can be found by binary search.
+  sort (boundary.begin(), boundary.end());
+
+  vector<char> visited (boundary.size(), 0);
+  vector<vector<index_t> > newTrisPerSolid (max<size_t> (solidRangesInOut.size(), 2) - 1);
+  vector<index_t> loop;
+  vector<size_t> loopEdges;
+  size_t numFilled = 0;
+
+  for(size_t ib = 0; ib < boundary.size(); ++ib){
+    if(visited[ib])
+      continue;
+
+    loop.clear();
+    loopEdges.clear();
+    bool valid = true;
+    size_t cur = ib;
+    while(true){
+      visited[cur] = 1;
+      loopEdges.push_back (cur);
+      loop.push_back (boundary[cur].vrt[0]);
+
+    //  find the unique edge which starts at the end of 'cur'
+      EdgeWithTri <index_t> key;
+      key.vrt[0] = boundary[cur].vrt[1];
+      key.vrt[1] = 0;
+      const size_t next = lower_bound (boundary.begin(), boundary.end(), key)
+                          - boundary.begin();
+      if(next == boundary.size() || boundary[next].vrt[0] != key.vrt[0] ||
+         (next + 1 < boundary.size() && boundary[next + 1].vrt[0] == key.vrt[0]))
+      {
+        valid = false;
+        break;
+      }
+
+      if(next == ib)
+        break;
+      if(visited[next]){
+        valid = false;
+        break;
+      }
+      cur = next;
+    }
+
+    const index_t adjTri = boundary[ib].tri;
+    if(!valid || loop.size() > maxLoopSize || loop.size() < 3 ||
+       !hasInterior[FindRoot (parents, adjTri)])
+    {
+      continue;
+    }
+
+  //  append the new triangles to the solid of the triangle adjacent to the hole
+    size_t solid = 0;
+    while(solid + 2 < solidRangesInOut.size() && solidRangesInOut[solid + 1] <= adjTri)
+      ++solid;
+
+    TriangulateLoop (coords, loop, newTrisPerSolid[solid]);
+    ++numFilled;
+  }
+
+  if(numFilled == 0)
+    return 0;
+
+//  rebuild the triangle and normal arrays with new triangles at the end of their solids
+  TIndexContainer1 newTris;
+  TNumberContainer2 newNormals;
+  TIndexContainer2 newSolids;
+  const bool hasSolids = solidRangesInOut.size() >= 2;
+  for(size_t is = 0; is < newTrisPerSolid.size(); ++is){
+    const size_t begin = hasSolids ? static_cast<size_t> (solidRangesInOut[is]) : 0;
+    const size_t end = hasSolids ? static_cast<size_t> (solidRangesInOut[is + 1]) : numTris;
+    newSolids.push_back (static_cast<index_t> (newTris.size() / 3));
+    for(size_t i = begin * 3; i < end * 3; ++i){
+      newTris.push_back (trisInOut[i]);
+      newNormals.push_back (normalsInOut[i]);
+    }
+
+    const vector<index_t>& added = newTrisPerSolid[is];
+    for(size_t i = 0; i < added.size(); i += 3){
+      normal_t n[3];
+      ComputeTriNormal (coords, added[i], added[i + 1], added[i + 2], n);
+      for(size_t j = 0; j < 3; ++j){
+        newTris.push_back (added[i + j]);
+        newNormals.push_back (n[j]);
+      }
+    }
+  }
+  newSolids.push_back (static_cast<index_t> (newTris.size() / 3));
+
+  using std::swap;
+  swap (trisInOut, newTris);
+  swap (normalsInOut, newNormals);
+  if(hasSolids)
+    swap (solidRangesInOut, newSolids);
+
+  return numFilled;
+}
+
+template <class TIndexContainer1, class TIndexContainer2>
+void ValidateMesh (const TIndexContainer1& tris,
+                   const TIndexContainer2& solidRanges,
+                   std::vector <MeshValidation>& reportsOut,
+                   unsigned int numThreads)
+{
+  using namespace stl_reader_impl;
+
+  const size_t numSolids = solidRanges.size() < 2 ? 0 : solidRanges.size() - 1;
+  reportsOut.assign (numSolids, MeshValidation());
+
+  ValidateSolidsFunc <TIndexContainer1, TIndexContainer2> func;
+  func.tris = &tris;
+  func.solidRanges = &solidRanges;
+  func.reports = &reportsOut;
+  ParallelFor (numSolids, 1, func, numThreads);
+}
+
+
+template <class TNumberContainer, class TIndexContainer1, class TIndexContainer2>
+void FindSelfIntersections (const TNumberContainer& coords,
+                            const TIndexContainer1& tris,
+                            TIndexContainer2& pairsOut,
+                            unsigned int numThreads)
+{
+  using namespace std;
+  using namespace stl_reader_impl;
+
+  typedef typename TIndexContainer2::value_type index_t;
+
+  pairsOut.clear();
+  const size_t numTris = tris.size() / 3;
+
+  TriangleBvh bvh;
+  bvh.build (coords, tris);
+
+  const size_t grainSize = 1024;
+  vector<vector<size_t> > pairsPerChunk ((numTris + grainSize - 1) / grainSize);
+
+  SelfIntersectionsFunc <TNumberContainer, TIndexContainer1> func;
+  func.coords = &coords;
+  func.tris = &tris;
+  func.bvh = &bvh;
+  func.grainSize = grainSize;
+  func.pairsPerChunk = &pairsPerChunk;
+  ParallelFor (numTris, grainSize, func, numThreads);
+
+  for(size_t i = 0; i < pairsPerChunk.size(); ++i){
+    for(size_t j = 0; j < pairsPerChunk[i].size(); ++j)
+      pairsOut.push_back (static_cast<index_t> (pairsPerChunk[i][j]));
+  }
+}
+
+
+template <class TNumber>
+template <class TNumberContainer, class TIndexContainer>
+void SignedDistanceField<TNumber>::
+compute (const TNumberContainer& coords,
+         const TIndexContainer& tris,
+         const double spacing,
+         const double bandWidth,
+         const unsigned int numThreads)
+{
+  using namespace std;
+  using namespace stl_reader_impl;
+
+  m_spacing = spacing;
+  m_bandWidth = bandWidth;
+  m_blockOffsets.clear();
+  m_blockSigns.clear();
+  m_values.clear();
+
+  const size_t numVrts = coords.size() / 3;
+  double lo[3], hi[3];
+  for(size_t i = 0; i < 3; ++i){
+    lo[i] = numVrts > 0 ? numeric_limits<double>::max() : 0;
+    hi[i] = numVrts > 0 ? -numeric_limits<double>::max() : 0;
+  }
+  for(size_t iv = 0; iv < numVrts; ++iv){
+    for(size_t i = 0; i < 3; ++i){
+      lo[i] = min (lo[i], static_cast<double> (coords[iv * 3 + i]));
+      hi[i] = max (hi[i], static_cast<double> (coords[iv * 3 + i]));
+    }
+  }
+
+  const double padding = (bandWidth < numeric_limits<double>::max() ? bandWidth : 0) + spacing;
+  const size_t bs = block_size();
+  for(size_t i = 0; i < 3; ++i){
+    m_origin[i] = lo[i] - padding;
+    m_numSamples[i] = static_cast<size_t> (ceil ((hi[i] + padding - m_origin[i]) / spacing)) + 1;
+    m_numBlocks[i] = (m_numSamples[i] + bs - 1) / bs;
+  }
+
+  const size_t numBlocks = m_numBlocks[0] * m_numBlocks[1] * m_numBlocks[2];
+  m_blockOffsets.resize (numBlocks);
+  m_blockSigns.resize (numBlocks);
+
+  TriangleBvh bvh;
+  bvh.build (coords, tris);
+  Pseudonormals pseudonormals;
+  pseudonormals.compute (coords, tris);
+
+  SdfBlocksFunc <TNumberContainer, TIndexContainer, TNumber> func;
+  func.coords = &coords;
+  func.tris = &tris;
+  func.bvh = &bvh;
+  func.pseudonormals = &pseudonormals;
+  func.origin = m_origin;
+  func.spacing = spacing;
+  func.bandWidth = bandWidth;
+  func.numSamples = m_numSamples;
+  func.numBlocks = m_numBlocks;
+  func.blockSize = bs;
+  func.blockOffsets = &m_blockOffsets;
+  func.blockSigns = &m_blockSigns;
+  func.values = &m_values;
+
+//  first classify blocks, then allocate and fill those in the narrow band
+  func.computeValues = false;
+  ParallelFor (numBlocks, 16, func, numThreads);
+
+  long long numValues = 0;
+  for(size_t i = 0; i < numBlocks; ++i){
+    if(m_blockOffsets[i] >= 0){
+      m_blockOffsets[i] = numValues;
+      numValues += static_cast<long long> (block_volume());
+    }
+  }
+  m_values.resize (static_cast<size_t> (numValues));
+
+  func.computeValues = true;
+  ParallelFor (numBlocks, 1, func, numThreads);
+}
+
+
+template <class TNumberContainer, class TIndexContainer>
+SurfaceSampler<TNumberContainer, TIndexContainer>::
+SurfaceSampler (const TNumberContainer& coords, const TIndexContainer& tris) :
+  m_coords (&coords),
+  m_tris (&tris)
+{
+  using namespace stl_reader_impl;
+
+  const size_t numTris = tris.size() / 3;
+  m_areaCdf.resize (numTris);
+  double sum = 0;
+  for(size_t itri = 0; itri < numTris; ++itri){
+    double c[3][3];
+    LoadTriCorners (coords, tris, itri, c);
+    double a[3], b[3];
+    for(size_t i = 0; i < 3; ++i){
+      a[i] = c[1][i] - c[0][i];
+      b[i] = c[2][i] - c[0][i];
+    }
+    const double n[3] = {a[1] * b[2] - a[2] * b[1],
+                         a[2] * b[0] - a[0] * b[2],
+                         a[0] * b[1] - a[1] * b[0]};
+    sum += 0.5 * sqrt (Dot (n, n));
+    m_areaCdf[itri] = sum;
+  }
+}
+
+
+template <class TNumberContainer, class TIndexContainer>
+template <class TNumber>
+void SurfaceSampler<TNumberContainer, TIndexContainer>::
+sample (const size_t first,
+        const size_t count,
+        const unsigned long long seed,
+        SurfaceSamples <TNumber>& samplesOut,
+        const unsigned int numThreads) const
+{
+  using namespace stl_reader_impl;
+
+  if(area() <= 0){
+    samplesOut.resize (0);
+    return;
+  }
+
+  samplesOut.resize (count);
+  SurfaceSampleFunc <TNumberContainer, TIndexContainer, TNumber> func;
+  func.coords = m_coords;
+  func.tris = m_tris;
+  func.areaCdf = &m_areaCdf;
+  func.first = first;
+  func.seed = seed;
+  func.samples = &samplesOut;
+  ParallelFor (count, 4096, func, numThreads);
+}
+
+
+template <class TNumberContainer, class TIndexContainer>
+template <class TNumber>
+void SurfaceSampler<TNumberContainer, TIndexContainer>::
+sample_poisson_disk (const double radius,
+                     const unsigned long long seed,
+                     SurfaceSamples <TNumber>& samplesOut) const
+{
+  using namespace std;
+  using namespace stl_reader_impl;
+
+  samplesOut.resize (0);
+  if(area() <= 0 || radius <= 0)
+    return;
+
+  SurfaceSamples <double> candidates;
+  const size_t numCandidates = static_cast<size_t> (ceil (8. * area() / (radius * radius)));
+  sample (0, numCandidates, seed, candidates);
+
+//  accepted points are stored in a hashed grid with cells of size 'radius',
+//  so that conflicting points can only lie in the 27 surrounding cells.
+  vector<vector<size_t> > buckets (max<size_t> (numCandidates / 4, 16));
+  vector<size_t> accepted;
+  const double radiusSq = radius * radius;
+
+  for(size_t ic = 0; ic < numCandidates; ++ic){
+    const double p[3] = {candidates.x[ic], candidates.y[ic], candidates.z[ic]};
+    long long cell[3];
+    for(size_t d = 0; d < 3; ++d)
+      cell[d] = static_cast<long long> (floor (p[d] / radius));
+
+    bool conflict = false;
+    for(long long k = -1; k <= 1 && !conflict; ++k){
+      for(long long j = -1; j <= 1 && !conflict; ++j){
+        for(long long i = -1; i <= 1 && !conflict; ++i){
+          const vector<size_t>& bucket = buckets[CellHash (cell[0] + i, cell[1] + j, cell[2] + k) % buckets.size()];
+          for(size_t ib = 0; ib < bucket.size() && !conflict; ++ib){
+            const size_t o = bucket[ib];
+            const double d[3] = {candidates.x[o] - p[0], candidates.y[o] - p[1], candidates.z[o] - p[2]};
+            conflict = Dot (d, d) < radiusSq;
+          }
+        }
+      }
+    }
+
+    if(!conflict){
+      buckets[CellHash (cell[0], cell[1], cell[2]) % buckets.size()].push_back (ic);
+      accepted.push_back (ic);
+    }
+  }
+
+  samplesOut.resize (accepted.size());
+  for(size_t i = 0; i < accepted.size(); ++i){
+    const size_t ic = accepted[i];
+    samplesOut.x[i] = static_cast<TNumber> (candidates.x[ic]);
+    samplesOut.y[i] = static_cast<TNumber> (candidates.y[ic]);
+    samplesOut.z[i] = static_cast<TNumber> (candidates.z[ic]);
+    samplesOut.nx[i] = static_cast<TNumber> (candidates.nx[ic]);
+    samplesOut.ny[i] = static_cast<TNumber> (candidates.ny[ic]);
+    samplesOut.nz[i] = static_cast<TNumber> (candidates.nz[ic]);
+    samplesOut.tris[i] = candidates.tris[ic];
+  }
+}
+
+
+template <class TNumberContainer1, class TNumberContainer2, class TNumberContainer3,
+          class TIndexContainer1, class TIndexContainer2>
+bool ConvexHull (const TNumberContainer1& coords,
+                 TNumberContainer2& hullCoordsOut,
+                 TNumberContainer3& hullNormalsOut,
+                 TIndexContainer1& hullTrisOut,
+                 TIndexContainer2& hullSolidsOut,
+                 unsigned int numThreads)
+{
+  using namespace std;
+  using namespace stl_reader_impl;
+
+  typedef typename TNumberContainer2::value_type  number_t;
+  typedef typename TNumberContainer3::value_type  normal_t;
+  typedef typename TIndexContainer1::value_type   index_t;
+
+  hullCoordsOut.clear();
+  hullNormalsOut.clear();
+  hullTrisOut.clear();
+  hullSolidsOut.clear();
+
+  vector<double> points (coords.size());
+  double scale = 0;
+  for(size_t i = 0; i < coords.size(); ++i){
+    points[i] = static_cast<double> (coords[i]);
+    scale = max (scale, fabs (points[i]));
+  }
+
+  QuickHull hull (points, 1.e-12 * max (scale, 1.e-300) * 3);
+  size_t tet[4];
+  if(!hull.init (tet))
+    return false;
+
+  vector<size_t> faceOfPoint (points.size() / 3);
+  HullAssignFunc func;
+  func.hull = &hull;
+  func.faceOfPoint = &faceOfPoint;
+  ParallelFor (faceOfPoint.size(), 16384, func, numThreads);
+  hull.set_outside (faceOfPoint);
+  hull.run ();
+
+//  write the alive faces, compacting the hull vertices
+  const vector<HullFace>& faces = hull.faces();
+  vector<size_t> newInd (points.size() / 3, numeric_limits<size_t>::max());
+  size_t numVrts = 0;
+  for(size_t i = 0; i < faces.size(); ++i){
+    if(!faces[i].alive)
+      continue;
+    for(size_t j = 0; j < 3; ++j){
+      const size_t v = faces[i].v[j];
+      if(newInd[v] == numeric_limits<size_t>::max()){
+        newInd[v] = numVrts++;
+        for(size_t d = 0; d < 3; ++d)
+          hullCoordsOut.push_back (static_cast<number_t> (coords[v * 3 + d]));
+      }
+      hullTrisOut.push_back (static_cast<index_t> (newInd[v]));
+    }
+    for(size_t d = 0; d < 3; ++d)
+      hullNormalsOut.push_back (static_cast<normal_t> (faces[i].normal[d]));
+  }
+
+  hullSolidsOut.push_back (0);
+  hullSolidsOut.push_back (static_cast<typename TIndexContainer2::value_type> (hullTrisOut.size() / 3));
+  return true;
+}
+
+
+template <class TNumberContainer>
+OrientedBox ComputeOrientedBox (const TNumberContainer& coords)
+{
+  std::vector <double> points (coords.size());
+  for(size_t i = 0; i < coords.size(); ++i)
+    points[i] = static_cast<double> (coords[i]);
+  return stl_reader_impl::FitOrientedBox (points);
+}
+
+
+template <class TNumberContainer, class TIndexContainer1, class TIndexContainer2>
+void ComputeOrientedBoxes (const TNumberContainer& coords,
+                           const TIndexContainer1& tris,
+                           const TIndexContainer2& solidRanges,
+                           std::vector <OrientedBox>& boxesOut,
+                           unsigned int numThreads)
+{
+  using namespace stl_reader_impl;
+
+  const size_t numSolids = solidRanges.size() < 2 ? 0 : solidRanges.size() - 1;
+  boxesOut.resize (numSolids);
+
+  SolidBoxesFunc <TNumberContainer, TIndexContainer1, TIndexContainer2> func;
+  func.coords = &coords;
+  func.tris = &tris;
+  func.solidRanges = &solidRanges;
+  func.boxes = &boxesOut;
+  ParallelFor (numSolids, 1, func, numThreads);
+}
+
+
+template <class TNumberContainer, class TIndexContainer>
+TriangleGrid<TNumberContainer, TIndexContainer>::
+TriangleGrid (const TNumberContainer& coords,
+              const TIndexContainer& tris,
+              double cellSize,
+              unsigned int numThreads) :
+  m_coords (&coords),
+  m_tris (&tris),
+  m_cellSize (1)
+{
+  using namespace std;
+  using namespace stl_reader_impl;
+
+  const size_t numTris = tris.size() / 3;
+  double lo[3] = {0, 0, 0}, hi[3] = {0, 0, 0};
+  for(size_t itri = 0; itri < numTris; ++itri){
+    double tLo[3], tHi[3];
+    TriBox (coords, tris, itri, tLo, tHi);
+    for(size_t d = 0; d < 3; ++d){
+      lo[d] = itri == 0 ? tLo[d] : min (lo[d], tLo[d]);
+      hi[d] = itri == 0 ? tHi[d] : max (hi[d], tHi[d]);
+    }
+  }
+
+  const double maxExtent = max (hi[0] - lo[0], max (hi[1] - lo[1], hi[2] - lo[2]));
+  if(cellSize <= 0){
+  //  choose cells such that there are about as many cells as triangles,
+  //  ignoring flat dimensions of the bounding box
+    double volume = 1;
+    size_t numDims = 0;
+    for(size_t d = 0; d < 3; ++d){
+      if(hi[d] - lo[d] > 1.e-6 * maxExtent){
+        volume *= hi[d] - lo[d];
+        ++numDims;
+      }
+    }
+    cellSize = numDims == 0 ? 1 : pow (volume / static_cast<double> (max<size_t> (numTris, 1)),
+                                       1. / static_cast<double> (numDims));
+  }
+  m_cellSize = cellSize;
+
+  for(size_t d = 0; d < 3; ++d){
+    m_origin[d] = lo[d];
+    m_numCells[d] = max<size_t> (1, static_cast<size_t> (ceil ((hi[d] - lo[d]) / cellSize)));
+  }
+  const size_t numCells = m_numCells[0] * m_numCells[1] * m_numCells[2];
+
+//  count the cells per triangle, compute offsets and write the cell of each entry
+  vector<size_t> entryOffsets (numTris + 1, 0);
+  vector<size_t> entryCells;
+  GridCellsFunc <TNumberContainer, TIndexContainer> func;
+  func.coords = &coords;
+  func.tris = &tris;
+  func.origin = m_origin;
+  func.cellSize = m_cellSize;
+  func.numCells = m_numCells;
+  func.fill = false;
+  func.entryOffsets = &entryOffsets;
+  func.entryCells = &entryCells;
+  ParallelFor (numTris, 4096, func, numThreads);
+
+  for(size_t i = 1; i <= numTris; ++i)
+    entryOffsets[i] += entryOffsets[i - 1];
+  entryCells.resize (entryOffsets.back());
+  func.fill = true;
+  ParallelFor (numTris, 4096, func, numThreads);
+
+//  counting sort of the entries by cell with one histogram per block of
+//  triangles. The number of blocks is bounded, since each block holds a
+//  counter per cell.
+  size_t numBlocks = 1;
+  #ifdef STL_READER_THREADS
+    numBlocks = numThreads == 0 ? thread::hardware_concurrency() : numThreads;
+  #endif
+  numBlocks = max<size_t> (1, min<size_t> (min<size_t> (numBlocks, 8), numTris / 4096));
 
+  vector<size_t> blockCounts (numBlocks * numCells, 0);
+  m_cellOffsets.assign (numCells + 1, 0);
+  m_cellTris.resize (entryCells.size());
 
-namespace stl_reader_impl {
+  GridSortFunc sortFunc;
+  sortFunc.numTris = numTris;
+  sortFunc.numBlocks = numBlocks;
+  sortFunc.numCells = numCells;
+  sortFunc.entryOffsets = &entryOffsets;
+  sortFunc.entryCells = &entryCells;
+  sortFunc.cellOffsets = &m_cellOffsets;
+  sortFunc.blockCounts = &blockCounts;
+  sortFunc.cellTris = &m_cellTris;
+  sortFunc.scatter = false;
+  ParallelFor (numBlocks, 1, sortFunc, numThreads);
 
-  // a coordinate triple with an additional index. The index is required
-  // for RemoveDoubles, so that triangles can be reindexed properly.
-  template <typename number_t, typename index_t>
-  struct CoordWithIndex {
-    number_t data[3];
-    index_t index;
+  GridBlockOffsetsFunc offsetsFunc;
+  offsetsFunc.numBlocks = numBlocks;
+  offsetsFunc.numCells = numCells;
+  offsetsFunc.blockCounts = &blockCounts;
+  offsetsFunc.cellOffsets = &m_cellOffsets;
+  ParallelFor (numCells, 4096, offsetsFunc, numThreads);
 
-    bool operator == (const CoordWithIndex& c) const
-    {
-      return (c[0] == data[0]) && (c[1] == data[1]) && (c[2] == data[2]);
-    }
+  for(size_t i = 1; i <= numCells; ++i)
+    m_cellOffsets[i] += m_cellOffsets[i - 1];
 
-    bool operator != (const CoordWithIndex& c) const
-    {
-      return (c[0] != data[0]) || (c[1] != data[1]) || (c[2] != data[2]);
-    }
+  sortFunc.scatter = true;
+  ParallelFor (numBlocks, 1, sortFunc, numThreads);
+}
 
-    bool operator < (const CoordWithIndex& c) const
-    {
-      return (data[0] < c[0])
-          || (data[0] == c[0] && data[1] < c[1])
-          || (data[0] == c[0] && data[1] == c[1] && data[2] < c[2]);
-    }
 
-    inline number_t& operator [] (const size_t i)   {return data[i];}
-    inline number_t operator [] (const size_t i) const  {return data[i];}
-  };
+template <class TNumberContainer, class TIndexContainer>
+bool TriangleGrid<TNumberContainer, TIndexContainer>::
+cell_range (const double* lo, const double* hi, size_t* cellLo, size_t* cellHi) const
+{
+  for(size_t d = 0; d < 3; ++d){
+    const double cLo = floor ((lo[d] - m_origin[d]) / m_cellSize);
+    const double cHi = floor ((hi[d] - m_origin[d]) / m_cellSize);
+    const double maxCell = static_cast<double> (m_numCells[d] - 1);
+    if(cHi < 0 || cLo > maxCell || lo[d] > hi[d])
+      return false;
+    cellLo[d] = static_cast<size_t> (std::max (0., cLo));
+    cellHi[d] = static_cast<size_t> (std::min (maxCell, cHi));
+  }
+  return true;
+}
 
-  // sorts the array coordsWithIndexInOut and copies unique indices to coordsOut.
-  // Triangle-corners are re-indexed on the fly and degenerated triangles are removed.
-  template <class TNumberContainer1, class TNumberContainer2,
-            class TIndexContainer1, class TIndexContainer2>
-  void RemoveDoubles (TNumberContainer1& uniqueCoordsOut,
-                      TIndexContainer1& trisInOut,
-                      TNumberContainer2& normalsInOut,
-                      TIndexContainer2& solidsInOut,
-                      std::vector <CoordWithIndex<
-                        typename TNumberContainer1::value_type,
-                        typename TIndexContainer1::value_type> >
-                        &coordsWithIndexInOut)
-  {
-    using namespace std;
 
-    typedef typename TNumberContainer1::value_type number_t;
-    typedef typename TIndexContainer1::value_type  index_t;
+template <class TNumberContainer, class TIndexContainer>
+void TriangleGrid<TNumberContainer, TIndexContainer>::
+query_box (const double* lo, const double* hi, std::vector <size_t>& trisOut) const
+{
+  using namespace stl_reader_impl;
 
-    sort (coordsWithIndexInOut.begin(), coordsWithIndexInOut.end());
-  
-  //  first count unique indices
-    index_t numUnique = 1;
-    for(size_t i = 1; i < coordsWithIndexInOut.size(); ++i){
-      if(coordsWithIndexInOut[i] != coordsWithIndexInOut[i - 1])
-        ++numUnique;
+  trisOut.clear();
+  size_t cLo[3], cHi[3];
+  if(m_cellTris.empty() || !cell_range (lo, hi, cLo, cHi))
+    return;
+
+  for(size_t k = cLo[2]; k <= cHi[2]; ++k){
+    for(size_t j = cLo[1]; j <= cHi[1]; ++j){
+      for(size_t i = cLo[0]; i <= cHi[0]; ++i){
+        for(const size_t* t = cell_tris_begin (i, j, k); t != cell_tris_end (i, j, k); ++t){
+          double tLo[3], tHi[3];
+          TriBox (*m_coords, *m_tris, *t, tLo, tHi);
+          if(tLo[0] <= hi[0] && tLo[1] <= hi[1] && tLo[2] <= hi[2] &&
+             lo[0] <= tHi[0] && lo[1] <= tHi[1] && lo[2] <= tHi[2])
+          {
+            trisOut.push_back (*t);
+          }
+        }
+      }
     }
+  }
 
-    uniqueCoordsOut.resize (numUnique * 3);
-    vector<index_t> newIndex (coordsWithIndexInOut.size());
+  std::sort (trisOut.begin(), trisOut.end());
+  trisOut.erase (std::unique (trisOut.begin(), trisOut.end()), trisOut.end());
+}
 
-    TIndexContainer2 newSolids;
 
-  //  copy unique coordinates to 'uniqueCoordsOut' and create an index-map
-  //  'newIndex', which allows to re-index triangles later on.
-    index_t curInd = 0;
-    newIndex[coordsWithIndexInOut[0].index] = 0;
-    for(index_t i = 0; i < 3; ++i)
-      uniqueCoordsOut[i] = coordsWithIndexInOut[0][i];
+template <class TNumberContainer, class TIndexContainer>
+bool TriangleGrid<TNumberContainer, TIndexContainer>::
+intersect_ray (const double* origin, const double* dir, double tMax,
+               size_t& triOut, double& tOut) const
+{
+  using namespace std;
+  using namespace stl_reader_impl;
 
-    for(size_t i = 1; i < coordsWithIndexInOut.size(); ++i){
-      const CoordWithIndex <number_t, index_t> c = coordsWithIndexInOut[i];
-      if(c != coordsWithIndexInOut[i - 1]){
-        ++curInd;
-        for(index_t j = 0; j < 3; ++j)
-          uniqueCoordsOut[curInd * 3 + j] = coordsWithIndexInOut[i][j];
-      }
+  if(m_cellTris.empty() || Dot (dir, dir) == 0)
+    return false;
 
-      newIndex[c.index] = static_cast<index_t> (curInd);
+//  clip the ray to the grid bounds
+  double tEnter = 0, tExit = tMax;
+  for(size_t d = 0; d < 3; ++d){
+    const double lo = m_origin[d];
+    const double hi = m_origin[d] + m_cellSize * static_cast<double> (m_numCells[d]);
+    if(dir[d] == 0){
+      if(origin[d] < lo || origin[d] > hi)
+        return false;
+      continue;
     }
+    double t0 = (lo - origin[d]) / dir[d];
+    double t1 = (hi - origin[d]) / dir[d];
+    if(t0 > t1)
+      std::swap (t0, t1);
+    tEnter = max (tEnter, t0);
+    tExit = min (tExit, t1);
+  }
+  if(tEnter > tExit)
+    return false;
 
-  //  re-index triangles, so that they refer to 'uniqueCoordsOut'
-  //  make sure to only add triangles which refer to three different indices
-    index_t numUniqueTriInds = 0;
-    for(index_t i = 0; i < trisInOut.size(); i+=3){
-      
-      const index_t triInd = i / 3;
-      const index_t newTriInd = numUniqueTriInds / 3;
-      if (newSolids.size () < solidsInOut.size () &&
-          solidsInOut [newSolids.size ()] <= triInd)
-      {
-        newSolids.push_back (newTriInd);
-      }
-
-      index_t ni[3];
-      for(index_t j = 0; j < 3; ++j)
-        ni[j] = newIndex[trisInOut[i+j]];
+//  initialize the DDA at the entry point
+  long long cell[3], step[3], numCells[3];
+  double tNext[3], tDelta[3];
+  for(size_t d = 0; d < 3; ++d){
+    numCells[d] = static_cast<long long> (m_numCells[d]);
+    const double p = origin[d] + tEnter * dir[d];
+    cell[d] = min (numCells[d] - 1, max (0LL, static_cast<long long> (floor ((p - m_origin[d]) / m_cellSize))));
+    if(dir[d] > 0){
+      step[d] = 1;
+      tNext[d] = (m_origin[d] + static_cast<double> (cell[d] + 1) * m_cellSize - origin[d]) / dir[d];
+      tDelta[d] = m_cellSize / dir[d];
+    }
+    else if(dir[d] < 0){
+      step[d] = -1;
+      tNext[d] = (m_origin[d] + static_cast<double> (cell[d]) * m_cellSize - origin[d]) / dir[d];
+      tDelta[d] = -m_cellSize / dir[d];
+    }
+    else{
+      step[d] = 0;
+      tNext[d] = numeric_limits<double>::infinity();
+      tDelta[d] = numeric_limits<double>::infinity();
+    }
+  }
 
-      if((ni[0] != ni[1]) && (ni[0] != ni[2]) && (ni[1] != ni[2])){
-        for(index_t j = 0; j < 3; ++j)
-        {
-          trisInOut[numUniqueTriInds + j] = ni[j];
-          normalsInOut[numUniqueTriInds + j] = normalsInOut [i + j];
-        }
-        numUniqueTriInds += 3;
+  bool found = false;
+  tOut = tMax;
+  while(true){
+    const size_t i = static_cast<size_t> (cell[0]);
+    const size_t j = static_cast<size_t> (cell[1]);
+    const size_t k = static_cast<size_t> (cell[2]);
+    for(const size_t* t = cell_tris_begin (i, j, k); t != cell_tris_end (i, j, k); ++t){
+      double c[3][3];
+      LoadTriCorners (*m_coords, *m_tris, *t, c);
+      double tHit;
+      if(RayTriIntersect (origin, dir, c, tHit) && tHit >= 0 && tHit <= tOut &&
+         (!found || tHit < tOut || *t < triOut))
+      {
+        tOut = tHit;
+        triOut = *t;
+        found = true;
       }
     }
 
-    if(numUniqueTriInds < trisInOut.size())
-    {
-      trisInOut.resize (numUniqueTriInds);
-      normalsInOut.resize (numUniqueTriInds);
-    }
+  //  hits behind the exit of the current cell may be preceded by hits in later cells
+    const size_t axis = (tNext[0] < tNext[1]) ? (tNext[0] < tNext[2] ? 0 : 2)
+                                              : (tNext[1] < tNext[2] ? 1 : 2);
+    if(found && tOut <= tNext[axis])
+      return true;
+    if(tNext[axis] > tExit)
+      return found;
 
-    if (!newSolids.empty ())
-      newSolids.push_back (numUniqueTriInds / 3);
-    
-    using std::swap;
-    swap (solidsInOut, newSolids);
+    cell[axis] += step[axis];
+    if(cell[axis] < 0 || cell[axis] >= numCells[axis])
+      return found;
+    tNext[axis] += tDelta[axis];
   }
-}// end of namespace stl_reader_impl
+}
 
 
-template <class TNumberContainer1, class TNumberContainer2,
-          class TIndexContainer1, class TIndexContainer2>
-bool ReadStlFile(const char* filename,
-                 TNumberContainer1& coordsOut,
-                 TNumberContainer2& normalsOut,
-                 TIndexContainer1& trisOut,
-                 TIndexContainer2& solidRangesOut)
+template <class TNumberContainer1, class TIndexContainer1,
+          class TNumberContainer2, class TIndexContainer2,
+          class TDeviationContainer>
+MeshDeviation ComputeMeshDeviation (const TNumberContainer1& coordsA,
+                                    const TIndexContainer1& trisA,
+                                    const TNumberContainer2& coordsB,
+                                    const TIndexContainer2& trisB,
+                                    const size_t numSamples,
+                                    TDeviationContainer& vrtDeviationsOut,
+                                    unsigned int numThreads)
 {
-  if(StlFileHasASCIIFormat(filename))
-    return ReadStlFile_ASCII(filename, coordsOut, normalsOut, trisOut, solidRangesOut);
-  else
-    return ReadStlFile_BINARY(filename, coordsOut, normalsOut, trisOut, solidRangesOut);
+  using namespace std;
+  using namespace stl_reader_impl;
+
+  TriangleBvh bvhA, bvhB;
+  bvhA.build (coordsA, trisA);
+  bvhB.build (coordsB, trisB);
+
+  MeshDeviation deviation;
+  vector<double> vrtDistances;
+  DirectedDeviation (coordsB, trisB, coordsA, trisA, bvhA, numSamples, 1, numThreads,
+                     vrtDistances, deviation.maxDistBA, deviation.meanDistBA);
+  DirectedDeviation (coordsA, trisA, coordsB, trisB, bvhB, numSamples, 0, numThreads,
+                     vrtDistances, deviation.maxDistAB, deviation.meanDistAB);
+
+  vrtDeviationsOut.resize (vrtDistances.size());
+  for(size_t i = 0; i < vrtDistances.size(); ++i)
+    vrtDeviationsOut[i] = static_cast<typename TDeviationContainer::value_type> (vrtDistances[i]);
+
+  return deviation;
 }
 
 
 template <class TNumberContainer1, class TNumberContainer2,
           class TIndexContainer1, class TIndexContainer2>
-bool ReadStlFile_ASCII(const char* filename,
-                       TNumberContainer1& coordsOut,
-                       TNumberContainer2& normalsOut,
-                       TIndexContainer1& trisOut,
-                       TIndexContainer2& solidRangesOut)
+bool ExtractSolid (const TNumberContainer1& coords,
+                   const TNumberContainer2& normals,
+                   const TIndexContainer1& tris,
+                   const TIndexContainer2& solids,
+                   const size_t solidIndex,
+                   TNumberContainer1& coordsOut,
+                   TNumberContainer2& normalsOut,
+                   TIndexContainer1& trisOut,
+                   TIndexContainer2& solidsOut)
 {
   using namespace std;
   using namespace stl_reader_impl;
 
-  typedef typename TNumberContainer1::value_type  number_t;
   typedef typename TIndexContainer1::value_type index_t;
+  typedef typename TIndexContainer2::value_type solid_index_t;
 
-  coordsOut.clear();
-  normalsOut.clear();
-  trisOut.clear();
-  solidRangesOut.clear();
+  STL_READER_COND_THROW (solidIndex + 1 >= solids.size(),
+                         "Invalid solid index " << solidIndex << " in ExtractSolid");
 
-  ifstream in(filename);
-  STL_READER_COND_THROW(!in, "Couldn't open file " << filename);
+  const size_t triBegin = static_cast<size_t> (solids[solidIndex]);
+  const size_t triEnd = static_cast<size_t> (solids[solidIndex + 1]);
+  const size_t numCorners = 3 * (triEnd - triBegin);
 
-  vector<CoordWithIndex <number_t, index_t> > coordsWithIndex;
+//  collect the sorted indices of all referenced vertices
+  vector<unsigned long long> vrts (numCorners);
+  unsigned long long maxVrt = 0;
+  for(size_t i = 0; i < numCorners; ++i){
+    vrts[i] = static_cast<unsigned long long> (tris[3 * triBegin + i]);
+    maxVrt = max (maxVrt, vrts[i]);
+  }
+  vector<unsigned long long> scratch;
+  RadixSort (vrts, scratch, IdentityKey(), NumBits (maxVrt));
+  vrts.erase (unique (vrts.begin(), vrts.end()), vrts.end());
+
+  coordsOut.resize (3 * vrts.size());
+  for(size_t i = 0; i < vrts.size(); ++i){
+    for(size_t d = 0; d < 3; ++d)
+      coordsOut[3 * i + d] = coords[3 * static_cast<size_t> (vrts[i]) + d];
+  }
 
-  string buffer;
-  vector<string> tokens;
-  int lineCount = 1;
-  int maxNumTokens = 0;
-  size_t numFaceVrts = 0;
+  normalsOut.resize (numCorners);
+  for(size_t i = 0; i < numCorners; ++i)
+    normalsOut[i] = normals[3 * triBegin + i];
 
-  while(!(in.eof() || in.fail()))
-  {
-  //  read the line and tokenize.
-  //  In order to reuse memory in between lines, 'tokens' won't be cleared.
-  //  Instead we count the number of tokens using 'tokenCount'.
-    getline(in, buffer);
+  trisOut.resize (numCorners);
+  for(size_t i = 0; i < numCorners; ++i){
+    const unsigned long long vrt = static_cast<unsigned long long> (tris[3 * triBegin + i]);
+    trisOut[i] = static_cast<index_t> (lower_bound (vrts.begin(), vrts.end(), vrt) - vrts.begin());
+  }
+
+  solidsOut.resize (2);
+  solidsOut[0] = 0;
+  solidsOut[1] = static_cast<solid_index_t> (triEnd - triBegin);
+  return true;
+}
+
+
+template <class TNumberContainer, class TIndexContainer1, class TIndexContainer2>
+size_t FindSolidInstances (const TNumberContainer& coords,
+                           const TIndexContainer1& tris,
+                           const TIndexContainer2& solidRanges,
+                           std::vector <SolidInstance>& instancesOut,
+                           const double tolerance,
+                           unsigned int numThreads)
+{
+  using namespace stl_reader_impl;
+
+  const size_t numSolids = solidRanges.size() < 2 ? 0 : solidRanges.size() - 1;
+  std::vector <SolidShape> shapes (numSolids);
+
+  SolidShapesFunc <TNumberContainer, TIndexContainer1, TIndexContainer2> func;
+  func.coords = &coords;
+  func.tris = &tris;
+  func.solidRanges = &solidRanges;
+  func.shapes = &shapes;
+  ParallelFor (numSolids, 1, func, numThreads);
+
+//  prototypes grouped by their numbers of vertices and triangles
+  typedef std::pair <size_t, size_t> signature_t;
+  std::map <signature_t, std::vector <size_t> > prototypes;
+  size_t numPrototypes = 0;
+
+  instancesOut.resize (numSolids);
+  for(size_t is = 0; is < numSolids; ++is){
+    SolidInstance& instance = instancesOut[is];
+    const SolidShape& shape = shapes[is];
+    std::vector <size_t>& candidates =
+        prototypes[signature_t (shape.points.size(), shape.tris.size())];
 
-    istringstream line(buffer);
-    int tokenCount = 0;
-    while(!(line.eof() || line.fail())){
-      if(tokenCount >= maxNumTokens){
-        maxNumTokens = tokenCount + 1;
-        tokens.resize(maxNumTokens);
+    instance.prototype = is;
+    for(size_t i = 0; i < candidates.size(); ++i){
+      if(MatchSolidShapes (shapes[candidates[i]], shape, tolerance, instance.rotation)){
+        instance.prototype = candidates[i];
+        break;
       }
-      line >> tokens[tokenCount];
-      ++tokenCount;
     }
 
-    if(tokenCount > 0)
-    {
-      string& tok = tokens[0];
-      if(tok.compare("vertex") == 0){
-        if(tokenCount < 4){
-          STL_READER_THROW("ERROR while reading from " << filename <<
-            ": vertex not specified correctly in line " << lineCount);
-        }
-        
-      //  read the position
-        CoordWithIndex <number_t, index_t> c;
-        for(size_t i = 0; i < 3; ++i)
-          c[i] = static_cast<number_t> (atof(tokens[i+1].c_str()));
-        c.index = static_cast<index_t>(coordsWithIndex.size());
-        coordsWithIndex.push_back(c);
-        ++numFaceVrts;
+    if(instance.prototype == is){
+      for(size_t r = 0; r < 3; ++r){
+        for(size_t c = 0; c < 3; ++c)
+          instance.rotation[r][c] = (r == c) ? 1 : 0;
+        instance.translation[r] = 0;
       }
-      else if(tok.compare("facet") == 0)
-      {
-        STL_READER_COND_THROW(tokenCount < 5,
-          "ERROR while reading from " << filename <<
-          ": triangle not specified correctly in line " << lineCount);
-        
-        STL_READER_COND_THROW(tokens[1].compare("normal") != 0,
-          "ERROR while reading from " << filename <<
-          ": Missing normal specifier in line " << lineCount);
-        
-      //  read the normal
-        for(size_t i = 0; i < 3; ++i)
-          normalsOut.push_back (static_cast<number_t> (atof(tokens[i+2].c_str())));
+      candidates.push_back (is);
+      ++numPrototypes;
+    }
+    else{
+      const double* center = shapes[instance.prototype].center;
+      for(size_t d = 0; d < 3; ++d)
+        instance.translation[d] = shape.center[d] - Dot (instance.rotation[d], center);
+    }
+  }
+  return numPrototypes;
+}
 
-        numFaceVrts = 0;
-      }
-      else if(tok.compare("outer") == 0){
-        STL_READER_COND_THROW ((tokenCount < 2) || (tokens[1].compare("loop") != 0),
-          "ERROR while reading from " << filename <<
-          ": expecting outer loop in line " << lineCount);
-      }
-      else if(tok.compare("endfacet") == 0){
-        STL_READER_COND_THROW(numFaceVrts != 3,
-          "ERROR while reading from " << filename <<
-          ": bad number of vertices specified for face in line " << lineCount);
 
-        trisOut.push_back(static_cast<index_t> (coordsWithIndex.size() - 3));
-        trisOut.push_back(static_cast<index_t> (coordsWithIndex.size() - 2));
-        trisOut.push_back(static_cast<index_t> (coordsWithIndex.size() - 1));
-      }
-      else if(tok.compare("solid") == 0){
-        solidRangesOut.push_back(static_cast<index_t> (trisOut.size() / 3));
-      }
+template <class TNumberContainer, class TIndexContainer>
+void RenderThumbnail (const TNumberContainer& coords,
+                      const TIndexContainer& tris,
+                      const ThumbnailOptions& options,
+                      Thumbnail& thumbnailOut,
+                      unsigned int numThreads)
+{
+  using namespace std;
+  using namespace stl_reader_impl;
+
+  const size_t width = options.width;
+  const size_t height = options.height;
+  thumbnailOut.width = width;
+  thumbnailOut.height = height;
+  thumbnailOut.depth.assign (width * height, numeric_limits<float>::infinity());
+  thumbnailOut.normals.assign (width * height * 3, 0);
+  thumbnailOut.rgb.resize (width * height * 3);
+  for(size_t i = 0; i < width * height; ++i){
+    for(size_t d = 0; d < 3; ++d)
+      thumbnailOut.rgb[i * 3 + d] = options.background[d];
+  }
+
+  const size_t numVrts = coords.size() / 3;
+  const size_t numTris = tris.size() / 3;
+  if(width == 0 || height == 0 || numTris == 0)
+    return;
+
+//  rows of 'axes': right, up and towards the camera
+  double axes[3][3];
+  double forward[3] = {options.viewDir[0], options.viewDir[1], options.viewDir[2]};
+  double len = sqrt (Dot (forward, forward));
+  for(size_t d = 0; d < 3; ++d)
+    forward[d] = len > 0 ? forward[d] / len : (d == 2 ? -1 : 0);
+  Cross (forward, options.up, axes[0]);
+  len = sqrt (Dot (axes[0], axes[0]));
+  if(len < 1.e-12){
+  //  'up' is parallel to the view direction
+    const double fallback[3] = {fabs (forward[0]) < 0.9 ? 1. : 0., fabs (forward[0]) < 0.9 ? 0. : 1., 0};
+    Cross (forward, fallback, axes[0]);
+    len = sqrt (Dot (axes[0], axes[0]));
+  }
+  for(size_t d = 0; d < 3; ++d){
+    axes[0][d] /= len;
+    axes[2][d] = -forward[d];
+  }
+  Cross (axes[2], axes[0], axes[1]);
+
+  vector<double> view (numVrts * 3);
+  ProjectVerticesFunc <TNumberContainer> projectFunc;
+  projectFunc.coords = &coords;
+  projectFunc.axes = axes;
+  projectFunc.view = &view;
+  ParallelFor (numVrts, 4096, projectFunc, numThreads);
+
+//  fit the projected vertices of the triangles into the image
+  double lo[3], hi[3];
+  for(size_t d = 0; d < 3; ++d){
+    lo[d] = numeric_limits<double>::max();
+    hi[d] = -numeric_limits<double>::max();
+  }
+  for(size_t i = 0; i < tris.size(); ++i){
+    const double* p = &view[static_cast<size_t> (tris[i]) * 3];
+    for(size_t d = 0; d < 3; ++d){
+      lo[d] = min (lo[d], p[d]);
+      hi[d] = max (hi[d], p[d]);
     }
-    lineCount++;
   }
 
-  solidRangesOut.push_back(static_cast<index_t> (trisOut.size() / 3));
+  ThumbnailMapping mapping;
+  mapping.uLo = lo[0];
+  mapping.vHi = hi[1];
+  mapping.wHi = hi[2];
+  mapping.depthScale = hi[2] > lo[2] ? 1 / (hi[2] - lo[2]) : 0;
+  const double margin = max (0., min (0.49, options.margin));
+  const double size[2] = {static_cast<double> (width), static_cast<double> (height)};
+  mapping.scale = numeric_limits<double>::max();
+  for(size_t d = 0; d < 2; ++d){
+    if(hi[d] > lo[d])
+      mapping.scale = min (mapping.scale, (1 - 2 * margin) * size[d] / (hi[d] - lo[d]));
+  }
+  if(mapping.scale == numeric_limits<double>::max())
+    mapping.scale = 1;
+  for(size_t d = 0; d < 2; ++d)
+    mapping.offset[d] = 0.5 * (size[d] - (hi[d] - lo[d]) * mapping.scale);
 
-  RemoveDoubles (coordsOut, trisOut, normalsOut, solidRangesOut, coordsWithIndex);
+//  count the tiles per triangle, compute offsets and write the tile of each entry
+  const size_t tileSize = max<size_t> (options.tileSize, 1);
+  ThumbnailOptions tileOptions = options;
+  tileOptions.tileSize = tileSize;
+  const size_t numTilesX = (width + tileSize - 1) / tileSize;
+  const size_t numTilesY = (height + tileSize - 1) / tileSize;
+  const size_t numTiles = numTilesX * numTilesY;
 
-  return true;
+  vector<float> triNormals (numTris * 3);
+  vector<size_t> entryOffsets (numTris + 1, 0);
+  vector<size_t> entryTiles;
+  ThumbnailBinsFunc <TIndexContainer> binsFunc;
+  binsFunc.view = &view;
+  binsFunc.tris = &tris;
+  binsFunc.mapping = &mapping;
+  binsFunc.tileSize = tileSize;
+  binsFunc.numTiles[0] = numTilesX;
+  binsFunc.numTiles[1] = numTilesY;
+  binsFunc.size[0] = width;
+  binsFunc.size[1] = height;
+  binsFunc.fill = false;
+  binsFunc.triNormals = &triNormals;
+  binsFunc.entryOffsets = &entryOffsets;
+  binsFunc.entryTiles = &entryTiles;
+  ParallelFor (numTris, 4096, binsFunc, numThreads);
+
+  for(size_t i = 1; i <= numTris; ++i)
+    entryOffsets[i] += entryOffsets[i - 1];
+  entryTiles.resize (entryOffsets.back());
+  binsFunc.fill = true;
+  ParallelFor (numTris, 4096, binsFunc, numThreads);
+
+//  counting sort of the entries by tile. Triangles stay sorted within each tile.
+  vector<size_t> tileOffsets (numTiles + 1, 0);
+  for(size_t i = 0; i < entryTiles.size(); ++i)
+    ++tileOffsets[entryTiles[i] + 1];
+  for(size_t i = 1; i <= numTiles; ++i)
+    tileOffsets[i] += tileOffsets[i - 1];
+
+  vector<size_t> tileTris (entryTiles.size());
+  vector<size_t> tileFill (tileOffsets.begin(), tileOffsets.end() - 1);
+  for(size_t itri = 0; itri < numTris; ++itri){
+    for(size_t i = entryOffsets[itri]; i < entryOffsets[itri + 1]; ++i)
+      tileTris[tileFill[entryTiles[i]]++] = itri;
+  }
+
+  RasterizeTilesFunc <TIndexContainer> rasterFunc;
+  rasterFunc.view = &view;
+  rasterFunc.tris = &tris;
+  rasterFunc.mapping = &mapping;
+  rasterFunc.options = &tileOptions;
+  rasterFunc.triNormals = &triNormals;
+  rasterFunc.tileOffsets = &tileOffsets;
+  rasterFunc.tileTris = &tileTris;
+  rasterFunc.numTilesX = numTilesX;
+  rasterFunc.thumbnail = &thumbnailOut;
+  ParallelFor (numTiles, 1, rasterFunc, numThreads);
 }
 
 
-template <class TNumberContainer1, class TNumberContainer2,
-          class TIndexContainer1, class TIndexContainer2>
-bool ReadStlFile_BINARY(const char* filename,
-                        TNumberContainer1& coordsOut,
-                        TNumberContainer2& normalsOut,
-                        TIndexContainer1& trisOut,
-                        TIndexContainer2& solidRangesOut)
+template <class TNumber, class TIndex>
+std::vector <StlMesh<TNumber, TIndex> > StlMesh<TNumber, TIndex>::
+split_solids (const unsigned int numThreads) const
 {
-  using namespace std;
   using namespace stl_reader_impl;
 
-  typedef typename TNumberContainer1::value_type  number_t;
-  typedef typename TIndexContainer1::value_type index_t;
+  std::vector <StlMesh> meshes (num_solids());
+  ExtractSolidsFunc <StlMesh> func;
+  func.mesh = this;
+  func.meshes = &meshes;
+  ParallelFor (meshes.size(), 1, func, numThreads);
+  return meshes;
+}
 
-  coordsOut.clear();
-  normalsOut.clear();
-  trisOut.clear();
-  solidRangesOut.clear();
 
-  ifstream in(filename, ios::binary);
-  STL_READER_COND_THROW(!in, "Couldnt open file " << filename);
+template <class TNumber, class TIndex>
+void StlMesh<TNumber, TIndex>::
+instance_solids (StlMesh& prototypesOut,
+                 std::vector <SolidInstance>& instancesOut,
+                 const double tolerance,
+                 const unsigned int numThreads) const
+{
+  FindSolidInstances (coords, tris, solids, instancesOut, tolerance, numThreads);
 
-  char stl_header[80];
-  in.read(stl_header, 80);
-  STL_READER_COND_THROW(!in, "Error while parsing binary stl header in file " << filename);
+  prototypesOut.coords.clear();
+  prototypesOut.normals.clear();
+  prototypesOut.tris.clear();
+  prototypesOut.solids.clear();
+  prototypesOut.readInfo = StlReadInfo();
+  prototypesOut.solids.push_back (0);
+  std::copy (originCoords, originCoords + 3, prototypesOut.originCoords);
 
-  unsigned int numTris = 0;
-  in.read((char*)&numTris, 4);
-  STL_READER_COND_THROW(!in, "Couldnt determine number of triangles in binary stl file " << filename);
+  std::vector <size_t> prototypeIndex (num_solids(), 0);
+  StlMesh part;
+  for(size_t is = 0; is < num_solids(); ++is){
+    if(instancesOut[is].prototype != is)
+      continue;
 
-  vector<CoordWithIndex <number_t, index_t> > coordsWithIndex;
+    prototypeIndex[is] = prototypesOut.num_solids();
+    extract_solid (is, part);
+    const TIndex offset = static_cast<TIndex> (prototypesOut.num_vrts());
+    prototypesOut.coords.insert (prototypesOut.coords.end(), part.coords.begin(), part.coords.end());
+    prototypesOut.normals.insert (prototypesOut.normals.end(), part.normals.begin(), part.normals.end());
+    for(size_t i = 0; i < part.tris.size(); ++i)
+      prototypesOut.tris.push_back (part.tris[i] + offset);
+    prototypesOut.solids.push_back (static_cast<TIndex> (prototypesOut.num_tris()));
+  }
+
+  for(size_t is = 0; is < instancesOut.size(); ++is)
+    instancesOut[is].prototype = prototypeIndex[instancesOut[is].prototype];
+}
 
-  for(unsigned int tri = 0; tri < numTris; ++tri){
-    float d[12];
-    in.read((char*)d, 12 * 4);
-    STL_READER_COND_THROW(!in, "Error while parsing trianlge in binary stl file " << filename);
 
-    for(int i = 0; i < 3; ++i)
-      normalsOut.push_back (d[i]);
 
-    for(size_t ivrt = 1; ivrt < 4; ++ivrt){
-      CoordWithIndex <number_t, index_t> c;
-      for(size_t i = 0; i < 3; ++i)
-        c[i] = d[ivrt * 3 + i];
-      c.index = static_cast<index_t>(coordsWithIndex.size());
-      coordsWithIndex.push_back(c);
+#ifdef STL_READER_SHARED_MEMORY
+
+namespace stl_reader_impl {
+  // writes an image of 'mesh' to the file 'fd' which is resized accordingly
+  template <class TNumber, class TIndex>
+  bool WriteMeshImageToFile (const StlMesh <TNumber, TIndex>& mesh, const int fd)
+  {
+    const size_t size = mesh.image_size();
+    STL_READER_COND_THROW (ftruncate (fd, static_cast<off_t> (size)) != 0,
+                           "Couldn't resize shared memory to " << size << " bytes");
+    void* data = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    STL_READER_COND_THROW (data == MAP_FAILED, "Couldn't map shared memory");
+
+    #ifndef STL_READER_NO_EXCEPTIONS
+    try {
+      mesh.write_image (data, size);
+    } catch (std::exception&) {
+      munmap (data, size);
+      throw;
     }
+    const bool res = true;
+    #else
+    const bool res = mesh.write_image (data, size);
+    #endif
+
+    munmap (data, size);
+    return res;
+  }
+}// end of namespace stl_reader_impl
 
-    trisOut.push_back(static_cast<index_t> (coordsWithIndex.size() - 3));
-    trisOut.push_back(static_cast<index_t> (coordsWithIndex.size() - 2));
-    trisOut.push_back(static_cast<index_t> (coordsWithIndex.size() - 1));
 
-    char addData[2];
-    in.read(addData, 2);
-    STL_READER_COND_THROW(!in, "Error while parsing additional triangle data in binary stl file " << filename);
+template <class TNumber, class TIndex>
+bool PublishStlMeshImage_SHM (const StlMesh <TNumber, TIndex>& mesh, const char* name)
+{
+  const int fd = shm_open (name, O_CREAT | O_EXCL | O_RDWR, 0644);
+  STL_READER_COND_THROW (fd < 0, "Couldn't create shared memory object " << name);
+
+  bool res = false;
+  #ifndef STL_READER_NO_EXCEPTIONS
+  try {
+    res = stl_reader_impl::WriteMeshImageToFile (mesh, fd);
+  } catch (std::exception&) {
+    close (fd);
+    shm_unlink (name);
+    throw;
   }
+  #else
+  res = stl_reader_impl::WriteMeshImageToFile (mesh, fd);
+  if(!res)
+    shm_unlink (name);
+  #endif
+
+  close (fd);
+  return res;
+}
 
-  solidRangesOut.push_back(0);
-  solidRangesOut.push_back(static_cast<index_t> (trisOut.size() / 3));
 
-  RemoveDoubles (coordsOut, trisOut, normalsOut, solidRangesOut, coordsWithIndex);
+#ifdef __linux__
+template <class TNumber, class TIndex>
+bool PublishStlMeshImage_MEMFD (const StlMesh <TNumber, TIndex>& mesh, const char* name, int& fdOut)
+{
+  fdOut = -1;
+  const int fd = memfd_create (name, MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  STL_READER_COND_THROW (fd < 0, "Couldn't create memfd " << name);
+
+  bool res = false;
+  #ifndef STL_READER_NO_EXCEPTIONS
+  try {
+    res = stl_reader_impl::WriteMeshImageToFile (mesh, fd);
+  } catch (std::exception&) {
+    close (fd);
+    throw;
+  }
+  #else
+  res = stl_reader_impl::WriteMeshImageToFile (mesh, fd);
+  #endif
 
+  if(res)
+    res = fcntl (fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) == 0;
+  if(!res){
+    close (fd);
+    STL_READER_THROW ("Couldn't seal memfd " << name);
+  }
+  fdOut = fd;
   return true;
 }
+#endif
 
+#endif // STL_READER_SHARED_MEMORY
 
-inline bool StlFileHasASCIIFormat(const char* filename)
+
+template <class TNumberContainer, class TIndexContainer>
+unsigned long long ComputeGeometryHash (const TNumberContainer& coords,
+                                        const TIndexContainer& tris)
 {
-  using namespace std;
-  ifstream in(filename);
-  STL_READER_COND_THROW(!in, "Couldnt open file " << filename);
+  using namespace stl_reader_impl;
 
-  char chars [256];
-  in.read (chars, 256);
-  string buffer (chars, in.gcount());
-  transform(buffer.begin(), buffer.end(), buffer.begin(), ::tolower);
-  return buffer.find ("solid") != string::npos &&
-         buffer.find ("\n") != string::npos &&
-         buffer.find ("facet") != string::npos &&
-         buffer.find ("normal") != string::npos;
+  unsigned long long hashSum = 0;
+  for(size_t i = 0; i + 2 < tris.size(); i += 3){
+    hashSum += HashTriangle (&coords[tris[i] * 3],
+                             &coords[tris[i + 1] * 3],
+                             &coords[tris[i + 2] * 3]);
+  }
+  return FinishGeometryHash (hashSum, tris.size() / 3);
 }
 
 } // end of namespace stl_reader
@@ -0,0 +1,78 @@
+#include "allocation_counter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+  // each block is prefixed with its size, so that deallocations can be counted
+  // without help of the allocator. The prefix keeps the default new alignment.
+  constexpr size_t headerSize = alignof (std::max_align_t);
+
+  std::atomic<bool> counting {false};
+  std::atomic<size_t> numAllocations {0};
+  std::atomic<long long> curBytes {0};
+  std::atomic<long long> peakBytes {0};
+
+  void* allocate (size_t size) noexcept
+  {
+    auto const block = static_cast<char*> (std::malloc (size + headerSize));
+    if (!block)
+      return nullptr;
+    *reinterpret_cast<size_t*> (block) = size;
+
+    if (counting)
+    {
+      ++numAllocations;
+      long long const bytes = curBytes += static_cast<long long> (size);
+      long long peak = peakBytes;
+      while (bytes > peak && !peakBytes.compare_exchange_weak (peak, bytes)) {}
+    }
+    return block + headerSize;
+  }
+
+  void deallocate (void* ptr) noexcept
+  {
+    if (!ptr)
+      return;
+    auto const block = static_cast<char*> (ptr) - headerSize;
+    if (counting)
+      curBytes -= static_cast<long long> (*reinterpret_cast<size_t*> (block));
+    std::free (block);
+  }
+
+  void* allocateOrThrow (size_t size)
+  {
+    void* ptr = allocate (size);
+    if (!ptr)
+      throw std::bad_alloc ();
+    return ptr;
+  }
+}
+
+void* operator new (size_t size) {return allocateOrThrow (size);}
+void* operator new[] (size_t size) {return allocateOrThrow (size);}
+void* operator new (size_t size, std::nothrow_t const&) noexcept {return allocate (size);}
+void* operator new[] (size_t size, std::nothrow_t const&) noexcept {return allocate (size);}
+void operator delete (void* ptr) noexcept {deallocate (ptr);}
+void operator delete[] (void* ptr) noexcept {deallocate (ptr);}
+void operator delete (void* ptr, size_t) noexcept {deallocate (ptr);}
+void operator delete[] (void* ptr, size_t) noexcept {deallocate (ptr);}
+void operator delete (void* ptr, std::nothrow_t const&) noexcept {deallocate (ptr);}
+void operator delete[] (void* ptr, std::nothrow_t const&) noexcept {deallocate (ptr);}
+
+auto countAllocations (std::function<void ()> const& func) -> AllocationStats
+{
+  numAllocations = 0;
+  curBytes = 0;
+  peakBytes = 0;
+  counting = true;
+  func ();
+  counting = false;
+
+  AllocationStats stats;
+  stats.numAllocations = numAllocations;
+  stats.peakBytes = static_cast<size_t> (peakBytes.load ());
+  return stats;
+}
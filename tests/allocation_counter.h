@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+// Statistics of the heap allocations performed through operator new.
+struct AllocationStats
+{
+  size_t numAllocations = 0;
+  // maximum number of bytes held in addition to those held when counting started
+  size_t peakBytes = 0;
+};
+
+// Calls 'func' and records the allocations made meanwhile by all threads.
+// The counting replaces the global operator new and delete of the test binary.
+auto countAllocations (std::function<void ()> const& func) -> AllocationStats;
@@ -0,0 +1,60 @@
+#include "../stl_reader.h"
+#include "allocation_counter.h"
+#include "bench/mesh_generator.h"
+#include <gtest/gtest.h>
+#include <cstdio>
+
+namespace
+{
+  auto countLoadAllocations (char const* filename) -> AllocationStats
+  {
+    std::vector<float> coords, normals;
+    std::vector<unsigned int> tris, solids;
+    return countAllocations ([&] () {
+      stl_reader::ReadStlFile (filename, coords, normals, tris, solids);
+    });
+  }
+}
+
+TEST (allocations, binaryLoadIsIndependentOfSize)
+{
+  char const* smallFile = "alloc_small_binary.stl";
+  char const* largeFile = "alloc_large_binary.stl";
+  writeBinaryStl (smallFile, generateMesh (1000, 1, false));
+  writeBinaryStl (largeFile, generateMesh (100000, 1, false));
+
+  auto const small = countLoadAllocations (smallFile);
+  auto const large = countLoadAllocations (largeFile);
+  std::remove (smallFile);
+  std::remove (largeFile);
+
+  // all arrays are reserved up front, so the count must not grow with the file
+  EXPECT_LE (small.numAllocations, 16u);
+  EXPECT_EQ (large.numAllocations, small.numAllocations);
+
+  // corners with indices, re-index map, normals, triangles and welded coordinates
+  size_t const bytesPerTri = 3 * sizeof (float[4]) + 3 * 3 * sizeof (unsigned int) + 3 * sizeof (float) + 3 * sizeof (float);
+  EXPECT_LE (large.peakBytes, 100000 * bytesPerTri + 128 * 1024);
+}
+
+TEST (allocations, asciiLoadDoesNotAllocatePerLine)
+{
+  char const* smallFile = "alloc_small_ascii.stl";
+  char const* largeFile = "alloc_large_ascii.stl";
+  writeAsciiStl (smallFile, generateMesh (1000, 1, false));
+  writeAsciiStl (largeFile, generateMesh (100000, 1, false), 3);
+
+  auto const small = countLoadAllocations (smallFile);
+  auto const large = countLoadAllocations (largeFile);
+  std::remove (smallFile);
+  std::remove (largeFile);
+
+  // the large file has about 700000 lines. Only the geometric growth of the
+  // output arrays may add allocations: about 3 * log2 (100) for 3 arrays.
+  EXPECT_LE (small.numAllocations, 64u);
+  EXPECT_LE (large.numAllocations, small.numAllocations + 3 * 3 * 8);
+
+  // arrays which grow geometrically may temporarily hold twice their size
+  size_t const bytesPerTri = 3 * sizeof (float[4]) + 3 * 3 * sizeof (unsigned int) + 3 * sizeof (float) + 3 * sizeof (float);
+  EXPECT_LE (large.peakBytes, 2 * 100000 * bytesPerTri + 128 * 1024);
+}
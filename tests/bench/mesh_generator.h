@@ -0,0 +1,125 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Triangle soup of a jittered height field, in the layout of stl records:
+// 9 corner coordinates and 3 normal components per triangle. Neighboring
+// triangles share their corner coordinates exactly, so that loading the
+// generated files exercises vertex welding.
+struct GeneratedMesh
+{
+  std::vector<float> corners;
+  std::vector<float> normals;
+
+  size_t numTris () const {return normals.size () / 3;}
+};
+
+inline GeneratedMesh generateMesh (size_t numTris, unsigned seed, bool shuffleTris)
+{
+  size_t const numQuadsPerSide = std::max<size_t> (1, static_cast<size_t> (std::sqrt (numTris / 2.)));
+  size_t const numVrtsPerSide = numQuadsPerSide + 1;
+
+  std::mt19937 gen (seed);
+  std::uniform_real_distribution<float> jitter (-0.25f, 0.25f);
+  std::vector<float> vrts;
+  vrts.reserve (3 * numVrtsPerSide * numVrtsPerSide);
+  for (size_t j = 0; j < numVrtsPerSide; ++j)
+    for (size_t i = 0; i < numVrtsPerSide; ++i)
+    {
+      vrts.push_back (static_cast<float> (i) + jitter (gen));
+      vrts.push_back (static_cast<float> (j) + jitter (gen));
+      vrts.push_back (std::sin (0.1f * i) * std::cos (0.1f * j) * 10 + jitter (gen));
+    }
+
+  std::vector<size_t> tris;
+  for (size_t j = 0; j < numQuadsPerSide && tris.size () < 3 * numTris; ++j)
+    for (size_t i = 0; i < numQuadsPerSide && tris.size () < 3 * numTris; ++i)
+    {
+      size_t const v = j * numVrtsPerSide + i;
+      size_t const quad [6] = {v, v + 1, v + numVrtsPerSide + 1, v, v + numVrtsPerSide + 1, v + numVrtsPerSide};
+      tris.insert (tris.end (), quad, quad + (tris.size () + 6 <= 3 * numTris ? 6 : 3));
+    }
+
+  std::vector<size_t> order (tris.size () / 3);
+  for (size_t i = 0; i < order.size (); ++i)
+    order [i] = i;
+  if (shuffleTris)
+    std::shuffle (order.begin (), order.end (), gen);
+
+  GeneratedMesh mesh;
+  mesh.corners.reserve (3 * tris.size ());
+  mesh.normals.reserve (tris.size ());
+  for (size_t itri : order)
+  {
+    float const* c [3];
+    for (int i = 0; i < 3; ++i)
+      c [i] = &vrts [3 * tris [3 * itri + i]];
+    float const e1 [3] = {c [1][0] - c [0][0], c [1][1] - c [0][1], c [1][2] - c [0][2]};
+    float const e2 [3] = {c [2][0] - c [0][0], c [2][1] - c [0][1], c [2][2] - c [0][2]};
+    float n [3] = {e1 [1] * e2 [2] - e1 [2] * e2 [1],
+                   e1 [2] * e2 [0] - e1 [0] * e2 [2],
+                   e1 [0] * e2 [1] - e1 [1] * e2 [0]};
+    float const len = std::sqrt (n [0] * n [0] + n [1] * n [1] + n [2] * n [2]);
+    for (int i = 0; i < 3; ++i)
+    {
+      mesh.normals.push_back (len > 0 ? n [i] / len : 0);
+      mesh.corners.insert (mesh.corners.end (), c [i], c [i] + 3);
+    }
+  }
+  return mesh;
+}
+
+// returns the triangles [triBegin, triEnd) of 'mesh'
+inline GeneratedMesh sliceMesh (GeneratedMesh const& mesh, size_t triBegin, size_t triEnd)
+{
+  GeneratedMesh slice;
+  slice.corners.assign (mesh.corners.begin () + 9 * triBegin, mesh.corners.begin () + 9 * triEnd);
+  slice.normals.assign (mesh.normals.begin () + 3 * triBegin, mesh.normals.begin () + 3 * triEnd);
+  return slice;
+}
+
+inline void writeBinaryStl (std::string const& filename, GeneratedMesh const& mesh)
+{
+  std::ofstream out (filename, std::ios::binary);
+  char header [80] = "binary stl written by stl_reader mesh generator";
+  out.write (header, 80);
+  std::uint32_t const numTris = static_cast<std::uint32_t> (mesh.numTris ());
+  out.write (reinterpret_cast<char const*> (&numTris), 4);
+  char const attribute [2] = {0, 0};
+  for (size_t itri = 0; itri < mesh.numTris (); ++itri)
+  {
+    out.write (reinterpret_cast<char const*> (&mesh.normals [3 * itri]), 12);
+    out.write (reinterpret_cast<char const*> (&mesh.corners [9 * itri]), 36);
+    out.write (attribute, 2);
+  }
+}
+
+// writes the triangles into 'numSolids' consecutive solids of similar size
+inline void writeAsciiStl (std::string const& filename, GeneratedMesh const& mesh, size_t numSolids = 1)
+{
+  std::ofstream out (filename);
+  out.precision (9);
+  size_t const numTris = mesh.numTris ();
+  for (size_t isolid = 0; isolid < numSolids; ++isolid)
+  {
+    out << "solid part" << isolid << "\n";
+    for (size_t itri = isolid * numTris / numSolids; itri < (isolid + 1) * numTris / numSolids; ++itri)
+    {
+      float const* n = &mesh.normals [3 * itri];
+      out << "  facet normal " << n [0] << " " << n [1] << " " << n [2] << "\n    outer loop\n";
+      for (int i = 0; i < 3; ++i)
+      {
+        float const* c = &mesh.corners [9 * itri + 3 * i];
+        out << "      vertex " << c [0] << " " << c [1] << " " << c [2] << "\n";
+      }
+      out << "    endloop\n  endfacet\n";
+    }
+    out << "endsolid part" << isolid << "\n";
+  }
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#ifdef __linux__
+  #include <linux/perf_event.h>
+  #include <sys/ioctl.h>
+  #include <sys/syscall.h>
+  #include <unistd.h>
+#endif
+
+// Hardware counters of the calling thread, read through perf_event_open.
+// The counters are opened as one group so that all of them cover exactly the
+// same instructions. If the kernel refuses to open them (non-linux systems,
+// perf_event_paranoid, virtual machines without a PMU), 'available' returns
+// false and 'start'/'stop' do nothing.
+class PerfCounters
+{
+public:
+  enum Counter {CYCLES, INSTRUCTIONS, CACHE_MISSES, BRANCH_MISSES, NUM_COUNTERS};
+
+  struct Values
+  {
+    std::uint64_t counts [NUM_COUNTERS] = {0, 0, 0, 0};
+
+    double ipc () const {return counts [CYCLES] ? double (counts [INSTRUCTIONS]) / counts [CYCLES] : 0;}
+  };
+
+  PerfCounters ()
+  {
+#ifdef __linux__
+    const std::uint64_t configs [NUM_COUNTERS] = {PERF_COUNT_HW_CPU_CYCLES,
+                                                  PERF_COUNT_HW_INSTRUCTIONS,
+                                                  PERF_COUNT_HW_CACHE_MISSES,
+                                                  PERF_COUNT_HW_BRANCH_MISSES};
+    for (int i = 0; i < NUM_COUNTERS; ++i)
+    {
+      perf_event_attr attr;
+      std::memset (&attr, 0, sizeof (attr));
+      attr.size = sizeof (attr);
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = configs [i];
+      attr.disabled = (i == 0);
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_GROUP;
+      m_fds [i] = static_cast<int> (syscall (SYS_perf_event_open, &attr, 0, -1,
+                                             i == 0 ? -1 : m_fds [0], 0));
+      if (m_fds [i] < 0)
+      {
+        close_all ();
+        return;
+      }
+    }
+#endif
+  }
+
+  ~PerfCounters () {close_all ();}
+
+  PerfCounters (const PerfCounters&) = delete;
+  PerfCounters& operator = (const PerfCounters&) = delete;
+
+  bool available () const {return m_fds [0] >= 0;}
+
+  void start ()
+  {
+#ifdef __linux__
+    if (!available ())
+      return;
+    ioctl (m_fds [0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl (m_fds [0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+  }
+
+  Values stop ()
+  {
+    Values values;
+#ifdef __linux__
+    if (!available ())
+      return values;
+    ioctl (m_fds [0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    std::uint64_t buf [1 + NUM_COUNTERS];
+    if (read (m_fds [0], buf, sizeof (buf)) == static_cast<ssize_t> (sizeof (buf)))
+      for (int i = 0; i < NUM_COUNTERS; ++i)
+        values.counts [i] = buf [1 + i];
+#endif
+    return values;
+  }
+
+private:
+  void close_all ()
+  {
+    for (int i = 0; i < NUM_COUNTERS; ++i)
+    {
+#ifdef __linux__
+      if (m_fds [i] >= 0)
+        close (m_fds [i]);
+#endif
+      m_fds [i] = -1;
+    }
+  }
+
+  int m_fds [NUM_COUNTERS] = {-1, -1, -1, -1};
+};
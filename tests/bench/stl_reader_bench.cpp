@@ -0,0 +1,389 @@
+// Benchmarks the stl readers on generated meshes.
+//
+// usage: stl_reader_bench [--tris N] [--repeat R] [--counters]
+//                         [--threads T] [--csv FILE] [--compare]
+//
+// For each phase, the best wall time over R repetitions is reported. With
+// --counters, hardware counters are sampled through perf_event_open in
+// addition and the instructions per cycle as well as cache and branch misses
+// per triangle are printed for the fastest repetition.
+//
+// With --threads, the thread scaling of the phases is measured instead. The
+// mesh is split into one part per thread and the parts are read and welded
+// concurrently, for 1, 2, 4, ... up to T threads (T = 0 uses all hardware
+// threads). Speedup, parallel efficiency and the achieved bandwidth with
+// respect to the input bytes are reported and optionally written to FILE
+// as CSV.
+//
+// With --compare, the readers are compared with the frozen reference
+// implementation in tests/reference. The speedup over the reference is
+// reported together with whether both produce bit for bit equal results.
+
+#include "../../stl_reader.h"
+#include "../reference/reference_compare.h"
+#include "../reference/stl_reader_reference.h"
+#include "mesh_generator.h"
+#include "perf_counters.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+  using CoordWithIndex = stl_reader::stl_reader_impl::CoordWithIndex<float, unsigned int>;
+
+  struct PhaseResult
+  {
+    double seconds = 0;
+    PerfCounters::Values counters;
+  };
+
+  // buffers of one reader, so that concurrent phases do not share memory
+  struct ReadBuffers
+  {
+    std::vector<float> coords, normals;
+    std::vector<unsigned int> tris, solids;
+    std::vector<CoordWithIndex> coordsWithIndex;
+    std::vector<stl_reader_reference::CoordWithIndex<float, unsigned int>> refCoordsWithIndex;
+
+    void clear () {coords.clear (); normals.clear (); tris.clear (); solids.clear ();}
+  };
+
+  // fills 'buffers' with the unwelded corners of 'mesh', as the readers do before welding
+  void prepareWeldInput (GeneratedMesh const& mesh, ReadBuffers& buffers)
+  {
+    size_t const numCorners = 3 * mesh.numTris ();
+    buffers.clear ();
+    buffers.coordsWithIndex.resize (numCorners);
+    buffers.tris.resize (numCorners);
+    for (size_t i = 0; i < numCorners; ++i)
+    {
+      std::copy (&mesh.corners [3 * i], &mesh.corners [3 * i] + 3, buffers.coordsWithIndex [i].data);
+      buffers.coordsWithIndex [i].index = static_cast<unsigned int> (i);
+      buffers.tris [i] = static_cast<unsigned int> (i);
+    }
+    buffers.normals = mesh.normals;
+    buffers.solids = {0, static_cast<unsigned int> (mesh.numTris ())};
+    buffers.refCoordsWithIndex.resize (numCorners);
+    for (size_t i = 0; i < numCorners; ++i)
+    {
+      std::copy (buffers.coordsWithIndex [i].data, buffers.coordsWithIndex [i].data + 3, buffers.refCoordsWithIndex [i].data);
+      buffers.refCoordsWithIndex [i].index = buffers.coordsWithIndex [i].index;
+    }
+  }
+
+  void weld (ReadBuffers& b)
+  {
+    stl_reader::stl_reader_impl::RemoveDoubles (b.coords, b.tris, b.normals, b.solids, b.coordsWithIndex);
+  }
+
+  PhaseResult runPhase (std::function<void ()> const& prepare,
+                        std::function<void ()> const& phase,
+                        int numRepeats,
+                        PerfCounters* counters)
+  {
+    PhaseResult best;
+    for (int i = 0; i < numRepeats; ++i)
+    {
+      prepare ();
+      if (counters)
+        counters->start ();
+      auto const t0 = std::chrono::steady_clock::now ();
+      phase ();
+      auto const t1 = std::chrono::steady_clock::now ();
+      PhaseResult result;
+      if (counters)
+        result.counters = counters->stop ();
+      result.seconds = std::chrono::duration<double> (t1 - t0).count ();
+      if (i == 0 || result.seconds < best.seconds)
+        best = result;
+    }
+    return best;
+  }
+
+  // runs phase (i) for i in [0, numThreads) concurrently, each on its own thread
+  PhaseResult runConcurrentPhase (std::function<void (size_t)> const& prepare,
+                                  std::function<void (size_t)> const& phase,
+                                  size_t numThreads,
+                                  int numRepeats)
+  {
+    return runPhase ([&] () {for (size_t i = 0; i < numThreads; ++i) prepare (i);},
+                     [&] ()
+                     {
+                       std::vector<std::thread> threads;
+                       for (size_t i = 1; i < numThreads; ++i)
+                         threads.emplace_back (phase, i);
+                       phase (0);
+                       for (auto& t : threads)
+                         t.join ();
+                     },
+                     numRepeats, nullptr);
+  }
+
+  void printResult (char const* name, PhaseResult const& r, size_t numTris, bool withCounters)
+  {
+    std::printf ("%-20s %10.2f %12.1f", name, r.seconds * 1e3, numTris / r.seconds * 1e-6);
+    if (withCounters)
+    {
+      auto const& c = r.counters.counts;
+      std::printf (" %6.2f %14.2f %14.2f %14.3f",
+                   r.counters.ipc (),
+                   double (c [PerfCounters::INSTRUCTIONS]) / numTris,
+                   double (c [PerfCounters::CACHE_MISSES]) / numTris,
+                   double (c [PerfCounters::BRANCH_MISSES]) / numTris);
+    }
+    std::printf ("\n");
+  }
+
+  size_t fileSize (std::string const& filename)
+  {
+    std::ifstream in (filename, std::ios::binary | std::ios::ate);
+    return in ? static_cast<size_t> (in.tellg ()) : 0;
+  }
+
+  int runPhases (GeneratedMesh const& mesh, int numRepeats, bool useCounters)
+  {
+    PerfCounters perfCounters;
+    PerfCounters* counters = nullptr;
+    if (useCounters)
+    {
+      if (perfCounters.available ())
+        counters = &perfCounters;
+      else
+        std::fprintf (stderr, "hardware counters are not available, reporting wall time only\n");
+    }
+
+    size_t const numTris = mesh.numTris ();
+    std::string const asciiFile = "bench_mesh_ascii.stl";
+    std::string const binaryFile = "bench_mesh_binary.stl";
+    writeAsciiStl (asciiFile, mesh);
+    writeBinaryStl (binaryFile, mesh);
+
+    std::printf ("%zu triangles, best of %d\n", numTris, numRepeats);
+    std::printf ("%-20s %10s %12s", "phase", "ms", "Mtris/s");
+    if (counters)
+      std::printf (" %6s %14s %14s %14s", "IPC", "instr/tri", "cache-miss/tri", "branch-miss/tri");
+    std::printf ("\n");
+
+    ReadBuffers b;
+    auto const clear = [&] () {b.clear ();};
+
+    printResult ("ReadStlFile_ASCII",
+                 runPhase (clear,
+                           [&] () {stl_reader::ReadStlFile_ASCII (asciiFile.c_str (), b.coords, b.normals, b.tris, b.solids);},
+                           numRepeats, counters),
+                 numTris, counters != nullptr);
+
+    printResult ("ReadStlFile_BINARY",
+                 runPhase (clear,
+                           [&] () {stl_reader::ReadStlFile_BINARY (binaryFile.c_str (), b.coords, b.normals, b.tris, b.solids);},
+                           numRepeats, counters),
+                 numTris, counters != nullptr);
+
+    // RemoveDoubles in isolation, on the corner array the readers build before welding
+    printResult ("RemoveDoubles",
+                 runPhase ([&] () {prepareWeldInput (mesh, b);}, [&] () {weld (b);}, numRepeats, counters),
+                 numTris, counters != nullptr);
+
+    std::remove (asciiFile.c_str ());
+    std::remove (binaryFile.c_str ());
+    return 0;
+  }
+
+  int runComparison (GeneratedMesh const& mesh, int numRepeats)
+  {
+    size_t const numTris = mesh.numTris ();
+    std::string const asciiFile = "bench_mesh_ascii.stl";
+    std::string const binaryFile = "bench_mesh_binary.stl";
+    writeAsciiStl (asciiFile, mesh);
+    writeBinaryStl (binaryFile, mesh);
+
+    std::printf ("%zu triangles, best of %d\n", numTris, numRepeats);
+    std::printf ("%-20s %14s %10s %8s %6s\n", "phase", "reference ms", "ms", "speedup", "equal");
+
+    using Mesh = MeshArrays<float, unsigned int>;
+    auto const compare = [&] (char const* name,
+                              std::function<void ()> const& prepare,
+                              std::function<void (Mesh&)> const& reference,
+                              std::function<void (Mesh&)> const& current)
+    {
+      Mesh ref, cur;
+      double const refSeconds = runPhase (prepare, [&] () {reference (ref);}, numRepeats, nullptr).seconds;
+      double const seconds = runPhase (prepare, [&] () {current (cur);}, numRepeats, nullptr).seconds;
+      std::printf ("%-20s %14.2f %10.2f %8.2f %6s\n", name, refSeconds * 1e3, seconds * 1e3,
+                   refSeconds / seconds, compareMeshes (ref, cur, CompareOrder::EXACT).empty () ? "yes" : "NO");
+    };
+
+    auto const nothing = [] () {};
+    compare ("ReadStlFile_ASCII", nothing,
+             [&] (Mesh& m) {stl_reader_reference::ReadStlFile_ASCII (asciiFile.c_str (), m.coords, m.normals, m.tris, m.solids);},
+             [&] (Mesh& m) {stl_reader::ReadStlFile_ASCII (asciiFile.c_str (), m.coords, m.normals, m.tris, m.solids);});
+
+    compare ("ReadStlFile_BINARY", nothing,
+             [&] (Mesh& m) {stl_reader_reference::ReadStlFile_BINARY (binaryFile.c_str (), m.coords, m.normals, m.tris, m.solids);},
+             [&] (Mesh& m) {stl_reader::ReadStlFile_BINARY (binaryFile.c_str (), m.coords, m.normals, m.tris, m.solids);});
+
+    ReadBuffers b;
+    auto const takeResult = [&] (Mesh& m)
+    {
+      m.coords = b.coords;
+      m.normals = b.normals;
+      m.tris = b.tris;
+      m.solids = b.solids;
+    };
+    compare ("RemoveDoubles", [&] () {prepareWeldInput (mesh, b);},
+             [&] (Mesh& m)
+             {
+               stl_reader_reference::RemoveDoubles (b.coords, b.tris, b.normals, b.solids, b.refCoordsWithIndex);
+               takeResult (m);
+             },
+             [&] (Mesh& m) {weld (b); takeResult (m);});
+
+    std::remove (asciiFile.c_str ());
+    std::remove (binaryFile.c_str ());
+    return 0;
+  }
+
+  int runScaling (GeneratedMesh const& mesh, int numRepeats, size_t maxThreads, char const* csvFile)
+  {
+    if (maxThreads == 0)
+      maxThreads = std::max (1u, std::thread::hardware_concurrency ());
+
+    std::vector<size_t> threadCounts;
+    for (size_t t = 1; t < maxThreads; t *= 2)
+      threadCounts.push_back (t);
+    threadCounts.push_back (maxThreads);
+
+    std::ofstream csv;
+    if (csvFile)
+    {
+      csv.open (csvFile);
+      if (!csv)
+      {
+        std::fprintf (stderr, "couldn't open %s\n", csvFile);
+        return 1;
+      }
+      csv << "phase,threads,tris,seconds,speedup,efficiency,bandwidth_gb_s\n";
+    }
+
+    size_t const numTris = mesh.numTris ();
+    std::printf ("%zu triangles, best of %d\n", numTris, numRepeats);
+    std::printf ("%-20s %8s %10s %8s %10s %8s\n", "phase", "threads", "ms", "speedup", "efficiency", "GB/s");
+
+    char const* const phaseNames [] = {"binary decode", "ASCII parse", "dedup"};
+    double serialSeconds [3] = {0, 0, 0};
+
+    for (size_t numThreads : threadCounts)
+    {
+      std::vector<GeneratedMesh> parts;
+      std::vector<std::string> asciiFiles, binaryFiles;
+      size_t asciiBytes = 0, binaryBytes = 0, weldBytes = 0;
+      for (size_t i = 0; i < numThreads; ++i)
+      {
+        parts.push_back (sliceMesh (mesh, i * numTris / numThreads, (i + 1) * numTris / numThreads));
+        asciiFiles.push_back ("bench_part" + std::to_string (i) + "_ascii.stl");
+        binaryFiles.push_back ("bench_part" + std::to_string (i) + "_binary.stl");
+        writeAsciiStl (asciiFiles.back (), parts.back ());
+        writeBinaryStl (binaryFiles.back (), parts.back ());
+        asciiBytes += fileSize (asciiFiles.back ());
+        binaryBytes += fileSize (binaryFiles.back ());
+        weldBytes += 3 * parts.back ().numTris () * sizeof (CoordWithIndex);
+      }
+
+      std::vector<ReadBuffers> buffers (numThreads);
+      auto const clear = [&] (size_t i) {buffers [i].clear ();};
+
+      PhaseResult const results [3] = {
+        runConcurrentPhase (clear,
+                            [&] (size_t i)
+                            {
+                              auto& b = buffers [i];
+                              stl_reader::ReadStlFile_BINARY (binaryFiles [i].c_str (), b.coords, b.normals, b.tris, b.solids);
+                            },
+                            numThreads, numRepeats),
+        runConcurrentPhase (clear,
+                            [&] (size_t i)
+                            {
+                              auto& b = buffers [i];
+                              stl_reader::ReadStlFile_ASCII (asciiFiles [i].c_str (), b.coords, b.normals, b.tris, b.solids);
+                            },
+                            numThreads, numRepeats),
+        runConcurrentPhase ([&] (size_t i) {prepareWeldInput (parts [i], buffers [i]);},
+                            [&] (size_t i) {weld (buffers [i]);},
+                            numThreads, numRepeats)};
+      size_t const inputBytes [3] = {binaryBytes, asciiBytes, weldBytes};
+
+      for (int iphase = 0; iphase < 3; ++iphase)
+      {
+        double const seconds = results [iphase].seconds;
+        if (numThreads == 1)
+          serialSeconds [iphase] = seconds;
+        double const speedup = serialSeconds [iphase] / seconds;
+        double const efficiency = speedup / numThreads;
+        double const bandwidth = inputBytes [iphase] / seconds * 1e-9;
+        std::printf ("%-20s %8zu %10.2f %8.2f %10.2f %8.2f\n", phaseNames [iphase], numThreads,
+                     seconds * 1e3, speedup, efficiency, bandwidth);
+        if (csv.is_open ())
+          csv << phaseNames [iphase] << "," << numThreads << "," << numTris << "," << seconds << ","
+              << speedup << "," << efficiency << "," << bandwidth << "\n";
+      }
+
+      for (size_t i = 0; i < numThreads; ++i)
+      {
+        std::remove (asciiFiles [i].c_str ());
+        std::remove (binaryFiles [i].c_str ());
+      }
+    }
+    return 0;
+  }
+}
+
+int main (int argc, char** argv)
+{
+  size_t numTris = 1000000;
+  int numRepeats = 3;
+  bool useCounters = false;
+  bool scaling = false;
+  size_t maxThreads = 0;
+  char const* csvFile = nullptr;
+  bool compare = false;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    if (!std::strcmp (argv [i], "--tris") && i + 1 < argc)
+      numTris = std::strtoul (argv [++i], nullptr, 10);
+    else if (!std::strcmp (argv [i], "--repeat") && i + 1 < argc)
+      numRepeats = std::max (1, std::atoi (argv [++i]));
+    else if (!std::strcmp (argv [i], "--counters"))
+      useCounters = true;
+    else if (!std::strcmp (argv [i], "--threads") && i + 1 < argc)
+    {
+      scaling = true;
+      maxThreads = std::strtoul (argv [++i], nullptr, 10);
+    }
+    else if (!std::strcmp (argv [i], "--csv") && i + 1 < argc)
+      csvFile = argv [++i];
+    else if (!std::strcmp (argv [i], "--compare"))
+      compare = true;
+    else
+    {
+      std::fprintf (stderr, "usage: %s [--tris N] [--repeat R] [--counters] [--threads T] [--csv FILE] [--compare]\n", argv [0]);
+      return 1;
+    }
+  }
+
+  GeneratedMesh const mesh = generateMesh (numTris, 1, false);
+  if (compare)
+    return runComparison (mesh, numRepeats);
+  if (scaling)
+    return runScaling (mesh, numRepeats, maxThreads, csvFile);
+  return runPhases (mesh, numRepeats, useCounters);
+}
@@ -0,0 +1,112 @@
+#include "../stl_reader.h"
+#include <gtest/gtest.h>
+#include <random>
+
+namespace
+{
+  using std::vector;
+
+  struct Hull
+  {
+    explicit Hull (vector<double> const& points)
+    {
+      valid = stl_reader::ConvexHull (points, coords, normals, tris, solids);
+    }
+
+    double volume () const
+    {
+      double vol = 0;
+      for (size_t i = 0; i < tris.size (); i += 3)
+      {
+        double const* a = &coords [tris [i] * 3];
+        double const* b = &coords [tris [i + 1] * 3];
+        double const* c = &coords [tris [i + 2] * 3];
+        vol += (a [0] * (b [1] * c [2] - b [2] * c [1])
+              - a [1] * (b [0] * c [2] - b [2] * c [0])
+              + a [2] * (b [0] * c [1] - b [1] * c [0])) / 6;
+      }
+      return vol;
+    }
+
+    // returns the largest distance of a point in front of a hull face
+    double maxOutsideDistance (vector<double> const& points) const
+    {
+      double maxDist = -1;
+      for (size_t i = 0; i < tris.size () / 3; ++i)
+        for (size_t j = 0; j < points.size (); j += 3)
+        {
+          double dist = 0;
+          for (size_t d = 0; d < 3; ++d)
+            dist += normals [i * 3 + d] * (points [j + d] - coords [tris [i * 3] * 3 + d]);
+          maxDist = std::max (maxDist, dist);
+        }
+      return maxDist;
+    }
+
+    bool valid;
+    vector<double> coords, normals;
+    vector<unsigned int> tris, solids;
+  };
+}
+
+TEST (convexHull, cubeWithInteriorPoints)
+{
+  vector<double> points;
+  for (int i = 0; i < 8; ++i)
+    points.insert (points.end (), {double (i & 1), double ((i >> 1) & 1), double ((i >> 2) & 1)});
+  std::mt19937 gen (3);
+  std::uniform_real_distribution<double> dist (0.01, 0.99);
+  for (int i = 0; i < 1000; ++i)
+    points.insert (points.end (), {dist (gen), dist (gen), dist (gen)});
+
+  Hull const hull (points);
+  ASSERT_TRUE (hull.valid);
+  EXPECT_EQ (hull.coords.size (), 24);
+  EXPECT_EQ (hull.tris.size (), 36);
+  EXPECT_EQ (hull.solids, (vector<unsigned int> {0, 12}));
+  EXPECT_NEAR (hull.volume (), 1, 1.e-12);
+  EXPECT_LE (hull.maxOutsideDistance (points), 1.e-12);
+
+  vector<stl_reader::MeshValidation> reports;
+  stl_reader::ValidateMesh (hull.tris, hull.solids, reports);
+  EXPECT_TRUE (reports [0].is_watertight ());
+}
+
+TEST (convexHull, randomPointsOnSphere)
+{
+  vector<double> points;
+  std::mt19937 gen (5);
+  std::normal_distribution<double> dist;
+  for (int i = 0; i < 2000; ++i)
+  {
+    double p [3] = {dist (gen), dist (gen), dist (gen)};
+    double const len = sqrt (p [0] * p [0] + p [1] * p [1] + p [2] * p [2]);
+    double const radius = i % 2 ? 1 : 0.9;
+    points.insert (points.end (), {radius * p [0] / len, radius * p [1] / len, radius * p [2] / len});
+  }
+
+  Hull const hull (points);
+  ASSERT_TRUE (hull.valid);
+  EXPECT_EQ (hull.coords.size (), 3000);
+  EXPECT_EQ (hull.tris.size () / 3, 2 * 1000 - 4);
+  EXPECT_LE (hull.maxOutsideDistance (points), 1.e-12);
+  EXPECT_GT (hull.volume (), 0.95 * 4. / 3. * M_PI);
+}
+
+TEST (convexHull, stlMesh)
+{
+  stl_reader::StlMesh<> mesh ("data/binary_sphere.stl");
+  auto const hull = mesh.convex_hull ();
+  EXPECT_EQ (hull.num_vrts (), 12);
+  EXPECT_EQ (hull.num_tris (), 20);
+  EXPECT_EQ (hull.num_solids (), 1);
+  EXPECT_TRUE (hull.validate () [0].is_watertight ());
+}
+
+TEST (convexHull, coplanarPoints)
+{
+  vector<double> const points {0, 0, 0,  1, 0, 0,  0, 1, 0,  1, 1, 0,  0.5, 0.5, 0};
+  Hull const hull (points);
+  EXPECT_FALSE (hull.valid);
+  EXPECT_TRUE (hull.tris.empty ());
+}
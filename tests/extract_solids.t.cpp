@@ -0,0 +1,57 @@
+#include "../stl_reader.h"
+#include <gtest/gtest.h>
+#include <set>
+
+namespace
+{
+  using Mesh = stl_reader::StlMesh <float, unsigned int>;
+
+  void expectSolidEqual (Mesh const& mesh, size_t si, Mesh const& solid)
+  {
+    ASSERT_EQ (solid.num_solids (), 1u);
+    ASSERT_EQ (solid.num_tris (), mesh.solid_tris_end (si) - mesh.solid_tris_begin (si));
+
+    std::set<unsigned int> usedVrts;
+    for (size_t i = 0; i < solid.num_tris (); ++i)
+    {
+      size_t const itri = mesh.solid_tris_begin (si) + i;
+      for (size_t d = 0; d < 3; ++d)
+        EXPECT_EQ (solid.tri_normal (i) [d], mesh.tri_normal (itri) [d]);
+      for (size_t icorner = 0; icorner < 3; ++icorner)
+      {
+        usedVrts.insert (solid.tri_corner_ind (i, icorner));
+        for (size_t d = 0; d < 3; ++d)
+          EXPECT_EQ (solid.tri_corner_coords (i, icorner) [d],
+                     mesh.tri_corner_coords (itri, icorner) [d]);
+      }
+    }
+
+    // the solid is compact, each vertex is referenced
+    EXPECT_EQ (usedVrts.size (), solid.num_vrts ());
+  }
+}
+
+TEST (extractSolids, extractSolid)
+{
+  Mesh const mesh ("data/ascii_sphere.stl");
+  ASSERT_EQ (mesh.num_solids (), 2u);
+  Mesh const first = mesh.extract_solid (0);
+  expectSolidEqual (mesh, 0, first);
+  EXPECT_EQ (first.num_vrts (), 4u);
+  expectSolidEqual (mesh, 1, mesh.extract_solid (1));
+}
+
+TEST (extractSolids, splitSolids)
+{
+  Mesh const mesh ("data/ascii_sphere.stl");
+  std::vector<Mesh> const solids = mesh.split_solids (2);
+  ASSERT_EQ (solids.size (), mesh.num_solids ());
+  for (size_t si = 0; si < solids.size (); ++si)
+    expectSolidEqual (mesh, si, solids [si]);
+}
+
+TEST (extractSolids, invalidSolidIndex)
+{
+  Mesh const mesh ("data/ascii_sphere.stl");
+  EXPECT_THROW (mesh.extract_solid (2), std::runtime_error);
+}
@@ -0,0 +1,94 @@
+#include "../stl_reader.h"
+#include "bench/mesh_generator.h"
+#include <gtest/gtest.h>
+#include <cstdio>
+
+namespace
+{
+  auto readHash (char const* filename) -> unsigned long long
+  {
+    stl_reader::StlMesh <float, unsigned int> const mesh (filename);
+    EXPECT_EQ (mesh.read_info ().geometryHash, mesh.geometry_hash ());
+    return mesh.read_info ().geometryHash;
+  }
+
+  // moves the first corner of each triangle to its end, keeping the orientation
+  void rotateCorners (GeneratedMesh& mesh)
+  {
+    for (size_t itri = 0; itri < mesh.numTris (); ++itri)
+      std::rotate (&mesh.corners [9 * itri], &mesh.corners [9 * itri + 3], &mesh.corners [9 * itri + 9]);
+  }
+}
+
+TEST (geometryHash, independentOfFileLayout)
+{
+  char const* file = "geometry_hash.stl";
+  GeneratedMesh mesh = generateMesh (2000, 5, false);
+
+  writeBinaryStl (file, mesh);
+  auto const hash = readHash (file);
+
+  writeAsciiStl (file, mesh, 3);
+  EXPECT_EQ (readHash (file), hash);
+
+  writeBinaryStl (file, generateMesh (2000, 5, true));
+  EXPECT_EQ (readHash (file), hash);
+
+  rotateCorners (mesh);
+  writeAsciiStl (file, mesh, 1);
+  EXPECT_EQ (readHash (file), hash);
+
+  // normals don't contribute
+  std::fill (mesh.normals.begin (), mesh.normals.end (), 0.f);
+  writeBinaryStl (file, mesh);
+  EXPECT_EQ (readHash (file), hash);
+
+  // double output and reading relative to an origin yield the same hash
+  stl_reader::StlMesh <double, size_t> const meshD (file);
+  EXPECT_EQ (meshD.read_info ().geometryHash, hash);
+  stl_reader::StlMesh <float, unsigned int> relative;
+  relative.read_file_relative (file);
+  EXPECT_EQ (relative.read_info ().geometryHash, hash);
+
+  std::remove (file);
+}
+
+TEST (geometryHash, detectsGeometricChanges)
+{
+  char const* file = "geometry_hash.stl";
+  GeneratedMesh const mesh = generateMesh (500, 7, false);
+  writeBinaryStl (file, mesh);
+  auto const hash = readHash (file);
+
+  GeneratedMesh moved = mesh;
+  moved.corners [4] = std::nextafter (moved.corners [4], 1e9f);
+  writeBinaryStl (file, moved);
+  EXPECT_NE (readHash (file), hash);
+
+  GeneratedMesh flipped = mesh;
+  std::swap_ranges (&flipped.corners [3], &flipped.corners [6], &flipped.corners [6]);
+  writeBinaryStl (file, flipped);
+  EXPECT_NE (readHash (file), hash);
+
+  GeneratedMesh fewer = mesh;
+  fewer.corners.resize (fewer.corners.size () - 9);
+  fewer.normals.resize (fewer.normals.size () - 3);
+  writeBinaryStl (file, fewer);
+  EXPECT_NE (readHash (file), hash);
+
+  std::remove (file);
+}
+
+TEST (geometryHash, rawArrays)
+{
+  std::vector<float> coords, normals;
+  std::vector<unsigned int> tris, solids;
+  stl_reader::StlReadInfo info;
+  stl_reader::ReadStlFile ("data/ascii_sphere.stl", coords, normals, tris, solids, &info);
+  EXPECT_EQ (stl_reader::ComputeGeometryHash (coords, tris), info.geometryHash);
+
+  std::vector<float> const noCoords;
+  std::vector<unsigned int> const noTris;
+  EXPECT_NE (stl_reader::ComputeGeometryHash (noCoords, noTris), info.geometryHash);
+  EXPECT_EQ (stl_reader::ComputeGeometryHash (noCoords, noTris), stl_reader::StlMesh <float> ().geometry_hash ());
+}
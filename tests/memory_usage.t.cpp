@@ -0,0 +1,45 @@
+#include "../stl_reader.h"
+#include <gtest/gtest.h>
+
+TEST (memoryUsage, sizesMatchArrays)
+{
+  stl_reader::StlMesh <float, unsigned int> const mesh ("data/binary_sphere.stl");
+  auto const usage = mesh.memory_usage ();
+  EXPECT_EQ (usage.coordsSize, mesh.num_vrts () * 3 * sizeof (float));
+  EXPECT_EQ (usage.normalsSize, mesh.num_tris () * 3 * sizeof (float));
+  EXPECT_EQ (usage.trisSize, mesh.num_tris () * 3 * sizeof (unsigned int));
+  EXPECT_EQ (usage.solidsSize, (mesh.num_solids () + 1) * sizeof (unsigned int));
+  EXPECT_GE (usage.capacity (), usage.size ());
+}
+
+TEST (memoryUsage, peakLoadScratch)
+{
+  for (auto filename : {"data/binary_sphere.stl", "data/ascii_sphere.stl"})
+  {
+    stl_reader::StlMesh <float, unsigned int> const mesh (filename);
+    // each corner is stored with its index before vertices are welded
+    size_t const numCorners = 3 * mesh.num_tris ();
+    EXPECT_GE (mesh.memory_usage ().peakLoadScratch, numCorners * 4 * sizeof (float));
+    EXPECT_EQ (mesh.memory_usage ().peakLoadScratch, mesh.read_info ().peakScratchBytes);
+
+    std::vector<float> coords, normals;
+    std::vector<unsigned int> tris, solids;
+    stl_reader::StlReadInfo info;
+    stl_reader::ReadStlFile (filename, coords, normals, tris, solids, &info);
+    EXPECT_EQ (info.peakScratchBytes, mesh.read_info ().peakScratchBytes);
+  }
+
+  stl_reader::StlMesh <float, unsigned int> const empty;
+  EXPECT_EQ (empty.memory_usage ().peakLoadScratch, 0u);
+}
+
+TEST (memoryUsage, shrinkToFit)
+{
+  stl_reader::StlMesh <float, unsigned int> mesh ("data/ascii_sphere.stl");
+  auto const before = mesh.memory_usage ();
+  mesh.shrink_to_fit ();
+  auto const after = mesh.memory_usage ();
+  EXPECT_EQ (after.size (), before.size ());
+  EXPECT_EQ (after.capacity (), after.size ());
+  EXPECT_EQ (mesh.num_tris (), 20u);
+}
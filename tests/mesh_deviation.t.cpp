@@ -0,0 +1,86 @@
+#include "../stl_reader.h"
+#include <gtest/gtest.h>
+
+namespace
+{
+  using std::vector;
+
+  struct Mesh
+  {
+    Mesh (double scale = 1)
+    {
+      stl_reader::ReadStlFile ("data/binary_sphere.stl", coords, normals, tris, solids);
+      for (auto& c : coords)
+        c *= scale;
+    }
+
+    vector<double> coords, normals;
+    vector<size_t> tris, solids;
+  };
+
+  // inradius of the icosahedron with circumradius 1
+  double const inradius = 0.794654472291766;
+}
+
+TEST (meshDeviation, identicalMeshes)
+{
+  stl_reader::StlMesh <double, size_t> mesh ("data/binary_sphere.stl");
+  vector<double> vrtDeviations;
+  auto const dev = mesh.deviation (mesh, 1000, vrtDeviations);
+
+  EXPECT_NEAR (dev.hausdorff (), 0, 1e-12);
+  EXPECT_NEAR (dev.mean_dist (), 0, 1e-12);
+  ASSERT_EQ (vrtDeviations.size (), mesh.num_vrts ());
+  for (double d : vrtDeviations)
+    EXPECT_NEAR (d, 0, 1e-12);
+}
+
+TEST (meshDeviation, scaledMesh)
+{
+  Mesh const a (1.1), b;
+  vector<float> vrtDeviations;
+  auto const dev = stl_reader::ComputeMeshDeviation (a.coords, a.tris, b.coords, b.tris,
+                                                     5000, vrtDeviations);
+
+  // vertices of the larger mesh are farthest from the smaller one
+  EXPECT_NEAR (dev.maxDistAB, 0.1, 1e-6);
+  EXPECT_NEAR (dev.hausdorff (), 0.1, 1e-6);
+  ASSERT_EQ (vrtDeviations.size (), a.coords.size () / 3);
+  for (float d : vrtDeviations)
+    EXPECT_NEAR (d, 0.1, 1e-6);
+
+  // each point of the smaller mesh is closest to the parallel face of the larger one
+  EXPECT_NEAR (dev.maxDistBA, 0.1 * inradius, 1e-6);
+  EXPECT_NEAR (dev.meanDistBA, 0.1 * inradius, 1e-6);
+  EXPECT_GT (dev.meanDistAB, 0.1 * inradius);
+  EXPECT_LT (dev.meanDistAB, 0.1);
+}
+
+TEST (meshDeviation, resultsIndependentOfThreads)
+{
+  Mesh const a (1.05), b;
+  vector<double> vrtDeviations1, vrtDeviations4;
+  auto const dev1 = stl_reader::ComputeMeshDeviation (a.coords, a.tris, b.coords, b.tris,
+                                                      3000, vrtDeviations1, 1);
+  auto const dev4 = stl_reader::ComputeMeshDeviation (a.coords, a.tris, b.coords, b.tris,
+                                                      3000, vrtDeviations4, 4);
+  EXPECT_EQ (dev1.maxDistAB, dev4.maxDistAB);
+  EXPECT_EQ (dev1.maxDistBA, dev4.maxDistBA);
+  EXPECT_EQ (dev1.meanDistAB, dev4.meanDistAB);
+  EXPECT_EQ (dev1.meanDistBA, dev4.meanDistBA);
+  EXPECT_EQ (vrtDeviations1, vrtDeviations4);
+}
+
+TEST (meshDeviation, emptyMesh)
+{
+  Mesh const a;
+  vector<double> const noCoords;
+  vector<size_t> const noTris;
+  vector<double> vrtDeviations;
+  auto const dev = stl_reader::ComputeMeshDeviation (a.coords, a.tris, noCoords, noTris,
+                                                     100, vrtDeviations);
+  EXPECT_EQ (dev.maxDistAB, std::numeric_limits<double>::infinity ());
+  EXPECT_EQ (dev.maxDistBA, 0);
+  ASSERT_EQ (vrtDeviations.size (), a.coords.size () / 3);
+  EXPECT_EQ (vrtDeviations [0], std::numeric_limits<double>::infinity ());
+}
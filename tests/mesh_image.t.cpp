@@ -0,0 +1,136 @@
+#include "../stl_reader.h"
+#include <gtest/gtest.h>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace
+{
+  using Mesh = stl_reader::StlMesh <float, unsigned int>;
+  using View = stl_reader::StlMeshView <float, unsigned int>;
+
+  // a buffer aligned to the default new alignment, which exceeds the image alignment
+  auto imageBuffer (size_t size) -> std::vector<double>
+  {
+    return std::vector<double> ((size + sizeof (double) - 1) / sizeof (double));
+  }
+
+  void expectViewMatchesMesh (View const& view, Mesh const& mesh)
+  {
+    ASSERT_EQ (view.num_vrts (), mesh.num_vrts ());
+    ASSERT_EQ (view.num_tris (), mesh.num_tris ());
+    ASSERT_EQ (view.num_solids (), mesh.num_solids ());
+    EXPECT_EQ (std::memcmp (view.raw_coords (), mesh.raw_coords (), mesh.num_vrts () * 3 * sizeof (float)), 0);
+    EXPECT_EQ (std::memcmp (view.raw_normals (), mesh.raw_normals (), mesh.num_tris () * 3 * sizeof (float)), 0);
+    EXPECT_EQ (std::memcmp (view.raw_tris (), mesh.raw_tris (), mesh.num_tris () * 3 * sizeof (unsigned int)), 0);
+    for (size_t si = 0; si < mesh.num_solids (); ++si)
+    {
+      EXPECT_EQ (view.solid_tris_begin (si), mesh.solid_tris_begin (si));
+      EXPECT_EQ (view.solid_tris_end (si), mesh.solid_tris_end (si));
+    }
+    EXPECT_EQ (view.tri_corner_coords (3, 1), view.vrt_coords (view.tri_corner_ind (3, 1)));
+  }
+}
+
+TEST (meshImage, viewMatchesMesh)
+{
+  Mesh const mesh ("data/ascii_sphere.stl");
+  auto buffer = imageBuffer (mesh.image_size ());
+  ASSERT_TRUE (mesh.write_image (buffer.data (), mesh.image_size ()));
+
+  View const view (buffer.data (), mesh.image_size ());
+  expectViewMatchesMesh (view, mesh);
+  // zero copy: the view points into the image
+  EXPECT_EQ (view.image (), static_cast<void const*> (buffer.data ()));
+  EXPECT_GT (static_cast<void const*> (view.raw_coords ()), view.image ());
+}
+
+TEST (meshImage, isRelocatable)
+{
+  Mesh const mesh ("data/binary_sphere.stl");
+  size_t const size = mesh.image_size ();
+  auto buffer = imageBuffer (size);
+  mesh.write_image (buffer.data (), size);
+
+  auto moved = imageBuffer (size);
+  std::memcpy (moved.data (), buffer.data (), size);
+  buffer.assign (buffer.size (), 0);
+  expectViewMatchesMesh (View (moved.data (), size), mesh);
+}
+
+TEST (meshImage, emptyMesh)
+{
+  Mesh const mesh;
+  auto buffer = imageBuffer (mesh.image_size ());
+  mesh.write_image (buffer.data (), mesh.image_size ());
+  View const view (buffer.data (), mesh.image_size ());
+  EXPECT_EQ (view.num_vrts (), 0u);
+  EXPECT_EQ (view.num_tris (), 0u);
+  EXPECT_EQ (view.raw_coords (), nullptr);
+}
+
+TEST (meshImage, rejectsInvalidImages)
+{
+  Mesh const mesh ("data/binary_sphere.stl");
+  size_t const size = mesh.image_size ();
+  auto buffer = imageBuffer (size);
+  EXPECT_THROW (mesh.write_image (buffer.data (), size - 1), std::runtime_error);
+  mesh.write_image (buffer.data (), size);
+
+  EXPECT_THROW (View (buffer.data (), size - 1), std::runtime_error);
+  EXPECT_THROW ((stl_reader::StlMeshView <double, unsigned int> (buffer.data (), size)), std::runtime_error);
+  EXPECT_THROW (View (reinterpret_cast<char*> (buffer.data ()) + 8, size - 8), std::runtime_error);
+
+  auto header = reinterpret_cast<stl_reader::StlMeshImageHeader*> (buffer.data ());
+  header->trisOffset = size;
+  EXPECT_THROW (View (buffer.data (), size), std::runtime_error);
+  header->magic [0] = 'X';
+  EXPECT_THROW (View (buffer.data (), size), std::runtime_error);
+}
+
+#ifdef __linux__
+TEST (meshImage, sharedMemfdAcrossFork)
+{
+  Mesh const mesh ("data/ascii_sphere.stl");
+  int fd = -1;
+  ASSERT_TRUE (stl_reader::PublishStlMeshImage_MEMFD (mesh, "stl_reader_test", fd));
+
+  // the image is sealed against modification
+  EXPECT_EQ (mmap (nullptr, mesh.image_size (), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0), MAP_FAILED);
+
+  pid_t const pid = fork ();
+  ASSERT_GE (pid, 0);
+  if (pid == 0)
+  {
+    stl_reader::SharedStlMeshImage <float, unsigned int> image;
+    image.open_fd (fd);
+    bool const ok = image.view ().num_tris () == mesh.num_tris () &&
+                    std::memcmp (image.view ().raw_coords (), mesh.raw_coords (),
+                                 mesh.num_vrts () * 3 * sizeof (float)) == 0;
+    _exit (ok ? 0 : 1);
+  }
+  int status = 0;
+  waitpid (pid, &status, 0);
+  EXPECT_TRUE (WIFEXITED (status) && WEXITSTATUS (status) == 0);
+  close (fd);
+}
+#endif
+
+TEST (meshImage, sharedMemoryObject)
+{
+  Mesh const mesh ("data/binary_sphere.stl");
+  std::string const name = "/stl_reader_test_" + std::to_string (getpid ());
+  ASSERT_TRUE (stl_reader::PublishStlMeshImage_SHM (mesh, name.c_str ()));
+  EXPECT_THROW (stl_reader::PublishStlMeshImage_SHM (mesh, name.c_str ()), std::runtime_error);
+
+  {
+    stl_reader::SharedStlMeshImage <float, unsigned int> image;
+    image.open_shm (name.c_str ());
+    expectViewMatchesMesh (image.view (), mesh);
+  }
+  shm_unlink (name.c_str ());
+
+  stl_reader::SharedStlMeshImage <float, unsigned int> missing;
+  EXPECT_THROW (missing.open_shm (name.c_str ()), std::runtime_error);
+}
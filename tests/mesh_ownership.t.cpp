@@ -0,0 +1,80 @@
+#include "../stl_reader.h"
+#include <gtest/gtest.h>
+
+namespace
+{
+  using Mesh = stl_reader::StlMesh <float, unsigned int>;
+  using std::vector;
+}
+
+TEST (meshOwnership, releaseMovesStorage)
+{
+  Mesh mesh ("data/ascii_sphere.stl");
+  float const* coordsData = mesh.raw_coords ();
+  unsigned int const* trisData = mesh.raw_tris ();
+  size_t const numVrts = mesh.num_vrts ();
+
+  vector<float> coords, normals;
+  vector<unsigned int> tris, solids;
+  mesh.release (coords, normals, tris, solids);
+
+  EXPECT_EQ (coords.data (), coordsData);
+  EXPECT_EQ (tris.data (), trisData);
+  EXPECT_EQ (coords.size (), 3 * numVrts);
+  EXPECT_EQ (tris.size (), 60u);
+  EXPECT_EQ (solids.size (), 3u);
+
+  EXPECT_EQ (mesh.num_vrts (), 0u);
+  EXPECT_EQ (mesh.num_tris (), 0u);
+  EXPECT_EQ (mesh.num_solids (), 1u);
+  EXPECT_EQ (mesh.memory_usage ().capacity (), 2 * sizeof (unsigned int));
+}
+
+TEST (meshOwnership, takeSingleArray)
+{
+  Mesh mesh ("data/binary_sphere.stl");
+  float const* normalsData = mesh.raw_normals ();
+  vector<float> normals (100, 1.f);
+  mesh.take_normals (normals);
+  EXPECT_EQ (normals.data (), normalsData);
+  EXPECT_EQ (normals.size (), 60u);
+  EXPECT_EQ (mesh.raw_normals (), nullptr);
+  EXPECT_EQ (mesh.num_tris (), 20u);
+}
+
+TEST (meshOwnership, adoptArrays)
+{
+  vector<float> coords, normals;
+  vector<unsigned int> tris, solids;
+  stl_reader::ReadStlFile ("data/binary_sphere.stl", coords, normals, tris, solids);
+  float const* coordsData = coords.data ();
+
+  Mesh const mesh (coords, normals, tris, solids);
+  EXPECT_EQ (mesh.raw_coords (), coordsData);
+  EXPECT_EQ (mesh.num_tris (), 20u);
+  EXPECT_EQ (mesh.num_solids (), 1u);
+  EXPECT_TRUE (coords.empty ());
+  EXPECT_TRUE (solids.empty ());
+
+  // without solids, all triangles form one solid
+  Mesh copy (mesh);
+  copy.release (coords, normals, tris, solids);
+  solids.clear ();
+  Mesh const adopted (coords, normals, tris, solids);
+  EXPECT_EQ (adopted.num_solids (), 1u);
+  EXPECT_EQ (adopted.solid_tris_end (0), 20u);
+}
+
+TEST (meshOwnership, swap)
+{
+  Mesh a ("data/binary_sphere.stl");
+  Mesh b ("data/ascii_sphere.stl");
+  float const* coordsA = a.raw_coords ();
+  size_t const scratchA = a.read_info ().peakScratchBytes;
+
+  swap (a, b);
+  EXPECT_EQ (b.raw_coords (), coordsA);
+  EXPECT_EQ (b.read_info ().peakScratchBytes, scratchA);
+  EXPECT_EQ (a.num_solids (), 2u);
+  EXPECT_EQ (b.num_solids (), 1u);
+}
@@ -0,0 +1,149 @@
+#include "../stl_reader.h"
+#include <gtest/gtest.h>
+#include <map>
+#include <utility>
+
+namespace
+{
+  using std::vector;
+
+  struct SphereArrays
+  {
+    SphereArrays ()
+    {
+      stl_reader::ReadStlFile ("data/binary_sphere.stl", coords, normals, tris, solids);
+    }
+
+    vector<float> coords, normals;
+    vector<unsigned int> tris, solids;
+  };
+
+  // returns true if each directed edge occurs once and its reverse occurs, too.
+  bool isClosedAndConsistent (vector<unsigned int> const& tris)
+  {
+    std::map<std::pair<unsigned int, unsigned int>, int> directedEdges;
+    for (size_t i = 0; i < tris.size (); i += 3)
+      for (size_t j = 0; j < 3; ++j)
+        ++directedEdges [{tris [i + j], tris [i + (j + 1) % 3]}];
+
+    for (auto const& e : directedEdges)
+    {
+      auto const reverse = directedEdges.find ({e.first.second, e.first.first});
+      if (e.second != 1 || reverse == directedEdges.end () || reverse->second != 1)
+        return false;
+    }
+    return true;
+  }
+
+  void flipTriangle (SphereArrays& sphere, size_t iTri)
+  {
+    std::swap (sphere.tris [iTri * 3], sphere.tris [iTri * 3 + 1]);
+    for (size_t i = 0; i < 3; ++i)
+      sphere.normals [iTri * 3 + i] *= -1;
+  }
+}
+
+TEST (meshRepair, orientTrianglesRestoresFlippedTriangles)
+{
+  SphereArrays sphere;
+  ASSERT_TRUE (isClosedAndConsistent (sphere.tris));
+
+  SphereArrays flipped;
+  flipTriangle (flipped, 3);
+  flipTriangle (flipped, 11);
+  ASSERT_FALSE (isClosedAndConsistent (flipped.tris));
+
+  EXPECT_EQ (stl_reader::OrientTriangles (flipped.tris, flipped.normals), 2);
+  EXPECT_TRUE (isClosedAndConsistent (flipped.tris));
+  for (size_t i = 0; i < sphere.normals.size (); ++i)
+    EXPECT_EQ (flipped.normals [i], sphere.normals [i]);
+}
+
+TEST (meshRepair, orientTrianglesKeepsConsistentMesh)
+{
+  SphereArrays sphere;
+  auto const tris = sphere.tris;
+  EXPECT_EQ (stl_reader::OrientTriangles (sphere.tris, sphere.normals, 1), 0);
+  EXPECT_EQ (sphere.tris, tris);
+}
+
+TEST (meshRepair, fillHolesClosesRemovedTriangle)
+{
+  SphereArrays sphere;
+  sphere.tris.erase (sphere.tris.begin () + 15, sphere.tris.begin () + 18);
+  sphere.normals.erase (sphere.normals.begin () + 15, sphere.normals.begin () + 18);
+  sphere.solids.back () -= 1;
+
+  EXPECT_EQ (stl_reader::FillHoles (sphere.coords, sphere.tris, sphere.normals, sphere.solids, 8), 1);
+  EXPECT_EQ (sphere.tris.size (), 60);
+  EXPECT_EQ (sphere.normals.size (), 60);
+  EXPECT_EQ (sphere.solids.back (), 20);
+  EXPECT_TRUE (isClosedAndConsistent (sphere.tris));
+
+  SphereArrays original;
+  for (size_t i = 0; i < 3; ++i)
+    EXPECT_NEAR (sphere.normals [57 + i], original.normals [15 + i], 1.e-5);
+}
+
+TEST (meshRepair, fillHolesIgnoresLargeHoles)
+{
+  SphereArrays sphere;
+  sphere.tris.resize (sphere.tris.size () - 6);
+  sphere.normals.resize (sphere.normals.size () - 6);
+  sphere.solids.back () -= 2;
+
+  EXPECT_EQ (stl_reader::FillHoles (sphere.coords, sphere.tris, sphere.normals, sphere.solids, 3), 0);
+  EXPECT_EQ (sphere.tris.size (), 54);
+}
+
+TEST (meshRepair, fillHolesKeepsLoneTriangle)
+{
+  vector<float> const coords = {0, 0, 0, 1, 0, 0, 0, 1, 0};
+  vector<unsigned int> tris = {0, 1, 2};
+  vector<float> normals = {0, 0, 1};
+  vector<unsigned int> solids = {0, 1};
+
+  EXPECT_EQ (stl_reader::FillHoles (coords, tris, normals, solids, 8), 0);
+  EXPECT_EQ (tris.size (), 3);
+  EXPECT_EQ (solids.back (), 1);
+}
+
+TEST (meshRepair, fillHolesKeepsOpenQuad)
+{
+  vector<float> const coords = {0, 0, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0};
+  vector<unsigned int> tris = {0, 1, 2, 0, 2, 3};
+  vector<float> normals = {0, 0, 1, 0, 0, 1};
+  vector<unsigned int> solids = {0, 2};
+
+  EXPECT_EQ (stl_reader::FillHoles (coords, tris, normals, solids, 8), 0);
+  EXPECT_EQ (tris.size (), 6);
+}
+
+TEST (meshRepair, fillHolesClosesSphereNextToStrayTriangle)
+{
+  SphereArrays sphere;
+  sphere.tris.erase (sphere.tris.begin () + 15, sphere.tris.begin () + 18);
+  sphere.normals.erase (sphere.normals.begin () + 15, sphere.normals.begin () + 18);
+  sphere.solids.back () -= 1;
+
+  unsigned int const firstStray = static_cast<unsigned int> (sphere.coords.size () / 3);
+  float const stray [9] = {5, 0, 0, 6, 0, 0, 5, 1, 0};
+  sphere.coords.insert (sphere.coords.end (), stray, stray + 9);
+  for (unsigned int i = 0; i < 3; ++i)
+    sphere.tris.push_back (firstStray + i);
+  sphere.normals.insert (sphere.normals.end (), {0, 0, 1});
+  sphere.solids.back () += 1;
+
+  EXPECT_EQ (stl_reader::FillHoles (sphere.coords, sphere.tris, sphere.normals, sphere.solids, 8), 1);
+  EXPECT_EQ (sphere.tris.size (), 63);
+}
+
+TEST (meshRepair, repairStlMesh)
+{
+  stl_reader::StlMesh<> mesh ("data/ascii_sphere.stl");
+  mesh.repair ();
+  EXPECT_EQ (mesh.num_tris (), 20);
+  EXPECT_EQ (mesh.num_solids (), 2);
+  vector<unsigned int> tris (mesh.raw_tris (), mesh.raw_tris () + mesh.num_tris () * 3);
+  EXPECT_TRUE (isClosedAndConsistent (tris));
+}
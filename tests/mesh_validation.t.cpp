@@ -0,0 +1,74 @@
+#include "../stl_reader.h"
+#include <gtest/gtest.h>
+
+namespace
+{
+  using std::vector;
+  using stl_reader::MeshValidation;
+
+  vector<MeshValidation> validate (vector<unsigned int> const& tris, vector<unsigned int> const& solids)
+  {
+    vector<MeshValidation> reports;
+    stl_reader::ValidateMesh (tris, solids, reports);
+    return reports;
+  }
+}
+
+TEST (meshValidation, closedSphere)
+{
+  stl_reader::StlMesh<> mesh ("data/binary_sphere.stl");
+  auto const reports = mesh.validate ();
+  ASSERT_EQ (reports.size (), 1);
+  EXPECT_EQ (reports [0].numBoundaryEdges, 0);
+  EXPECT_EQ (reports [0].numNonManifoldEdges, 0);
+  EXPECT_EQ (reports [0].numNonManifoldVrts, 0);
+  EXPECT_EQ (reports [0].numInconsistentEdges, 0);
+  EXPECT_TRUE (reports [0].is_watertight ());
+}
+
+TEST (meshValidation, perSolidResults)
+{
+  stl_reader::StlMesh<> mesh ("data/ascii_sphere.stl");
+  auto const reports = mesh.validate (1);
+  ASSERT_EQ (reports.size (), 2);
+  EXPECT_EQ (reports [0].numBoundaryEdges, 4);
+  EXPECT_FALSE (reports [0].is_closed ());
+  EXPECT_TRUE (reports [0].is_manifold ());
+  EXPECT_EQ (reports [1].numBoundaryEdges, 4);
+  EXPECT_EQ (reports [1].numInconsistentEdges, 0);
+}
+
+TEST (meshValidation, inconsistentOrientation)
+{
+  vector<unsigned int> const tris {
+    0, 1, 2,
+    1, 2, 3};
+  auto const reports = validate (tris, {0, 2});
+  EXPECT_EQ (reports [0].numBoundaryEdges, 4);
+  EXPECT_EQ (reports [0].numInconsistentEdges, 1);
+  EXPECT_TRUE (reports [0].is_manifold ());
+}
+
+TEST (meshValidation, nonManifoldEdge)
+{
+  vector<unsigned int> const tris {
+    0, 1, 2,
+    1, 0, 3,
+    0, 1, 4};
+  auto const reports = validate (tris, {0, 3});
+  EXPECT_EQ (reports [0].numNonManifoldEdges, 1);
+  EXPECT_EQ (reports [0].numBoundaryEdges, 6);
+  EXPECT_FALSE (reports [0].is_manifold ());
+}
+
+TEST (meshValidation, nonManifoldVertex)
+{
+  // two triangles which only touch in vertex 0
+  vector<unsigned int> const tris {
+    0, 1, 2,
+    0, 3, 4};
+  auto const reports = validate (tris, {0, 2});
+  EXPECT_EQ (reports [0].numNonManifoldEdges, 0);
+  EXPECT_EQ (reports [0].numNonManifoldVrts, 1);
+  EXPECT_FALSE (reports [0].is_manifold ());
+}
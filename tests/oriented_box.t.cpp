@@ -0,0 +1,110 @@
+#include "../stl_reader.h"
+#include <gtest/gtest.h>
+#include <random>
+
+namespace
+{
+  using std::vector;
+
+  // rotation matrix around the axis (1, 2, 3) by 0.7 radians
+  struct Rotation
+  {
+    Rotation ()
+    {
+      double axis [3] = {1, 2, 3};
+      double const len = sqrt (14.);
+      for (auto& a : axis)
+        a /= len;
+      double const c = cos (0.7), s = sin (0.7);
+      for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j)
+          m [i][j] = (i == j ? c : 0) + (1 - c) * axis [i] * axis [j];
+      m [0][1] -= s * axis [2]; m [0][2] += s * axis [1];
+      m [1][0] += s * axis [2]; m [1][2] -= s * axis [0];
+      m [2][0] -= s * axis [1]; m [2][1] += s * axis [0];
+    }
+
+    void apply (double const* p, vector<double>& out) const
+    {
+      for (int i = 0; i < 3; ++i)
+        out.push_back (m [i][0] * p [0] + m [i][1] * p [1] + m [i][2] * p [2] + i + 5);
+    }
+
+    double m [3][3];
+  };
+
+  vector<double> rotatedBoxPoints (double const* size, int numInterior)
+  {
+    Rotation const rot;
+    vector<double> points;
+    for (int i = 0; i < 8; ++i)
+    {
+      double const p [3] = {(i & 1) * size [0], ((i >> 1) & 1) * size [1], ((i >> 2) & 1) * size [2]};
+      rot.apply (p, points);
+    }
+    std::mt19937 gen (1);
+    std::uniform_real_distribution<double> dist (0, 1);
+    for (int i = 0; i < numInterior; ++i)
+    {
+      double const p [3] = {dist (gen) * size [0], dist (gen) * size [1], dist (gen) * size [2]};
+      rot.apply (p, points);
+    }
+    return points;
+  }
+}
+
+TEST (orientedBox, rotatedBox)
+{
+  double const size [3] = {3, 2, 1};
+  auto const box = stl_reader::ComputeOrientedBox (rotatedBoxPoints (size, 500));
+
+  EXPECT_NEAR (box.volume (), 6, 1.e-9);
+  EXPECT_NEAR (box.halfExtents [0], 1.5, 1.e-9);
+  EXPECT_NEAR (box.halfExtents [1], 1, 1.e-9);
+  EXPECT_NEAR (box.halfExtents [2], 0.5, 1.e-9);
+
+  Rotation const rot;
+  for (int k = 0; k < 3; ++k)
+  {
+    double const dot = box.axes [k][0] * rot.m [0][k] + box.axes [k][1] * rot.m [1][k] + box.axes [k][2] * rot.m [2][k];
+    EXPECT_NEAR (fabs (dot), 1, 1.e-9);
+  }
+
+  double cross [3];
+  stl_reader::stl_reader_impl::Cross (box.axes [0], box.axes [1], cross);
+  for (int d = 0; d < 3; ++d)
+    EXPECT_NEAR (cross [d], box.axes [2][d], 1.e-12);
+}
+
+TEST (orientedBox, rotatedCubeRefinesIsotropicCovariance)
+{
+  double const size [3] = {1, 1, 1};
+  auto const box = stl_reader::ComputeOrientedBox (rotatedBoxPoints (size, 0));
+  EXPECT_NEAR (box.volume (), 1, 1.e-9);
+}
+
+TEST (orientedBox, perSolid)
+{
+  stl_reader::StlMesh<> mesh ("data/ascii_sphere.stl");
+  auto const boxes = mesh.solid_oriented_boxes ();
+  ASSERT_EQ (boxes.size (), 2);
+
+  // the first solid consists of two triangles sharing an edge
+  EXPECT_LT (boxes [0].volume (), boxes [1].volume ());
+  auto const whole = mesh.oriented_box ();
+  EXPECT_GE (whole.volume (), boxes [1].volume () - 1.e-6);
+  EXPECT_LE (whole.volume (), 8);
+
+  for (size_t iTri = 0; iTri < mesh.num_tris (); ++iTri)
+    for (size_t iCorner = 0; iCorner < 3; ++iCorner)
+    {
+      float const* c = mesh.tri_corner_coords (iTri, iCorner);
+      for (int k = 0; k < 3; ++k)
+      {
+        double dist = 0;
+        for (int d = 0; d < 3; ++d)
+          dist += (c [d] - whole.center [d]) * whole.axes [k][d];
+        EXPECT_LE (fabs (dist), whole.halfExtents [k] + 1.e-6);
+      }
+    }
+}
@@ -1,5 +1,8 @@
 #include "../stl_reader.h"
 #include <gtest/gtest.h>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
 
 TEST (readSTL, asciiSphere)
 {
@@ -26,3 +29,142 @@ TEST (readSTL, binarySphere)
   EXPECT_EQ (mesh.solid_tris_begin (0), 0);
   EXPECT_EQ (mesh.solid_tris_end (0), 20);
 }
+
+TEST (readSTL, binarySphereFloatAndDoubleMatch)
+{
+  stl_reader::StlMesh<float> meshF ("data/binary_sphere.stl");
+  stl_reader::StlMesh<double> meshD ("data/binary_sphere.stl");
+
+  ASSERT_EQ (meshF.num_vrts (), meshD.num_vrts ());
+  ASSERT_EQ (meshF.num_tris (), meshD.num_tris ());
+  for (size_t i = 0; i < meshF.num_vrts () * 3; ++i)
+    EXPECT_EQ (static_cast<double> (meshF.raw_coords () [i]), meshD.raw_coords () [i]);
+  for (size_t i = 0; i < meshF.num_tris () * 3; ++i)
+  {
+    EXPECT_EQ (meshF.raw_tris () [i], meshD.raw_tris () [i]);
+    EXPECT_EQ (static_cast<double> (meshF.raw_normals () [i]), meshD.raw_normals () [i]);
+  }
+}
+
+TEST (readSTL, asciiSphereFloatAndDoubleMatch)
+{
+  stl_reader::StlMesh<float> meshF ("data/ascii_sphere.stl");
+  stl_reader::StlMesh<double> meshD ("data/ascii_sphere.stl");
+
+  ASSERT_EQ (meshF.num_vrts (), meshD.num_vrts ());
+  for (size_t i = 0; i < meshF.num_vrts () * 3; ++i)
+    EXPECT_EQ (meshF.raw_coords () [i], static_cast<float> (meshD.raw_coords () [i]));
+
+  float const* c = meshF.tri_corner_coords (0, 0);
+  EXPECT_EQ (c [0], -0.525731f);
+  EXPECT_EQ (c [1], 0.850651f);
+  EXPECT_EQ (c [2], 0.f);
+}
+
+TEST (readSTL, asciiParsesFloatDirectly)
+{
+  // 1 + 2^-24 is the midpoint between 1 and the next float. Parsed as float,
+  // the literal rounds up. Parsed as double, it rounds to the midpoint, which
+  // a cast to float rounds to even, i.e. to 1.
+  char const* filename = "double_rounding.stl";
+  {
+    std::ofstream out (filename);
+    out << "solid s\nfacet normal 0 0 1.00000005960464477539062500000001\nouter loop\n"
+           "vertex 1.00000005960464477539062500000001 0 0\nvertex 2 0 0\nvertex 2 1 0\n"
+           "endloop\nendfacet\nendsolid s\n";
+  }
+  stl_reader::StlMesh<float> meshF (filename);
+  stl_reader::StlMesh<double> meshD (filename);
+  std::remove (filename);
+
+  float const nextAfterOne = std::nextafter (1.f, 2.f);
+  ASSERT_EQ (meshF.num_tris (), 1);
+  EXPECT_EQ (meshF.tri_corner_coords (0, 0) [0], nextAfterOne);
+  EXPECT_EQ (meshF.tri_normal (0) [2], nextAfterOne);
+  EXPECT_EQ (static_cast<float> (meshD.tri_corner_coords (0, 0) [0]), 1.f);
+}
+
+TEST (readSTL, asciiRelativeKeepsPrecision)
+{
+  // a tiny quad with georeferenced coordinates, below float resolution
+  char const* filename = "georeferenced_quad.stl";
+  {
+    std::ofstream out (filename);
+    out.precision (17);
+    double const x = 3512345.0, y = 5401234.0, z = 612.0;
+    double const quad [4][3] = {{x, y, z}, {x + 0.001, y, z}, {x + 0.001, y + 0.001, z}, {x, y + 0.001, z}};
+    int const tris [2][3] = {{0, 1, 2}, {0, 2, 3}};
+    out << "solid quad\n";
+    for (auto const& t : tris)
+    {
+      out << "facet normal 0 0 1\nouter loop\n";
+      for (int i : t)
+        out << "vertex " << quad [i][0] << " " << quad [i][1] << " " << quad [i][2] << "\n";
+      out << "endloop\nendfacet\n";
+    }
+    out << "endsolid quad\n";
+  }
+
+  stl_reader::StlMesh<float> plain (filename);
+  EXPECT_LT (plain.num_vrts (), 4);
+  EXPECT_EQ (plain.origin () [0], 0);
+
+  stl_reader::StlMesh<float> relative;
+  relative.read_file_relative (filename);
+  std::remove (filename);
+  ASSERT_EQ (relative.num_vrts (), 4);
+  ASSERT_EQ (relative.num_tris (), 2);
+  EXPECT_DOUBLE_EQ (relative.origin () [0], 3512345.0005);
+  EXPECT_DOUBLE_EQ (relative.origin () [1], 5401234.0005);
+  EXPECT_DOUBLE_EQ (relative.origin () [2], 612.0);
+
+  float const* c = relative.tri_corner_coords (0, 2);
+  EXPECT_NEAR (relative.origin () [0] + c [0], 3512345.001, 1e-9);
+  EXPECT_NEAR (relative.origin () [1] + c [1], 5401234.001, 1e-9);
+
+  // binary and plain ascii files are read as usual, relative to their box center
+  stl_reader::StlMesh<float> sphere;
+  sphere.read_file_relative ("data/ascii_sphere.stl");
+  EXPECT_EQ (sphere.num_vrts (), 12);
+  EXPECT_EQ (sphere.num_solids (), 2);
+  sphere.read_file_relative ("data/binary_sphere.stl");
+  EXPECT_EQ (sphere.num_vrts (), 12);
+  EXPECT_EQ (sphere.num_tris (), 20);
+}
+
+TEST (readSTL, truncatedBinaryRecovery)
+{
+  std::ifstream in ("data/binary_sphere.stl", std::ios::binary);
+  std::string const content ((std::istreambuf_iterator<char> (in)), std::istreambuf_iterator<char> ());
+  ASSERT_EQ (content.size (), 84u + 20 * 50);
+
+  // 7 complete records followed by a partial one
+  char const* filename = "truncated_sphere.stl";
+  std::ofstream (filename, std::ios::binary).write (content.data (), 84 + 7 * 50 + 20);
+
+  stl_reader::StlMesh<> mesh;
+  EXPECT_THROW (mesh.read_file (filename), std::runtime_error);
+
+  ASSERT_TRUE (mesh.recover_file (filename));
+  EXPECT_EQ (mesh.num_tris (), 7);
+  EXPECT_EQ (mesh.read_info ().numTrisMissing, 13);
+
+  stl_reader::StlMesh<> const full ("data/binary_sphere.stl");
+  for (size_t itri = 0; itri < mesh.num_tris (); ++itri)
+    for (size_t icorner = 0; icorner < 3; ++icorner)
+      for (size_t d = 0; d < 3; ++d)
+        EXPECT_EQ (mesh.tri_corner_coords (itri, icorner) [d], full.tri_corner_coords (itri, icorner) [d]);
+
+  // a file which only consists of its header
+  std::ofstream (filename, std::ios::binary).write (content.data (), 84);
+  ASSERT_TRUE (mesh.recover_file (filename));
+  EXPECT_EQ (mesh.num_tris (), 0);
+  EXPECT_EQ (mesh.num_vrts (), 0);
+  EXPECT_EQ (mesh.num_solids (), 1);
+  EXPECT_EQ (mesh.read_info ().numTrisMissing, 20);
+
+  ASSERT_TRUE (mesh.recover_file ("data/binary_sphere.stl"));
+  EXPECT_EQ (mesh.num_tris (), 20);
+  EXPECT_EQ (mesh.read_info ().numTrisMissing, 0);
+  std::remove (filename);
+}
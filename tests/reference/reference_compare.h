@@ -0,0 +1,151 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+enum class CompareOrder
+{
+  // all arrays have to be equal bit for bit, including the order of vertices
+  EXACT,
+  // vertices may be ordered differently. Triangles are compared through the
+  // bits of their corner coordinates, the set of vertices has to be equal.
+  // Normals and solids have to be equal bit for bit.
+  VERTEX_ORDER_INDEPENDENT
+};
+
+// Known differences between the current readers and the frozen reference
+// implementation in stl_reader_reference.h. The flags are combined and passed
+// to compareMeshes or to copyWithoutBlankLines.
+enum ReferenceDivergence
+{
+  NO_DIVERGENCE = 0,
+  // The reference parses ASCII numbers with atof and casts the double to
+  // float, i.e. it rounds twice. The current readers parse floats with strtof.
+  // For decimals just above the midpoint of two floats, the results differ by
+  // one unit in the last place. With this flag, compareMeshes accepts such
+  // differences in coordinates and normals. It still expects the same order
+  // and merging of vertices, which holds unless two corners of a file are
+  // closer than one unit in the last place.
+  DOUBLE_ROUNDING = 1,
+  // The reference tokenizes lines with istringstream and keeps the tokens of
+  // the previous line for an empty line. An empty line after a vertex thus
+  // counts as a vertex without coordinates and the reference throws, one after
+  // 'endfacet' repeats the triangle and one after 'solid' starts another solid.
+  // The current readers skip empty lines. With this flag, the reference has to
+  // read a copy of the file which was written by copyWithoutBlankLines.
+  BLANK_LINES = 2
+};
+
+template <class number_t, class index_t>
+struct MeshArrays
+{
+  std::vector<number_t> coords, normals;
+  std::vector<index_t> tris, solids;
+};
+
+namespace reference_compare_detail
+{
+  template <class number_t>
+  bool bitwiseEqual (number_t const* a, number_t const* b, size_t n)
+  {
+    return std::memcmp (a, b, n * sizeof (number_t)) == 0;
+  }
+
+  // true if 'a' and 'b' are equal or adjacent floating point numbers
+  template <class number_t>
+  bool withinOneUlp (number_t a, number_t b)
+  {
+    return a == b || std::nextafter (a, b) == b;
+  }
+
+  template <class number_t>
+  std::string compareNumbers (char const* name, std::vector<number_t> const& a, std::vector<number_t> const& b,
+                              bool allowOneUlp = false)
+  {
+    std::stringstream ss;
+    if (a.size () != b.size ())
+      ss << name << ": sizes differ (" << a.size () << " vs " << b.size () << ")";
+    else
+    {
+      for (size_t i = 0; i < a.size (); ++i)
+        if (!bitwiseEqual (&a [i], &b [i], 1) && !(allowOneUlp && withinOneUlp (a [i], b [i])))
+        {
+          ss << name << " [" << i << "] differs (" << a [i] << " vs " << b [i] << ")";
+          break;
+        }
+    }
+    return ss.str ();
+  }
+
+  // the vertex coordinates of 'm', ordered by their bit patterns
+  template <class number_t, class index_t>
+  std::vector<std::string> sortedVertexBits (MeshArrays<number_t, index_t> const& m)
+  {
+    std::vector<std::string> vrts;
+    for (size_t i = 0; i + 2 < m.coords.size (); i += 3)
+      vrts.emplace_back (reinterpret_cast<char const*> (&m.coords [i]), 3 * sizeof (number_t));
+    std::sort (vrts.begin (), vrts.end ());
+    return vrts;
+  }
+}
+
+// Returns an empty string if 'a' and 'b' are equal with respect to 'order',
+// up to the differences permitted by 'divergences' (see ReferenceDivergence).
+// Otherwise a description of the first difference is returned.
+template <class number_t, class index_t>
+std::string compareMeshes (MeshArrays<number_t, index_t> const& a,
+                           MeshArrays<number_t, index_t> const& b,
+                           CompareOrder order,
+                           unsigned divergences = NO_DIVERGENCE)
+{
+  using namespace reference_compare_detail;
+
+  bool const allowOneUlp = (divergences & DOUBLE_ROUNDING) != 0;
+  std::string diff = compareNumbers ("normals", a.normals, b.normals, allowOneUlp);
+  if (diff.empty ())
+    diff = compareNumbers ("solids", a.solids, b.solids);
+  if (!diff.empty ())
+    return diff;
+
+  if (order == CompareOrder::EXACT)
+  {
+    diff = compareNumbers ("coords", a.coords, b.coords, allowOneUlp);
+    return diff.empty () ? compareNumbers ("tris", a.tris, b.tris) : diff;
+  }
+
+  if (allowOneUlp)
+    return "DOUBLE_ROUNDING requires CompareOrder::EXACT";
+
+  if (a.coords.size () != b.coords.size () || sortedVertexBits (a) != sortedVertexBits (b))
+    return "coords: the sets of vertices differ";
+
+  if (a.tris.size () != b.tris.size ())
+    return compareNumbers ("tris", a.tris, b.tris);
+
+  for (size_t i = 0; i < a.tris.size (); ++i)
+  {
+    if (a.tris [i] * 3 + 2 >= a.coords.size () || b.tris [i] * 3 + 2 >= b.coords.size ())
+      return "tris [" + std::to_string (i) + "] is out of range";
+    if (!bitwiseEqual (&a.coords [3 * a.tris [i]], &b.coords [3 * b.tris [i]], 3))
+      return "tris [" + std::to_string (i) + "] refers to different coordinates";
+  }
+  return "";
+}
+
+// Writes the lines of 'filename' which contain more than white space to
+// 'copyFilename', so that the reference reads a file with blank lines like
+// the current readers (see BLANK_LINES).
+inline void copyWithoutBlankLines (std::string const& filename, std::string const& copyFilename)
+{
+  std::ifstream in (filename);
+  std::ofstream out (copyFilename);
+  std::string line;
+  while (std::getline (in, line))
+    if (line.find_first_not_of (" \t\r\f\v") != std::string::npos)
+      out << line << "\n";
+}
@@ -0,0 +1,369 @@
+#pragma once
+
+// Frozen copy of the stl readers of stl_reader.h, used as reference for the
+// differential tests and benchmarks of faster implementations.
+//
+// Do not optimize or otherwise modify this file. It is the implementation of
+// ReadStlFile, ReadStlFile_ASCII, ReadStlFile_BINARY and RemoveDoubles before
+// any of the optimizations of the readers, i.e. lines are tokenized with
+// istringstream and numbers are parsed with atof. The only change is that
+// RemoveDoubles accepts input without any corners. Known differences of the
+// current readers to this implementation are listed in reference_compare.h
+// (see ReferenceDivergence).
+//
+// Output order: vertices are ordered lexicographically by their coordinates
+// (x, then y, then z). Triangles and their normals keep the order of the file,
+// triangles with less than three distinct corners are removed. An optimized
+// reader which orders vertices differently has to be compared with
+// CompareOrder::VERTEX_ORDER_INDEPENDENT (see reference_compare.h).
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace stl_reader_reference
+{
+
+#define STL_READER_REFERENCE_THROW(msg) {std::stringstream ss; ss << msg; throw std::runtime_error (ss.str ());}
+#define STL_READER_REFERENCE_COND_THROW(cond, msg) if (cond) {STL_READER_REFERENCE_THROW (msg)}
+
+// a coordinate triple with an additional index. The index is required
+// for RemoveDoubles, so that triangles can be reindexed properly.
+template <typename number_t, typename index_t>
+struct CoordWithIndex {
+  number_t data[3];
+  index_t index;
+
+  bool operator == (const CoordWithIndex& c) const
+  {
+    return (c[0] == data[0]) && (c[1] == data[1]) && (c[2] == data[2]);
+  }
+
+  bool operator != (const CoordWithIndex& c) const
+  {
+    return (c[0] != data[0]) || (c[1] != data[1]) || (c[2] != data[2]);
+  }
+
+  bool operator < (const CoordWithIndex& c) const
+  {
+    return (data[0] < c[0])
+        || (data[0] == c[0] && data[1] < c[1])
+        || (data[0] == c[0] && data[1] == c[1] && data[2] < c[2]);
+  }
+
+  inline number_t& operator [] (const size_t i)   {return data[i];}
+  inline number_t operator [] (const size_t i) const  {return data[i];}
+};
+
+// sorts the array coordsWithIndexInOut and copies unique indices to coordsOut.
+// Triangle-corners are re-indexed on the fly and degenerated triangles are removed.
+template <class TNumberContainer1, class TNumberContainer2,
+          class TIndexContainer1, class TIndexContainer2>
+void RemoveDoubles (TNumberContainer1& uniqueCoordsOut,
+                    TIndexContainer1& trisInOut,
+                    TNumberContainer2& normalsInOut,
+                    TIndexContainer2& solidsInOut,
+                    std::vector <CoordWithIndex<
+                      typename TNumberContainer1::value_type,
+                      typename TIndexContainer1::value_type> >
+                      &coordsWithIndexInOut)
+{
+  using namespace std;
+
+  typedef typename TNumberContainer1::value_type number_t;
+  typedef typename TIndexContainer1::value_type  index_t;
+
+  // not part of the original code, which reads past the end of the empty array
+  if(coordsWithIndexInOut.empty()){
+    uniqueCoordsOut.clear();
+    return;
+  }
+
+  sort (coordsWithIndexInOut.begin(), coordsWithIndexInOut.end());
+
+//  first count unique indices
+  index_t numUnique = 1;
+  for(size_t i = 1; i < coordsWithIndexInOut.size(); ++i){
+    if(coordsWithIndexInOut[i] != coordsWithIndexInOut[i - 1])
+      ++numUnique;
+  }
+
+  uniqueCoordsOut.resize (numUnique * 3);
+  vector<index_t> newIndex (coordsWithIndexInOut.size());
+
+  TIndexContainer2 newSolids;
+
+//  copy unique coordinates to 'uniqueCoordsOut' and create an index-map
+//  'newIndex', which allows to re-index triangles later on.
+  index_t curInd = 0;
+  newIndex[coordsWithIndexInOut[0].index] = 0;
+  for(index_t i = 0; i < 3; ++i)
+    uniqueCoordsOut[i] = coordsWithIndexInOut[0][i];
+
+  for(size_t i = 1; i < coordsWithIndexInOut.size(); ++i){
+    const CoordWithIndex <number_t, index_t> c = coordsWithIndexInOut[i];
+    if(c != coordsWithIndexInOut[i - 1]){
+      ++curInd;
+      for(index_t j = 0; j < 3; ++j)
+        uniqueCoordsOut[curInd * 3 + j] = coordsWithIndexInOut[i][j];
+    }
+
+    newIndex[c.index] = static_cast<index_t> (curInd);
+  }
+
+//  re-index triangles, so that they refer to 'uniqueCoordsOut'
+//  make sure to only add triangles which refer to three different indices
+  index_t numUniqueTriInds = 0;
+  for(index_t i = 0; i < trisInOut.size(); i+=3){
+    
+    const index_t triInd = i / 3;
+    const index_t newTriInd = numUniqueTriInds / 3;
+    if (newSolids.size () < solidsInOut.size () &&
+        solidsInOut [newSolids.size ()] <= triInd)
+    {
+      newSolids.push_back (newTriInd);
+    }
+
+    index_t ni[3];
+    for(index_t j = 0; j < 3; ++j)
+      ni[j] = newIndex[trisInOut[i+j]];
+
+    if((ni[0] != ni[1]) && (ni[0] != ni[2]) && (ni[1] != ni[2])){
+      for(index_t j = 0; j < 3; ++j)
+      {
+        trisInOut[numUniqueTriInds + j] = ni[j];
+        normalsInOut[numUniqueTriInds + j] = normalsInOut [i + j];
+      }
+      numUniqueTriInds += 3;
+    }
+  }
+
+  if(numUniqueTriInds < trisInOut.size())
+  {
+    trisInOut.resize (numUniqueTriInds);
+    normalsInOut.resize (numUniqueTriInds);
+  }
+
+  if (!newSolids.empty ())
+    newSolids.push_back (numUniqueTriInds / 3);
+  
+  using std::swap;
+  swap (solidsInOut, newSolids);
+}
+
+
+template <class TNumberContainer1, class TNumberContainer2,
+          class TIndexContainer1, class TIndexContainer2>
+bool ReadStlFile_ASCII(const char* filename,
+                       TNumberContainer1& coordsOut,
+                       TNumberContainer2& normalsOut,
+                       TIndexContainer1& trisOut,
+                       TIndexContainer2& solidRangesOut)
+{
+  using namespace std;
+
+  typedef typename TNumberContainer1::value_type  number_t;
+  typedef typename TIndexContainer1::value_type index_t;
+
+  coordsOut.clear();
+  normalsOut.clear();
+  trisOut.clear();
+  solidRangesOut.clear();
+
+  ifstream in(filename);
+  STL_READER_REFERENCE_COND_THROW(!in, "Couldn't open file " << filename);
+
+  vector<CoordWithIndex <number_t, index_t> > coordsWithIndex;
+
+  string buffer;
+  vector<string> tokens;
+  int lineCount = 1;
+  int maxNumTokens = 0;
+  size_t numFaceVrts = 0;
+
+  while(!(in.eof() || in.fail()))
+  {
+  //  read the line and tokenize.
+  //  In order to reuse memory in between lines, 'tokens' won't be cleared.
+  //  Instead we count the number of tokens using 'tokenCount'.
+    getline(in, buffer);
+
+    istringstream line(buffer);
+    int tokenCount = 0;
+    while(!(line.eof() || line.fail())){
+      if(tokenCount >= maxNumTokens){
+        maxNumTokens = tokenCount + 1;
+        tokens.resize(maxNumTokens);
+      }
+      line >> tokens[tokenCount];
+      ++tokenCount;
+    }
+
+    if(tokenCount > 0)
+    {
+      string& tok = tokens[0];
+      if(tok.compare("vertex") == 0){
+        if(tokenCount < 4){
+          STL_READER_REFERENCE_THROW("ERROR while reading from " << filename <<
+            ": vertex not specified correctly in line " << lineCount);
+        }
+        
+      //  read the position
+        CoordWithIndex <number_t, index_t> c;
+        for(size_t i = 0; i < 3; ++i)
+          c[i] = static_cast<number_t> (atof(tokens[i+1].c_str()));
+        c.index = static_cast<index_t>(coordsWithIndex.size());
+        coordsWithIndex.push_back(c);
+        ++numFaceVrts;
+      }
+      else if(tok.compare("facet") == 0)
+      {
+        STL_READER_REFERENCE_COND_THROW(tokenCount < 5,
+          "ERROR while reading from " << filename <<
+          ": triangle not specified correctly in line " << lineCount);
+        
+        STL_READER_REFERENCE_COND_THROW(tokens[1].compare("normal") != 0,
+          "ERROR while reading from " << filename <<
+          ": Missing normal specifier in line " << lineCount);
+        
+      //  read the normal
+        for(size_t i = 0; i < 3; ++i)
+          normalsOut.push_back (static_cast<number_t> (atof(tokens[i+2].c_str())));
+
+        numFaceVrts = 0;
+      }
+      else if(tok.compare("outer") == 0){
+        STL_READER_REFERENCE_COND_THROW ((tokenCount < 2) || (tokens[1].compare("loop") != 0),
+          "ERROR while reading from " << filename <<
+          ": expecting outer loop in line " << lineCount);
+      }
+      else if(tok.compare("endfacet") == 0){
+        STL_READER_REFERENCE_COND_THROW(numFaceVrts != 3,
+          "ERROR while reading from " << filename <<
+          ": bad number of vertices specified for face in line " << lineCount);
+
+        trisOut.push_back(static_cast<index_t> (coordsWithIndex.size() - 3));
+        trisOut.push_back(static_cast<index_t> (coordsWithIndex.size() - 2));
+        trisOut.push_back(static_cast<index_t> (coordsWithIndex.size() - 1));
+      }
+      else if(tok.compare("solid") == 0){
+        solidRangesOut.push_back(static_cast<index_t> (trisOut.size() / 3));
+      }
+    }
+    lineCount++;
+  }
+
+  solidRangesOut.push_back(static_cast<index_t> (trisOut.size() / 3));
+
+  RemoveDoubles (coordsOut, trisOut, normalsOut, solidRangesOut, coordsWithIndex);
+
+  return true;
+}
+
+
+template <class TNumberContainer1, class TNumberContainer2,
+          class TIndexContainer1, class TIndexContainer2>
+bool ReadStlFile_BINARY(const char* filename,
+                        TNumberContainer1& coordsOut,
+                        TNumberContainer2& normalsOut,
+                        TIndexContainer1& trisOut,
+                        TIndexContainer2& solidRangesOut)
+{
+  using namespace std;
+
+  typedef typename TNumberContainer1::value_type  number_t;
+  typedef typename TIndexContainer1::value_type index_t;
+
+  coordsOut.clear();
+  normalsOut.clear();
+  trisOut.clear();
+  solidRangesOut.clear();
+
+  ifstream in(filename, ios::binary);
+  STL_READER_REFERENCE_COND_THROW(!in, "Couldnt open file " << filename);
+
+  char stl_header[80];
+  in.read(stl_header, 80);
+  STL_READER_REFERENCE_COND_THROW(!in, "Error while parsing binary stl header in file " << filename);
+
+  unsigned int numTris = 0;
+  in.read((char*)&numTris, 4);
+  STL_READER_REFERENCE_COND_THROW(!in, "Couldnt determine number of triangles in binary stl file " << filename);
+
+  vector<CoordWithIndex <number_t, index_t> > coordsWithIndex;
+
+  for(unsigned int tri = 0; tri < numTris; ++tri){
+    float d[12];
+    in.read((char*)d, 12 * 4);
+    STL_READER_REFERENCE_COND_THROW(!in, "Error while parsing trianlge in binary stl file " << filename);
+
+    for(int i = 0; i < 3; ++i)
+      normalsOut.push_back (d[i]);
+
+    for(size_t ivrt = 1; ivrt < 4; ++ivrt){
+      CoordWithIndex <number_t, index_t> c;
+      for(size_t i = 0; i < 3; ++i)
+        c[i] = d[ivrt * 3 + i];
+      c.index = static_cast<index_t>(coordsWithIndex.size());
+      coordsWithIndex.push_back(c);
+    }
+
+    trisOut.push_back(static_cast<index_t> (coordsWithIndex.size() - 3));
+    trisOut.push_back(static_cast<index_t> (coordsWithIndex.size() - 2));
+    trisOut.push_back(static_cast<index_t> (coordsWithIndex.size() - 1));
+
+    char addData[2];
+    in.read(addData, 2);
+    STL_READER_REFERENCE_COND_THROW(!in, "Error while parsing additional triangle data in binary stl file " << filename);
+  }
+
+  solidRangesOut.push_back(0);
+  solidRangesOut.push_back(static_cast<index_t> (trisOut.size() / 3));
+
+  RemoveDoubles (coordsOut, trisOut, normalsOut, solidRangesOut, coordsWithIndex);
+
+  return true;
+}
+
+
+inline bool StlFileHasASCIIFormat(const char* filename)
+{
+  using namespace std;
+  ifstream in(filename);
+  STL_READER_REFERENCE_COND_THROW(!in, "Couldnt open file " << filename);
+
+  char chars [256];
+  in.read (chars, 256);
+  string buffer (chars, in.gcount());
+  transform(buffer.begin(), buffer.end(), buffer.begin(), ::tolower);
+  return buffer.find ("solid") != string::npos &&
+         buffer.find ("\n") != string::npos &&
+         buffer.find ("facet") != string::npos &&
+         buffer.find ("normal") != string::npos;
+}
+
+
+template <class TNumberContainer1, class TNumberContainer2,
+          class TIndexContainer1, class TIndexContainer2>
+bool ReadStlFile(const char* filename,
+                 TNumberContainer1& coordsOut,
+                 TNumberContainer2& normalsOut,
+                 TIndexContainer1& trisOut,
+                 TIndexContainer2& solidRangesOut)
+{
+  if(StlFileHasASCIIFormat(filename))
+    return ReadStlFile_ASCII(filename, coordsOut, normalsOut, trisOut, solidRangesOut);
+  else
+    return ReadStlFile_BINARY(filename, coordsOut, normalsOut, trisOut, solidRangesOut);
+}
+
+#undef STL_READER_REFERENCE_COND_THROW
+#undef STL_READER_REFERENCE_THROW
+
+} // end of namespace stl_reader_reference
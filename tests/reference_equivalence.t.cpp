@@ -0,0 +1,156 @@
+#include "../stl_reader.h"
+#include "bench/mesh_generator.h"
+#include "reference/reference_compare.h"
+#include "reference/stl_reader_reference.h"
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+
+namespace
+{
+  // a shuffled mesh of random size with some degenerate and duplicate triangles
+  auto randomMesh (unsigned seed) -> GeneratedMesh
+  {
+    std::mt19937 gen (seed);
+    GeneratedMesh mesh = generateMesh (std::uniform_int_distribution<size_t> (1, 5000) (gen), seed, true);
+    size_t const numTris = mesh.numTris ();
+    std::uniform_int_distribution<size_t> randomTri (0, numTris - 1);
+    for (size_t i = 0; i < numTris / 50 + 1; ++i)
+    {
+      size_t const itri = randomTri (gen);
+      // collapse the triangle to its first corner or duplicate it
+      if (i % 2 == 0)
+        std::copy (&mesh.corners [9 * itri], &mesh.corners [9 * itri + 3], &mesh.corners [9 * itri + 3]);
+      else
+      {
+        mesh.corners.insert (mesh.corners.end (), mesh.corners.begin () + 9 * itri, mesh.corners.begin () + 9 * itri + 9);
+        mesh.normals.insert (mesh.normals.end (), mesh.normals.begin () + 3 * itri, mesh.normals.begin () + 3 * itri + 3);
+      }
+    }
+    return mesh;
+  }
+
+  template <class number_t, class index_t>
+  void expectReadsMatch (char const* filename)
+  {
+    MeshArrays<number_t, index_t> ref, cur;
+    stl_reader_reference::ReadStlFile (filename, ref.coords, ref.normals, ref.tris, ref.solids);
+    stl_reader::ReadStlFile (filename, cur.coords, cur.normals, cur.tris, cur.solids);
+    EXPECT_EQ (compareMeshes (ref, cur, CompareOrder::EXACT), "") << filename;
+  }
+}
+
+TEST (referenceEquivalence, randomFiles)
+{
+  char const* asciiFile = "reference_random_ascii.stl";
+  char const* binaryFile = "reference_random_binary.stl";
+  for (unsigned seed = 1; seed <= 8; ++seed)
+  {
+    GeneratedMesh const mesh = randomMesh (seed);
+    writeAsciiStl (asciiFile, mesh, seed % 4 + 1);
+    writeBinaryStl (binaryFile, mesh);
+    for (auto filename : {asciiFile, binaryFile, "data/ascii_sphere.stl", "data/binary_sphere.stl"})
+    {
+      expectReadsMatch<float, unsigned int> (filename);
+      expectReadsMatch<double, size_t> (filename);
+    }
+  }
+  std::remove (asciiFile);
+  std::remove (binaryFile);
+}
+
+TEST (referenceEquivalence, doubleRoundingDivergence)
+{
+  // 1 + 2^-24 is the midpoint between 1 and the next float. strtof rounds the
+  // literal up, atof rounds it to the midpoint and the cast to float rounds
+  // that to even, i.e. to 1.
+  char const* filename = "reference_double_rounding.stl";
+  {
+    std::ofstream out (filename);
+    out << "solid s\n  facet normal 0 0 1.00000005960464477539062500000001\n    outer loop\n"
+           "      vertex 0 0 0\n      vertex 1.00000005960464477539062500000001 0 0\n      vertex 0 1 0\n"
+           "    endloop\n  endfacet\nendsolid s\n";
+  }
+
+  MeshArrays<float, unsigned int> ref, cur;
+  stl_reader_reference::ReadStlFile (filename, ref.coords, ref.normals, ref.tris, ref.solids);
+  stl_reader::ReadStlFile (filename, cur.coords, cur.normals, cur.tris, cur.solids);
+  EXPECT_NE (compareMeshes (ref, cur, CompareOrder::EXACT), "");
+  EXPECT_EQ (compareMeshes (ref, cur, CompareOrder::EXACT, DOUBLE_ROUNDING), "");
+
+  expectReadsMatch<double, size_t> (filename);
+  std::remove (filename);
+}
+
+TEST (referenceEquivalence, blankLinesDivergence)
+{
+  char const* filename = "reference_blank_lines.stl";
+  char const* copyFilename = "reference_blank_lines_copy.stl";
+  {
+    std::ofstream out (filename);
+    out << "solid s\n  facet normal 0 0 1\n    outer loop\n"
+           "      vertex 0 0 0\n\n      vertex 1 0 0\n      vertex 0 1 0\n  \n"
+           "    endloop\n  endfacet\n\nendsolid s\n";
+  }
+
+  MeshArrays<float, unsigned int> ref, cur;
+  EXPECT_THROW (stl_reader_reference::ReadStlFile (filename, ref.coords, ref.normals, ref.tris, ref.solids),
+                std::runtime_error);
+
+  copyWithoutBlankLines (filename, copyFilename);
+  stl_reader_reference::ReadStlFile (copyFilename, ref.coords, ref.normals, ref.tris, ref.solids);
+  stl_reader::ReadStlFile (filename, cur.coords, cur.normals, cur.tris, cur.solids);
+  EXPECT_EQ (cur.tris.size (), 3u);
+  EXPECT_EQ (compareMeshes (ref, cur, CompareOrder::EXACT), "");
+  std::remove (filename);
+  std::remove (copyFilename);
+}
+
+TEST (referenceEquivalence, removeDoubles)
+{
+  std::mt19937 gen (3);
+  // coordinates from a small range, so that many corners coincide
+  std::uniform_int_distribution<int> coordinate (-3, 3);
+  for (size_t numTris : {1, 2, 10, 1000})
+  {
+    std::vector<stl_reader::stl_reader_impl::CoordWithIndex<float, unsigned int>> cur (3 * numTris);
+    std::vector<stl_reader_reference::CoordWithIndex<float, unsigned int>> ref (3 * numTris);
+    MeshArrays<float, unsigned int> refMesh, curMesh;
+    for (size_t i = 0; i < 3 * numTris; ++i)
+    {
+      for (int j = 0; j < 3; ++j)
+        cur [i][j] = ref [i][j] = 0.5f * coordinate (gen);
+      cur [i].index = ref [i].index = static_cast<unsigned int> (i);
+      refMesh.tris.push_back (static_cast<unsigned int> (i));
+      refMesh.normals.push_back (static_cast<float> (i));
+    }
+    refMesh.solids = {0, static_cast<unsigned int> (numTris / 2), static_cast<unsigned int> (numTris)};
+    curMesh = refMesh;
+
+    stl_reader_reference::RemoveDoubles (refMesh.coords, refMesh.tris, refMesh.normals, refMesh.solids, ref);
+    stl_reader::stl_reader_impl::RemoveDoubles (curMesh.coords, curMesh.tris, curMesh.normals, curMesh.solids, cur);
+    EXPECT_EQ (compareMeshes (refMesh, curMesh, CompareOrder::EXACT), "") << numTris;
+  }
+}
+
+TEST (referenceEquivalence, vertexOrderIndependentComparison)
+{
+  MeshArrays<float, unsigned int> ref;
+  stl_reader_reference::ReadStlFile ("data/ascii_sphere.stl", ref.coords, ref.normals, ref.tris, ref.solids);
+
+  // reverse the order of the vertices
+  MeshArrays<float, unsigned int> reordered = ref;
+  size_t const numVrts = ref.coords.size () / 3;
+  for (size_t i = 0; i < numVrts; ++i)
+    std::copy (&ref.coords [3 * i], &ref.coords [3 * i + 3], &reordered.coords [3 * (numVrts - 1 - i)]);
+  for (auto& ind : reordered.tris)
+    ind = static_cast<unsigned int> (numVrts - 1 - ind);
+
+  EXPECT_NE (compareMeshes (ref, reordered, CompareOrder::EXACT), "");
+  EXPECT_EQ (compareMeshes (ref, reordered, CompareOrder::VERTEX_ORDER_INDEPENDENT), "");
+
+  std::swap (reordered.tris [0], reordered.tris [1]);
+  EXPECT_NE (compareMeshes (ref, reordered, CompareOrder::VERTEX_ORDER_INDEPENDENT), "");
+}
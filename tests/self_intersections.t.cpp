@@ -0,0 +1,91 @@
+#include "../stl_reader.h"
+#include <gtest/gtest.h>
+
+namespace
+{
+  using std::vector;
+
+  vector<size_t> findPairs (vector<double> const& coords, vector<size_t> const& tris)
+  {
+    vector<size_t> pairs;
+    stl_reader::FindSelfIntersections (coords, tris, pairs);
+    return pairs;
+  }
+}
+
+TEST (selfIntersections, closedSphereHasNone)
+{
+  stl_reader::StlMesh<> mesh ("data/binary_sphere.stl");
+  vector<unsigned int> pairs;
+  mesh.self_intersections (pairs);
+  EXPECT_TRUE (pairs.empty ());
+}
+
+TEST (selfIntersections, crossingTriangles)
+{
+  vector<double> const coords {
+    0, 0, 0,   2, 0, 0,   0, 2, 0,
+    0.5, 0.5, -1,   0.5, 0.5, 1,   3, 3, 0,
+    10, 10, 10,   11, 10, 10,   10, 11, 10};
+  vector<size_t> const tris {0, 1, 2,   6, 7, 8,   3, 4, 5};
+
+  EXPECT_EQ (findPairs (coords, tris), (vector<size_t> {0, 2}));
+}
+
+TEST (selfIntersections, coplanarOverlap)
+{
+  vector<double> const coords {
+    0, 0, 0,   2, 0, 0,   0, 2, 0,
+    0.5, 0.5, 0,   3, 0.5, 0,   0.5, 3, 0};
+  EXPECT_EQ (findPairs (coords, {0, 1, 2, 3, 4, 5}), (vector<size_t> {0, 1}));
+}
+
+TEST (selfIntersections, coplanarDisjoint)
+{
+  vector<double> const coords {
+    0, 0, 0,   1, 0, 0,   0, 1, 0,
+    2, 2, 0,   3, 2, 0,   2, 3, 0};
+  EXPECT_TRUE (findPairs (coords, {0, 1, 2, 3, 4, 5}).empty ());
+}
+
+TEST (selfIntersections, skipsTrianglesSharingAVertex)
+{
+  vector<double> const coords {
+    0, 0, 0,   2, 0, 0,   0, 2, 0,
+    0.5, 0.5, 1,   0.5, 0.5, -1};
+  EXPECT_TRUE (findPairs (coords, {0, 1, 2, 0, 3, 4}).empty ());
+}
+
+TEST (selfIntersections, manyTrianglesMatchBruteForce)
+{
+  // a grid of small triangles pierced by a large triangle
+  vector<double> coords;
+  vector<size_t> tris;
+  for (int i = 0; i < 30; ++i)
+    for (int j = 0; j < 30; ++j)
+    {
+      size_t const first = coords.size () / 3;
+      coords.insert (coords.end (), {i + 0., j + 0., 0., i + 0.9, j + 0., 0., i + 0., j + 0.9, 0.});
+      tris.insert (tris.end (), {first, first + 1, first + 2});
+    }
+  size_t const first = coords.size () / 3;
+  coords.insert (coords.end (), {0.2, 0.2, -1., 0.2, 0.2, 1., 30.2, 0.25, 0.});
+  tris.insert (tris.end (), {first, first + 1, first + 2});
+
+  vector<size_t> bruteForcePairs;
+  for (size_t i = 0; i < tris.size () / 3; ++i)
+    for (size_t j = i + 1; j < tris.size () / 3; ++j)
+    {
+      double v [3][3], u [3][3];
+      stl_reader::stl_reader_impl::LoadTriCorners (coords, tris, i, v);
+      stl_reader::stl_reader_impl::LoadTriCorners (coords, tris, j, u);
+      double const* vp [3] = {v [0], v [1], v [2]};
+      double const* up [3] = {u [0], u [1], u [2]};
+      if (stl_reader::stl_reader_impl::TrisIntersect (vp, up))
+        bruteForcePairs.insert (bruteForcePairs.end (), {i, j});
+    }
+
+  auto const pairs = findPairs (coords, tris);
+  EXPECT_EQ (pairs.size (), 60);
+  EXPECT_EQ (pairs, bruteForcePairs);
+}
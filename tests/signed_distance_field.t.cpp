@@ -0,0 +1,88 @@
+#include "../stl_reader.h"
+#include <gtest/gtest.h>
+#include <limits>
+
+namespace
+{
+  using Mesh = stl_reader::StlMesh<double, unsigned int>;
+
+  // brute force signed distance to a closed convex mesh
+  double convexSignedDistance (Mesh const& mesh, double const* p)
+  {
+    double minDistSq = std::numeric_limits<double>::max ();
+    bool inside = true;
+    for (size_t iTri = 0; iTri < mesh.num_tris (); ++iTri)
+    {
+      double closest [3];
+      stl_reader::stl_reader_impl::ClosestPointOnTri (
+          p, mesh.tri_corner_coords (iTri, 0), mesh.tri_corner_coords (iTri, 1),
+          mesh.tri_corner_coords (iTri, 2), closest);
+      double const d [3] = {p [0] - closest [0], p [1] - closest [1], p [2] - closest [2]};
+      minDistSq = std::min (minDistSq, stl_reader::stl_reader_impl::Dot (d, d));
+
+      double const* c = mesh.tri_corner_coords (iTri, 0);
+      double const offset [3] = {p [0] - c [0], p [1] - c [1], p [2] - c [2]};
+      if (stl_reader::stl_reader_impl::Dot (offset, mesh.tri_normal (iTri)) > 0)
+        inside = false;
+    }
+    return inside ? -sqrt (minDistSq) : sqrt (minDistSq);
+  }
+
+  void samplePosition (stl_reader::SignedDistanceField<double> const& sdf,
+                       size_t i, size_t j, size_t k, double* p)
+  {
+    size_t const ind [3] = {i, j, k};
+    for (size_t d = 0; d < 3; ++d)
+      p [d] = sdf.origin () [d] + sdf.spacing () * ind [d];
+  }
+}
+
+TEST (signedDistanceField, denseFieldMatchesBruteForce)
+{
+  Mesh mesh ("data/binary_sphere.stl");
+  stl_reader::SignedDistanceField<double> sdf;
+  mesh.signed_distance_field (sdf, 0.15, std::numeric_limits<double>::infinity ());
+
+  EXPECT_EQ (sdf.num_allocated_blocks (), sdf.num_blocks ());
+  for (size_t k = 0; k < sdf.num_samples (2); ++k)
+    for (size_t j = 0; j < sdf.num_samples (1); ++j)
+      for (size_t i = 0; i < sdf.num_samples (0); ++i)
+      {
+        double p [3];
+        samplePosition (sdf, i, j, k, p);
+        ASSERT_NEAR (sdf.value (i, j, k), convexSignedDistance (mesh, p), 1.e-9);
+      }
+}
+
+TEST (signedDistanceField, narrowBand)
+{
+  Mesh mesh ("data/binary_sphere.stl");
+  stl_reader::SignedDistanceField<double> sdf;
+  double const band = 0.1;
+  mesh.signed_distance_field (sdf, 0.025, band, 1);
+
+  EXPECT_LT (sdf.num_allocated_blocks (), sdf.num_blocks ());
+  for (size_t k = 0; k < sdf.num_samples (2); k += 2)
+    for (size_t j = 0; j < sdf.num_samples (1); j += 2)
+      for (size_t i = 0; i < sdf.num_samples (0); i += 2)
+      {
+        double p [3];
+        samplePosition (sdf, i, j, k, p);
+        double const expected = std::max (-band, std::min (band, convexSignedDistance (mesh, p)));
+        ASSERT_NEAR (sdf.value (i, j, k), expected, 1.e-9);
+      }
+
+  EXPECT_DOUBLE_EQ (sdf.interpolate (0, 0, 0), -band);
+  EXPECT_DOUBLE_EQ (sdf.interpolate (1.2, 0, 0), band);
+}
+
+TEST (signedDistanceField, interpolation)
+{
+  Mesh mesh ("data/binary_sphere.stl");
+  stl_reader::SignedDistanceField<float> sdf;
+  mesh.signed_distance_field (sdf, 0.05, std::numeric_limits<double>::infinity ());
+
+  // the inradius of the icosahedron with circumradius 1
+  EXPECT_NEAR (sdf.interpolate (0, 0, 0), -0.7947, 0.05);
+  EXPECT_NEAR (sdf.interpolate (0, 0.934172 * 0.7947 * 0.9, 0.356822 * 0.7947 * 0.9), -0.1 * 0.7947, 0.01);
+}
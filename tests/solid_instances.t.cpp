@@ -0,0 +1,247 @@
+#include "../stl_reader.h"
+#include <gtest/gtest.h>
+#include <array>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+  using Mesh = stl_reader::StlMesh <float, unsigned int>;
+  using Point = std::array<double, 3>;
+  using Tri = std::array<unsigned int, 3>;
+
+  struct Part
+  {
+    std::vector<Point> points;
+    std::vector<Tri> tris;
+  };
+
+  // an irregular pyramid without symmetries
+  auto pyramid () -> Part
+  {
+    return Part {{{0, 0, 0}, {3, 0, 0.2}, {2.5, 1.7, 0}, {0.3, 1.1, -0.1}, {1.2, 0.6, 2.1}},
+                 {{0, 2, 1}, {0, 3, 2}, {0, 1, 4}, {1, 2, 4}, {2, 3, 4}, {3, 0, 4}}};
+  }
+
+  // all principal moments of a cube coincide
+  auto cube () -> Part
+  {
+    Part part;
+    for (int i = 0; i < 8; ++i)
+      part.points.push_back ({double (i & 1), double ((i >> 1) & 1), double ((i >> 2) & 1)});
+    part.tris = {{0, 2, 1}, {1, 2, 3}, {4, 5, 6}, {5, 7, 6}, {0, 1, 4}, {1, 5, 4},
+                 {2, 6, 3}, {3, 6, 7}, {0, 4, 2}, {2, 4, 6}, {1, 3, 5}, {3, 7, 5}};
+    return part;
+  }
+
+  // a hexagonal prism, like the head of a bolt
+  auto hexPrism () -> Part
+  {
+    Part part;
+    double const pi = 3.14159265358979323846;
+    for (int z = 0; z < 2; ++z)
+      for (int i = 0; i < 6; ++i)
+        part.points.push_back ({cos (i * pi / 3), sin (i * pi / 3), 0.4 * z});
+    for (unsigned int i = 1; i + 1 < 6; ++i)
+    {
+      part.tris.push_back ({0, i + 1, i});
+      part.tris.push_back ({6, 6 + i, 7 + i});
+    }
+    for (unsigned int i = 0; i < 6; ++i)
+    {
+      unsigned int const j = (i + 1) % 6;
+      part.tris.push_back ({i, j, 6 + j});
+      part.tris.push_back ({i, 6 + j, 6 + i});
+    }
+    return part;
+  }
+
+  // rotation by 'angle' around the normalized 'axis'
+  auto rotation (Point axis, double const angle) -> stl_reader::SolidInstance
+  {
+    double const len = sqrt (axis [0] * axis [0] + axis [1] * axis [1] + axis [2] * axis [2]);
+    for (auto& a : axis)
+      a /= len;
+    double const c = cos (angle), s = sin (angle);
+    double const x = axis [0], y = axis [1], z = axis [2];
+    stl_reader::SolidInstance t = {0, {{c + x * x * (1 - c), x * y * (1 - c) - z * s, x * z * (1 - c) + y * s},
+                                       {y * x * (1 - c) + z * s, c + y * y * (1 - c), y * z * (1 - c) - x * s},
+                                       {z * x * (1 - c) - y * s, z * y * (1 - c) + x * s, c + z * z * (1 - c)}},
+                                   {0, 0, 0}};
+    return t;
+  }
+
+  struct Assembly
+  {
+    std::vector<float> coords, normals;
+    std::vector<unsigned int> tris, solids {0};
+
+    // appends 'part', scaled and transformed by 't', as a new solid
+    void add (Part const& part, stl_reader::SolidInstance const& t, Point const& scale = {1, 1, 1})
+    {
+      unsigned int const offset = static_cast<unsigned int> (coords.size () / 3);
+      for (auto const& p : part.points)
+      {
+        double const scaled [3] = {p [0] * scale [0], p [1] * scale [1], p [2] * scale [2]};
+        double q [3];
+        t.transform (scaled, q);
+        coords.insert (coords.end (), {float (q [0]), float (q [1]), float (q [2])});
+      }
+      for (auto const& tri : part.tris)
+      {
+        tris.insert (tris.end (), {tri [0] + offset, tri [1] + offset, tri [2] + offset});
+        normals.insert (normals.end (), {0, 0, 0});
+      }
+      solids.push_back (static_cast<unsigned int> (tris.size () / 3));
+    }
+  };
+
+  auto translated (stl_reader::SolidInstance t, double x, double y, double z) -> stl_reader::SolidInstance
+  {
+    t.translation [0] = x;
+    t.translation [1] = y;
+    t.translation [2] = z;
+    return t;
+  }
+
+  auto identity () -> stl_reader::SolidInstance
+  {
+    return rotation ({0, 0, 1}, 0);
+  }
+
+  auto buildAssembly () -> Assembly
+  {
+    Assembly assembly;
+    assembly.add (pyramid (), identity ());                                                   // 0
+    assembly.add (cube (), translated (identity (), 10, 0, 0));                               // 1
+    assembly.add (pyramid (), translated (rotation ({1, 2, 3}, 0.7), 5, -3, 12));             // 2
+    assembly.add (hexPrism (), translated (rotation ({0, 1, 0}, 1.1), -4, 4, 4));             // 3
+    assembly.add (cube (), translated (rotation ({0, 0, 1}, 0.5 * 3.14159265358979), 7, 7, 7)); // 4
+    assembly.add (pyramid (), translated (identity (), 0, 0, 20), {1, -1, 1});                // 5, mirrored
+    assembly.add (hexPrism (), translated (rotation ({-2, 1, 0.5}, 2.9), 100, 50, -20));      // 6
+    assembly.add (cube (), translated (rotation ({1, 1, 0}, 0.3), -9, 2, 1));                 // 7
+    assembly.add (pyramid (), translated (identity (), 30, 0, 0), {1.5, 1.5, 1.5});           // 8, scaled
+    assembly.add (pyramid (), translated (rotation ({0.2, -1, 0.4}, 4.0), -30, 1, 2));        // 9
+    return assembly;
+  }
+
+  // checks that the transformed vertices of the prototype match those of the solid
+  void expectInstanceMatches (Mesh const& protoMesh, size_t const protoSolid,
+                              Mesh const& mesh, size_t const solid,
+                              stl_reader::SolidInstance const& instance)
+  {
+    ASSERT_EQ (protoMesh.solid_tris_end (protoSolid) - protoMesh.solid_tris_begin (protoSolid),
+               mesh.solid_tris_end (solid) - mesh.solid_tris_begin (solid));
+    for (size_t i = protoMesh.solid_tris_begin (protoSolid); i < protoMesh.solid_tris_end (protoSolid); ++i)
+    {
+      for (size_t icorner = 0; icorner < 3; ++icorner)
+      {
+        float const* c = protoMesh.tri_corner_coords (i, icorner);
+        double const p [3] = {c [0], c [1], c [2]};
+        double q [3];
+        instance.transform (p, q);
+
+        double minDist = std::numeric_limits<double>::max ();
+        for (size_t j = mesh.solid_tris_begin (solid); j < mesh.solid_tris_end (solid); ++j)
+        {
+          for (size_t jcorner = 0; jcorner < 3; ++jcorner)
+          {
+            float const* d = mesh.tri_corner_coords (j, jcorner);
+            minDist = std::min (minDist, std::max ({fabs (d [0] - q [0]), fabs (d [1] - q [1]),
+                                                    fabs (d [2] - q [2])}));
+          }
+        }
+        EXPECT_LE (minDist, 1.e-3) << "solid " << solid;
+      }
+    }
+
+    double det = 0;
+    auto const& r = instance.rotation;
+    det = r [0][0] * (r [1][1] * r [2][2] - r [1][2] * r [2][1])
+        - r [0][1] * (r [1][0] * r [2][2] - r [1][2] * r [2][0])
+        + r [0][2] * (r [1][0] * r [2][1] - r [1][1] * r [2][0]);
+    EXPECT_NEAR (det, 1, 1.e-6);
+  }
+}
+
+TEST (solidInstances, findsRigidCopies)
+{
+  Assembly assembly = buildAssembly ();
+  std::vector<stl_reader::SolidInstance> instances;
+  size_t const numPrototypes = stl_reader::FindSolidInstances (
+      assembly.coords, assembly.tris, assembly.solids, instances);
+
+  std::vector<size_t> const expected {0, 1, 0, 3, 1, 5, 3, 1, 8, 0};
+  ASSERT_EQ (instances.size (), expected.size ());
+  EXPECT_EQ (numPrototypes, 5u);
+  for (size_t i = 0; i < expected.size (); ++i)
+    EXPECT_EQ (instances [i].prototype, expected [i]) << "solid " << i;
+
+  Mesh const mesh (assembly.coords, assembly.normals, assembly.tris, assembly.solids);
+  for (size_t i = 0; i < instances.size (); ++i)
+    expectInstanceMatches (mesh, instances [i].prototype, mesh, i, instances [i]);
+}
+
+TEST (solidInstances, concurrentAndSerialAgree)
+{
+  Assembly assembly = buildAssembly ();
+  Mesh const mesh (assembly.coords, assembly.normals, assembly.tris, assembly.solids);
+  auto const serial = mesh.solid_instances (0, 1);
+  auto const concurrent = mesh.solid_instances (0, 4);
+  ASSERT_EQ (serial.size (), concurrent.size ());
+  for (size_t i = 0; i < serial.size (); ++i)
+  {
+    EXPECT_EQ (serial [i].prototype, concurrent [i].prototype);
+    for (size_t d = 0; d < 3; ++d)
+      EXPECT_EQ (serial [i].translation [d], concurrent [i].translation [d]);
+  }
+}
+
+TEST (solidInstances, toleranceRejectsDeviations)
+{
+  Assembly assembly;
+  assembly.add (pyramid (), identity ());
+  assembly.add (pyramid (), translated (identity (), 5, 0, 0), {1, 1, 1.01});
+
+  std::vector<stl_reader::SolidInstance> instances;
+  EXPECT_EQ (stl_reader::FindSolidInstances (assembly.coords, assembly.tris, assembly.solids,
+                                             instances), 2u);
+  EXPECT_EQ (stl_reader::FindSolidInstances (assembly.coords, assembly.tris, assembly.solids,
+                                             instances, 0.05), 1u);
+  EXPECT_EQ (instances [1].prototype, 0u);
+}
+
+TEST (solidInstances, instanceSolids)
+{
+  Assembly assembly = buildAssembly ();
+  Mesh const mesh (assembly.coords, assembly.normals, assembly.tris, assembly.solids);
+
+  Mesh prototypes;
+  std::vector<stl_reader::SolidInstance> instances;
+  mesh.instance_solids (prototypes, instances);
+
+  ASSERT_EQ (prototypes.num_solids (), 5u);
+  ASSERT_EQ (instances.size (), mesh.num_solids ());
+  EXPECT_EQ (prototypes.num_tris (), 2 * pyramid ().tris.size () + cube ().tris.size ()
+                                     + hexPrism ().tris.size () + pyramid ().tris.size ());
+  EXPECT_EQ (prototypes.num_vrts (), 3 * pyramid ().points.size () + cube ().points.size ()
+                                     + hexPrism ().points.size ());
+  EXPECT_LT (prototypes.num_tris (), mesh.num_tris ());
+
+  std::vector<size_t> const expected {0, 1, 0, 2, 1, 3, 2, 1, 4, 0};
+  for (size_t i = 0; i < instances.size (); ++i)
+  {
+    EXPECT_EQ (instances [i].prototype, expected [i]) << "solid " << i;
+    expectInstanceMatches (prototypes, instances [i].prototype, mesh, i, instances [i]);
+  }
+}
+
+TEST (solidInstances, singleSolid)
+{
+  Mesh const mesh ("data/binary_sphere.stl");
+  auto const instances = mesh.solid_instances ();
+  ASSERT_EQ (instances.size (), 1u);
+  EXPECT_EQ (instances [0].prototype, 0u);
+  EXPECT_EQ (instances [0].rotation [1][1], 1);
+  EXPECT_EQ (instances [0].translation [2], 0);
+}
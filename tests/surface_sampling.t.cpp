@@ -0,0 +1,92 @@
+#include "../stl_reader.h"
+#include <gtest/gtest.h>
+
+namespace
+{
+  using std::vector;
+  using Mesh = stl_reader::StlMesh<double, unsigned int>;
+}
+
+TEST (surfaceSampling, samplesLieOnTheirTriangles)
+{
+  Mesh mesh ("data/binary_sphere.stl");
+  auto const sampler = mesh.surface_sampler ();
+
+  // an icosahedron with circumradius 1 has edge length 1.0515
+  EXPECT_NEAR (sampler.area (), 5 * sqrt (3.) * 1.0515 * 1.0515, 1.e-3);
+
+  stl_reader::SurfaceSamples<double> samples;
+  sampler.sample (1000, 42, samples);
+  ASSERT_EQ (samples.size (), 1000);
+  ASSERT_EQ (samples.nz.size (), 1000);
+  for (size_t i = 0; i < samples.size (); ++i)
+  {
+    size_t const iTri = samples.tris [i];
+    double const p [3] = {samples.x [i], samples.y [i], samples.z [i]};
+    double closest [3];
+    stl_reader::stl_reader_impl::ClosestPointOnTri (
+        p, mesh.tri_corner_coords (iTri, 0), mesh.tri_corner_coords (iTri, 1),
+        mesh.tri_corner_coords (iTri, 2), closest);
+    for (size_t d = 0; d < 3; ++d)
+      ASSERT_NEAR (p [d], closest [d], 1.e-12);
+
+    EXPECT_NEAR (samples.nx [i], mesh.tri_normal (iTri) [0], 1.e-5);
+    EXPECT_NEAR (samples.ny [i], mesh.tri_normal (iTri) [1], 1.e-5);
+    EXPECT_NEAR (samples.nz [i], mesh.tri_normal (iTri) [2], 1.e-5);
+  }
+}
+
+TEST (surfaceSampling, reproducibleIndependentOfThreadsAndRanges)
+{
+  Mesh mesh ("data/binary_sphere.stl");
+  auto const sampler = mesh.surface_sampler ();
+
+  stl_reader::SurfaceSamples<float> serial, parallel, part;
+  sampler.sample (10000, 7, serial, 1);
+  sampler.sample (10000, 7, parallel, 4);
+  sampler.sample (2500, 5000, 7, part);
+
+  EXPECT_EQ (serial.x, parallel.x);
+  EXPECT_EQ (serial.tris, parallel.tris);
+  EXPECT_EQ (vector<float> (serial.y.begin () + 2500, serial.y.begin () + 7500), part.y);
+
+  stl_reader::SurfaceSamples<float> otherSeed;
+  sampler.sample (10000, 8, otherSeed);
+  EXPECT_NE (serial.x, otherSeed.x);
+}
+
+TEST (surfaceSampling, areaWeighted)
+{
+  vector<double> const coords {0, 0, 0,  1, 0, 0,  0, 1, 0,   5, 0, 0,  8, 0, 0,  5, 1, 0};
+  vector<unsigned int> const tris {0, 1, 2,  3, 4, 5};
+  stl_reader::SurfaceSampler<vector<double>, vector<unsigned int>> sampler (coords, tris);
+  EXPECT_DOUBLE_EQ (sampler.area (), 2);
+
+  stl_reader::SurfaceSamples<double> samples;
+  sampler.sample (100000, 1, samples);
+  size_t numInSecond = 0;
+  for (auto const t : samples.tris)
+    numInSecond += t;
+  EXPECT_NEAR (numInSecond / 100000., 0.75, 0.01);
+}
+
+TEST (surfaceSampling, poissonDisk)
+{
+  Mesh mesh ("data/binary_sphere.stl");
+  auto const sampler = mesh.surface_sampler ();
+  double const radius = 0.2;
+
+  stl_reader::SurfaceSamples<double> samples;
+  sampler.sample_poisson_disk (radius, 3, samples);
+
+  // disks of the given radius around a maximal set of samples cover the surface
+  EXPECT_GT (samples.size (), sampler.area () / (M_PI * radius * radius));
+  for (size_t i = 0; i < samples.size (); ++i)
+    for (size_t j = i + 1; j < samples.size (); ++j)
+    {
+      double const dx = samples.x [i] - samples.x [j];
+      double const dy = samples.y [i] - samples.y [j];
+      double const dz = samples.z [i] - samples.z [j];
+      ASSERT_GE (dx * dx + dy * dy + dz * dz, radius * radius);
+    }
+}
@@ -0,0 +1,128 @@
+#include "../stl_reader.h"
+#include <gtest/gtest.h>
+#include <cmath>
+
+namespace
+{
+  using Mesh = stl_reader::StlMesh <float, unsigned int>;
+
+  // options for a view from above with y pointing upwards in the image
+  auto topView (size_t const size) -> stl_reader::ThumbnailOptions
+  {
+    stl_reader::ThumbnailOptions options;
+    options.width = options.height = size;
+    options.viewDir [0] = 0;
+    options.viewDir [1] = 0;
+    options.viewDir [2] = -1;
+    options.up [0] = 0;
+    options.up [1] = 1;
+    options.up [2] = 0;
+    options.margin = 0;
+    options.tileSize = 8;
+    return options;
+  }
+
+  // two squares [0, 1]^2 at heights 0 and 1, each split into two triangles
+  auto twoSquares () -> Mesh
+  {
+    std::vector<float> coords {0, 0, 0,  1, 0, 0,  1, 1, 0,  0, 1, 0,
+                               0, 0, 1,  1, 0, 1,  1, 1, 1,  0, 1, 1};
+    std::vector<float> normals (12, 0);
+    std::vector<unsigned int> tris {0, 1, 2,  0, 2, 3,  4, 6, 5,  4, 7, 6};
+    std::vector<unsigned int> solids;
+    return Mesh (coords, normals, tris, solids);
+  }
+}
+
+TEST (thumbnail, coversImageWithoutCracks)
+{
+  Mesh const mesh = twoSquares ();
+  stl_reader::Thumbnail const image = mesh.thumbnail (topView (37));
+  ASSERT_EQ (image.width, 37u);
+  ASSERT_EQ (image.height, 37u);
+  ASSERT_EQ (image.rgb.size (), 37u * 37u * 3);
+
+  for (size_t y = 0; y < image.height; ++y)
+  {
+    for (size_t x = 0; x < image.width; ++x)
+    {
+      ASSERT_TRUE (image.covered (x, y)) << x << ", " << y;
+      size_t const pixel = y * image.width + x;
+      // the upper square is nearest, its normal is turned towards the camera
+      EXPECT_EQ (image.depth [pixel], 0.f);
+      EXPECT_FLOAT_EQ (image.normals [pixel * 3 + 2], 1.f);
+      for (size_t d = 0; d < 3; ++d)
+        EXPECT_EQ (image.rgb [pixel * 3 + d], image.rgb [d]);
+    }
+  }
+}
+
+TEST (thumbnail, depthOrder)
+{
+  Mesh const mesh = twoSquares ();
+  stl_reader::ThumbnailOptions options = topView (16);
+  options.viewDir [2] = 1;
+  options.up [1] = -1;
+  stl_reader::Thumbnail const image = mesh.thumbnail (options);
+
+  // seen from below, the lower square is visible
+  for (size_t i = 0; i < 16 * 16; ++i)
+  {
+    EXPECT_EQ (image.depth [i], 0.f);
+    EXPECT_FLOAT_EQ (image.normals [i * 3 + 2], 1.f);
+  }
+}
+
+TEST (thumbnail, sphere)
+{
+  Mesh const mesh ("data/binary_sphere.stl");
+  stl_reader::ThumbnailOptions options;
+  options.width = 64;
+  options.height = 48;
+  stl_reader::Thumbnail const image = mesh.thumbnail (options);
+
+  EXPECT_TRUE (image.covered (32, 24));
+  EXPECT_GT (image.normals [(24 * 64 + 32) * 3 + 2], 0.5f);
+  EXPECT_LT (image.depth [24 * 64 + 32], 0.5f);
+  for (size_t corner : {size_t (0), size_t (63), size_t (47 * 64), size_t (48 * 64 - 1)})
+  {
+    EXPECT_FALSE (image.covered (corner % 64, corner / 64));
+    EXPECT_EQ (image.rgb [corner * 3], options.background [0]);
+    EXPECT_EQ (image.normals [corner * 3 + 2], 0.f);
+  }
+
+  size_t numCovered = 0;
+  for (size_t y = 0; y < image.height; ++y)
+    for (size_t x = 0; x < image.width; ++x)
+      numCovered += image.covered (x, y) ? 1 : 0;
+  // the sphere fits into the 48 pixels high image minus its margins
+  double const radius = 0.5 * 48 * (1 - 2 * options.margin);
+  EXPECT_GT (numCovered, 0.6 * 3.14159 * radius * radius);
+  EXPECT_LT (numCovered, 1.1 * 3.14159 * radius * radius);
+}
+
+TEST (thumbnail, independentOfThreads)
+{
+  Mesh const mesh ("data/ascii_sphere.stl");
+  stl_reader::ThumbnailOptions options;
+  options.width = 100;
+  options.height = 70;
+  options.tileSize = 16;
+  stl_reader::Thumbnail const serial = mesh.thumbnail (options, 1);
+  stl_reader::Thumbnail const concurrent = mesh.thumbnail (options, 4);
+  EXPECT_EQ (serial.rgb, concurrent.rgb);
+  EXPECT_EQ (serial.depth, concurrent.depth);
+  EXPECT_EQ (serial.normals, concurrent.normals);
+}
+
+TEST (thumbnail, emptyMesh)
+{
+  Mesh const mesh;
+  stl_reader::Thumbnail const image = mesh.thumbnail ();
+  ASSERT_EQ (image.rgb.size (), 128u * 128u * 3);
+  for (size_t y = 0; y < image.height; ++y)
+    for (size_t x = 0; x < image.width; ++x)
+      EXPECT_FALSE (image.covered (x, y));
+  for (unsigned char c : image.rgb)
+    EXPECT_EQ (c, 255);
+}
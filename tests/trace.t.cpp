@@ -0,0 +1,135 @@
+#include "../stl_reader.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <sstream>
+#include <thread>
+
+namespace
+{
+  // installs a sink for the lifetime of the object
+  struct ScopedSink
+  {
+    ScopedSink () {stl_reader::SetTraceSink (&sink);}
+    ~ScopedSink () {stl_reader::SetTraceSink (nullptr);}
+    stl_reader::TraceSink sink;
+  };
+
+  // the thread ids of all events named 'name', in the order of the events
+  std::vector<std::string> eventThreads (std::string const& json, std::string const& name)
+  {
+    std::string const key = "\"name\":\"" + name + "\"";
+    std::vector<std::string> threads;
+    for (size_t pos = json.find (key); pos != std::string::npos; pos = json.find (key, pos + 1))
+    {
+      size_t const tid = json.find ("\"tid\":", pos) + 6;
+      threads.push_back (json.substr (tid, json.find ('}', tid) - tid));
+    }
+    return threads;
+  }
+
+  // Each call waits until a call from another thread has started, so that
+  // ParallelFor has to run both work items concurrently. Gives up after a few
+  // seconds instead of hanging if it does not.
+  struct BlockUntilTwoThreads
+  {
+    std::atomic<int> numStarted {0};
+    std::atomic<bool> metOtherThread {false};
+
+    void operator () (size_t, size_t)
+    {
+      ++numStarted;
+      auto const deadline = std::chrono::steady_clock::now () + std::chrono::seconds (5);
+      while (numStarted < 2 && std::chrono::steady_clock::now () < deadline)
+        std::this_thread::yield ();
+      if (numStarted >= 2)
+        metOtherThread = true;
+    }
+  };
+
+  size_t countEvents (std::string const& json, std::string const& name)
+  {
+    std::string const key = "\"name\":\"" + name + "\"";
+    size_t count = 0;
+    for (size_t pos = json.find (key); pos != std::string::npos; pos = json.find (key, pos + 1))
+      ++count;
+    return count;
+  }
+}
+
+TEST (trace, recordsLoadPhases)
+{
+  std::string json;
+  {
+    ScopedSink scoped;
+    stl_reader::StlMesh <float, unsigned int> const binary ("data/binary_sphere.stl");
+    stl_reader::StlMesh <float, unsigned int> const ascii ("data/ascii_sphere.stl");
+    std::ostringstream out;
+    scoped.sink.write_chrome_trace (out);
+    json = out.str ();
+  }
+
+  EXPECT_EQ (json.find ("{\"traceEvents\":["), 0u);
+  EXPECT_EQ (countEvents (json, "detect"), 2u);
+  EXPECT_EQ (countEvents (json, "open"), 2u);
+  EXPECT_EQ (countEvents (json, "chunk read"), 1u);
+  EXPECT_EQ (countEvents (json, "parse"), 2u);
+  EXPECT_EQ (countEvents (json, "weld"), 2u);
+  EXPECT_EQ (countEvents (json, "reindex"), 2u);
+  EXPECT_NE (json.find ("\"ph\":\"X\""), std::string::npos);
+}
+
+TEST (trace, recordsWorkItemsPerThread)
+{
+  std::string json;
+  {
+    ScopedSink scoped;
+    BlockUntilTwoThreads func;
+    stl_reader::stl_reader_impl::ParallelFor (2, 1, func, 2);
+    EXPECT_TRUE (func.metOtherThread);
+    std::ostringstream out;
+    scoped.sink.write_chrome_trace (out);
+    json = out.str ();
+
+    scoped.sink.clear ();
+    EXPECT_EQ (scoped.sink.num_events (), 0u);
+  }
+
+  std::vector<std::string> const threads = eventThreads (json, "work item");
+  ASSERT_EQ (threads.size (), 2u);
+  EXPECT_NE (threads [0], threads [1]);
+}
+
+TEST (trace, recordsWorkItemsOfMeshFunctions)
+{
+  stl_reader::StlMesh <float, unsigned int> const mesh ("data/binary_sphere.stl");
+  ScopedSink scoped;
+  std::vector<unsigned int> pairs;
+  mesh.self_intersections (pairs, 2);
+  std::ostringstream out;
+  scoped.sink.write_chrome_trace (out);
+  EXPECT_GE (countEvents (out.str (), "work item"), 1u);
+}
+
+TEST (trace, noEventsWithoutSink)
+{
+  stl_reader::TraceSink sink;
+  stl_reader::SetTraceSink (&sink);
+  stl_reader::SetTraceSink (nullptr);
+  stl_reader::StlMesh <float, unsigned int> const mesh ("data/binary_sphere.stl");
+  std::vector<unsigned int> pairs;
+  mesh.self_intersections (pairs, 2);
+  EXPECT_EQ (sink.num_events (), 0u);
+}
+
+TEST (trace, totalDuration)
+{
+  stl_reader::TraceSink sink;
+  auto const t0 = std::chrono::steady_clock::now ();
+  sink.add_event ("parse", t0, t0 + std::chrono::microseconds (30));
+  sink.add_event ("weld", t0, t0 + std::chrono::microseconds (5));
+  sink.add_event ("parse", t0, t0 + std::chrono::microseconds (12));
+  EXPECT_EQ (sink.total_duration ("parse"), 42);
+  EXPECT_EQ (sink.total_duration ("weld"), 5);
+  EXPECT_EQ (sink.total_duration ("open"), 0);
+}
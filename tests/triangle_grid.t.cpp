@@ -0,0 +1,193 @@
+#include "../stl_reader.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <limits>
+#include <random>
+
+namespace
+{
+  using std::vector;
+
+  // a square [0, n] x [0, n] in the plane z = 0, split into 2 * n * n triangles
+  void createPlane (int n, vector<double>& coords, vector<size_t>& tris)
+  {
+    for (int j = 0; j <= n; ++j)
+      for (int i = 0; i <= n; ++i)
+      {
+        coords.push_back (i);
+        coords.push_back (j);
+        coords.push_back (0);
+      }
+
+    for (int j = 0; j < n; ++j)
+      for (int i = 0; i < n; ++i)
+      {
+        size_t const v = j * (n + 1) + i;
+        size_t const quad [6] = {v, v + 1, v + n + 2, v, v + n + 2, v + n + 1};
+        tris.insert (tris.end (), quad, quad + 6);
+      }
+  }
+
+  bool boxesOverlap (stl_reader::StlMesh <double, size_t> const& mesh, size_t itri,
+                     double const* lo, double const* hi)
+  {
+    for (int d = 0; d < 3; ++d)
+    {
+      double tLo = mesh.tri_corner_coords (itri, 0) [d], tHi = tLo;
+      for (int i = 1; i < 3; ++i)
+      {
+        tLo = std::min (tLo, mesh.tri_corner_coords (itri, i) [d]);
+        tHi = std::max (tHi, mesh.tri_corner_coords (itri, i) [d]);
+      }
+      if (tLo > hi [d] || tHi < lo [d])
+        return false;
+    }
+    return true;
+  }
+}
+
+TEST (triangleGrid, everyTriangleIsInItsCells)
+{
+  stl_reader::StlMesh <double, size_t> mesh ("data/binary_sphere.stl");
+  auto const grid = mesh.triangle_grid ();
+  EXPECT_GT (grid.num_cells (0) * grid.num_cells (1) * grid.num_cells (2), 1u);
+
+  vector<size_t> numEntries (mesh.num_tris (), 0);
+  for (size_t k = 0; k < grid.num_cells (2); ++k)
+    for (size_t j = 0; j < grid.num_cells (1); ++j)
+      for (size_t i = 0; i < grid.num_cells (0); ++i)
+        for (auto t = grid.cell_tris_begin (i, j, k); t != grid.cell_tris_end (i, j, k); ++t)
+        {
+          ASSERT_LT (*t, mesh.num_tris ());
+          ++numEntries [*t];
+        }
+
+  for (size_t n : numEntries)
+    EXPECT_GT (n, 0u);
+}
+
+TEST (triangleGrid, cellListsDoNotDependOnThreads)
+{
+  vector<double> coords;
+  vector<size_t> tris;
+  createPlane (100, coords, tris);
+  typedef stl_reader::TriangleGrid <vector<double>, vector<size_t> > grid_t;
+  grid_t const serial (coords, tris, 0.7, 1);
+  grid_t const parallel (coords, tris, 0.7, 4);
+
+  for (size_t k = 0; k < serial.num_cells (2); ++k)
+    for (size_t j = 0; j < serial.num_cells (1); ++j)
+      for (size_t i = 0; i < serial.num_cells (0); ++i)
+      {
+        vector<size_t> const expected (serial.cell_tris_begin (i, j, k), serial.cell_tris_end (i, j, k));
+        vector<size_t> const found (parallel.cell_tris_begin (i, j, k), parallel.cell_tris_end (i, j, k));
+        EXPECT_TRUE (std::is_sorted (expected.begin (), expected.end ()));
+        EXPECT_EQ (found, expected);
+      }
+}
+
+TEST (triangleGrid, queryBoxMatchesBruteForce)
+{
+  stl_reader::StlMesh <double, size_t> mesh ("data/binary_sphere.stl");
+  auto const grid = mesh.triangle_grid (0.3);
+
+  std::mt19937 gen (3);
+  std::uniform_real_distribution<double> dist (-1.2, 1.2);
+  vector<size_t> found;
+  for (int iquery = 0; iquery < 100; ++iquery)
+  {
+    double lo [3], hi [3];
+    for (int d = 0; d < 3; ++d)
+    {
+      double const a = dist (gen), b = dist (gen);
+      lo [d] = std::min (a, b);
+      hi [d] = std::max (a, b);
+    }
+
+    vector<size_t> expected;
+    for (size_t itri = 0; itri < mesh.num_tris (); ++itri)
+      if (boxesOverlap (mesh, itri, lo, hi))
+        expected.push_back (itri);
+
+    grid.query_box (lo, hi, found);
+    EXPECT_EQ (found, expected);
+  }
+}
+
+TEST (triangleGrid, rayHitsPlane)
+{
+  vector<double> coords;
+  vector<size_t> tris;
+  createPlane (20, coords, tris);
+  stl_reader::TriangleGrid <vector<double>, vector<size_t> > const grid (coords, tris);
+  EXPECT_EQ (grid.num_cells (2), 1u);
+
+  double const origin [3] = {3.25, 7.75, 5};
+  double const dir [3] = {0, 0, -1};
+  size_t tri = 0;
+  double t = 0;
+  ASSERT_TRUE (grid.intersect_ray (origin, dir, 100, tri, t));
+  EXPECT_DOUBLE_EQ (t, 5);
+  EXPECT_EQ (tri, 2u * (7 * 20 + 3) + 1);
+
+  EXPECT_FALSE (grid.intersect_ray (origin, dir, 4, tri, t));
+
+  double const up [3] = {0, 0, 1};
+  EXPECT_FALSE (grid.intersect_ray (origin, up, 100, tri, t));
+}
+
+TEST (triangleGrid, zeroDirectionReportsNoHit)
+{
+  vector<double> coords;
+  vector<size_t> tris;
+  createPlane (20, coords, tris);
+  stl_reader::TriangleGrid <vector<double>, vector<size_t> > const grid (coords, tris);
+
+  double const origin [3] = {3.25, 7.75, 0};
+  double const zero [3] = {0, 0, 0};
+  size_t tri = 0;
+  double t = 0;
+  EXPECT_FALSE (grid.intersect_ray (origin, zero, std::numeric_limits<double>::infinity (), tri, t));
+}
+
+TEST (triangleGrid, rayFindsClosestHit)
+{
+  stl_reader::StlMesh <double, size_t> mesh ("data/binary_sphere.stl");
+  auto const grid = mesh.triangle_grid (0.25);
+
+  std::mt19937 gen (5);
+  std::normal_distribution<double> dist;
+  for (int iray = 0; iray < 100; ++iray)
+  {
+    double origin [3], dir [3];
+    for (int d = 0; d < 3; ++d)
+    {
+      origin [d] = 3 * dist (gen);
+      dir [d] = dist (gen);
+    }
+
+    bool expectedHit = false;
+    double expectedT = 1000;
+    for (size_t itri = 0; itri < mesh.num_tris (); ++itri)
+    {
+      double c [3][3];
+      for (int i = 0; i < 3; ++i)
+        for (int d = 0; d < 3; ++d)
+          c [i][d] = mesh.tri_corner_coords (itri, i) [d];
+      double t;
+      if (stl_reader::stl_reader_impl::RayTriIntersect (origin, dir, c, t) && t >= 0 && t < expectedT)
+      {
+        expectedT = t;
+        expectedHit = true;
+      }
+    }
+
+    size_t tri;
+    double t;
+    ASSERT_EQ (grid.intersect_ray (origin, dir, 1000, tri, t), expectedHit);
+    if (expectedHit)
+    {
+      EXPECT_NEAR (t, expectedT, 1e-12);
+    }
+  }
+}
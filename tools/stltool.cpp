@@ -0,0 +1,535 @@
+// Command line tool to inspect, convert, weld and benchmark stl files.
+//
+// usage:
+//   stltool info FILE
+//   stltool convert IN OUT [--ascii | --binary | --image]
+//   stltool weld IN OUT [--tolerance T] [--ascii | --binary]
+//   stltool bench FILE [--repeat N]
+//   stltool thumbnail IN OUT.ppm [--size N]
+//
+// All commands accept --threads N, which limits the number of threads used
+// to validate meshes and to render thumbnails (0, the default, uses all
+// hardware threads).
+//
+// Files are read with ReadStlFile, i.e., equal corners are identified and
+// degenerate triangles are removed. Output files are written in binary
+// format unless --ascii is specified. Solid names are not preserved.
+// 'convert --image' writes a relocatable mesh image instead, as written by
+// StlMesh::write_image, which can be attached with StlMeshView after loading
+// or mapping the file.
+
+#define STL_READER_TRACE
+#include "../stl_reader.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+  struct Mesh
+  {
+    std::vector<float> coords, normals;
+    std::vector<unsigned int> tris, solids;
+
+    size_t numVrts () const {return coords.size () / 3;}
+    size_t numTris () const {return tris.size () / 3;}
+    size_t numSolids () const {return solids.empty () ? 0 : solids.size () - 1;}
+  };
+
+  struct Options
+  {
+    std::vector<std::string> args;
+    unsigned int numThreads = 0;
+    double tolerance = 0;
+    int numRepeats = 10;
+    size_t thumbnailSize = 128;
+    bool ascii = false;
+    bool image = false;
+  };
+
+  // phases recorded by the readers, in the order in which they run
+  char const* const loadPhases [] = {"detect", "open", "chunk read", "parse", "weld", "reindex"};
+
+  double seconds (std::chrono::steady_clock::duration d)
+  {
+    return std::chrono::duration<double> (d).count ();
+  }
+
+  size_t fileSize (char const* filename)
+  {
+    std::ifstream in (filename, std::ios::binary | std::ios::ate);
+    return in ? static_cast<size_t> (in.tellg ()) : 0;
+  }
+
+  void readMesh (char const* filename, Mesh& mesh, stl_reader::StlReadInfo* info = nullptr)
+  {
+    stl_reader::ReadStlFile (filename, mesh.coords, mesh.normals, mesh.tris, mesh.solids, info);
+  }
+
+  void writeBinary (char const* filename, Mesh const& mesh)
+  {
+    std::ofstream out (filename, std::ios::binary);
+    if (!out)
+      throw std::runtime_error (std::string ("Couldn't open file ") + filename);
+
+    char header [80] = {0};
+    std::strncpy (header, "binary stl written by stltool", sizeof (header) - 1);
+    out.write (header, 80);
+    std::uint32_t const numTris = static_cast<std::uint32_t> (mesh.numTris ());
+    out.write (reinterpret_cast<char const*> (&numTris), 4);
+
+    char record [50] = {0};
+    for (size_t itri = 0; itri < mesh.numTris (); ++itri)
+    {
+      std::memcpy (record, &mesh.normals [3 * itri], 12);
+      for (size_t i = 0; i < 3; ++i)
+        std::memcpy (record + 12 * (i + 1), &mesh.coords [3 * mesh.tris [3 * itri + i]], 12);
+      out.write (record, 50);
+    }
+    if (!out)
+      throw std::runtime_error (std::string ("Error while writing ") + filename);
+  }
+
+  void writeAscii (char const* filename, Mesh const& mesh)
+  {
+    std::ofstream out (filename);
+    if (!out)
+      throw std::runtime_error (std::string ("Couldn't open file ") + filename);
+
+    // 9 significant digits restore each float exactly
+    out.precision (9);
+    for (size_t isolid = 0; isolid < mesh.numSolids (); ++isolid)
+    {
+      out << "solid solid" << isolid << "\n";
+      for (size_t itri = mesh.solids [isolid]; itri < mesh.solids [isolid + 1]; ++itri)
+      {
+        float const* n = &mesh.normals [3 * itri];
+        out << "  facet normal " << n [0] << " " << n [1] << " " << n [2] << "\n    outer loop\n";
+        for (size_t i = 0; i < 3; ++i)
+        {
+          float const* c = &mesh.coords [3 * mesh.tris [3 * itri + i]];
+          out << "      vertex " << c [0] << " " << c [1] << " " << c [2] << "\n";
+        }
+        out << "    endloop\n  endfacet\n";
+      }
+      out << "endsolid solid" << isolid << "\n";
+    }
+    if (!out)
+      throw std::runtime_error (std::string ("Error while writing ") + filename);
+  }
+
+  void writeMesh (char const* filename, Mesh const& mesh, bool ascii)
+  {
+    if (ascii)
+      writeAscii (filename, mesh);
+    else
+      writeBinary (filename, mesh);
+  }
+
+  // writes the image of 'mesh' as returned by StlMesh::write_image to 'filename'
+  template <class TMesh>
+  void writeImage (char const* filename, TMesh const& mesh)
+  {
+    size_t const alignment = stl_reader::StlMeshImageHeader::ALIGNMENT;
+    size_t const size = mesh.image_size ();
+    std::vector<char> buffer (size + alignment);
+    char* image = buffer.data () + (alignment - reinterpret_cast<std::uintptr_t> (buffer.data ()) % alignment) % alignment;
+    mesh.write_image (image, size);
+
+    std::ofstream out (filename, std::ios::binary);
+    if (!out)
+      throw std::runtime_error (std::string ("Couldn't open file ") + filename);
+    out.write (image, size);
+    if (!out)
+      throw std::runtime_error (std::string ("Error while writing ") + filename);
+  }
+
+  size_t findRoot (std::vector<size_t>& parent, size_t i)
+  {
+    while (parent [i] != i)
+      i = parent [i] = parent [parent [i]];
+    return i;
+  }
+
+  // a vertex and the grid cell which contains it
+  struct CellEntry
+  {
+    double cell [3];
+    size_t vrt;
+
+    bool operator < (CellEntry const& e) const
+    {
+      return std::lexicographical_compare (cell, cell + 3, e.cell, e.cell + 3) ||
+             (std::equal (cell, cell + 3, e.cell) && vrt < e.vrt);
+    }
+  };
+
+  // Merges vertices whose coordinates differ by at most 'tolerance' in each
+  // direction, transitively. Each group of merged vertices takes the
+  // coordinates of its vertex with the lowest index. Triangles which lose a
+  // corner are removed. Returns the number of merged vertices.
+  //
+  // Vertices are sorted by the cells of a grid with cell size 'tolerance', so
+  // that each vertex is only compared with the vertices of the 27 cells around
+  // it.
+  size_t weldVertices (Mesh& mesh, double tolerance)
+  {
+    size_t const numVrts = mesh.numVrts ();
+    double const cellSize = tolerance > 0 ? tolerance : 1;
+    std::vector<CellEntry> entries (numVrts);
+    for (size_t i = 0; i < numVrts; ++i)
+    {
+      for (size_t d = 0; d < 3; ++d)
+        entries [i].cell [d] = std::floor (mesh.coords [3 * i + d] / cellSize);
+      entries [i].vrt = i;
+    }
+    std::sort (entries.begin (), entries.end ());
+
+    std::vector<size_t> parent (numVrts);
+    std::iota (parent.begin (), parent.end (), size_t (0));
+    for (CellEntry const& e : entries)
+    {
+      float const* a = &mesh.coords [3 * e.vrt];
+      CellEntry key;
+      key.vrt = 0;
+      for (int dz = -1; dz <= 1; ++dz)
+        for (int dy = -1; dy <= 1; ++dy)
+          for (int dx = -1; dx <= 1; ++dx)
+          {
+            key.cell [0] = e.cell [0] + dx;
+            key.cell [1] = e.cell [1] + dy;
+            key.cell [2] = e.cell [2] + dz;
+            for (auto it = std::lower_bound (entries.begin (), entries.end (), key);
+                 it != entries.end () && std::equal (key.cell, key.cell + 3, it->cell); ++it)
+            {
+              // each pair is compared once, from its vertex with the lower index
+              if (it->vrt <= e.vrt)
+                continue;
+              float const* b = &mesh.coords [3 * it->vrt];
+              if (std::fabs (b [0] - a [0]) <= tolerance && std::fabs (b [1] - a [1]) <= tolerance &&
+                  std::fabs (b [2] - a [2]) <= tolerance)
+              {
+                size_t const ra = findRoot (parent, e.vrt);
+                size_t const rb = findRoot (parent, it->vrt);
+                parent [std::max (ra, rb)] = std::min (ra, rb);
+              }
+            }
+          }
+    }
+
+    std::vector<unsigned int> newIndex (numVrts);
+    std::vector<float> newCoords;
+    for (size_t i = 0; i < numVrts; ++i)
+    {
+      size_t const root = findRoot (parent, i);
+      if (root == i)
+      {
+        newIndex [i] = static_cast<unsigned int> (newCoords.size () / 3);
+        newCoords.insert (newCoords.end (), &mesh.coords [3 * i], &mesh.coords [3 * i + 3]);
+      }
+      else
+        newIndex [i] = newIndex [root];
+    }
+
+    Mesh welded;
+    welded.coords.swap (newCoords);
+    welded.solids.push_back (0);
+    for (size_t isolid = 0; isolid < mesh.numSolids (); ++isolid)
+    {
+      for (size_t itri = mesh.solids [isolid]; itri < mesh.solids [isolid + 1]; ++itri)
+      {
+        unsigned int const* t = &mesh.tris [3 * itri];
+        unsigned int const c [3] = {newIndex [t [0]], newIndex [t [1]], newIndex [t [2]]};
+        if (c [0] == c [1] || c [0] == c [2] || c [1] == c [2])
+          continue;
+        welded.tris.insert (welded.tris.end (), c, c + 3);
+        welded.normals.insert (welded.normals.end (), &mesh.normals [3 * itri], &mesh.normals [3 * itri + 3]);
+      }
+      welded.solids.push_back (static_cast<unsigned int> (welded.numTris ()));
+    }
+
+    size_t const numMerged = numVrts - welded.numVrts ();
+    std::swap (mesh, welded);
+    return numMerged;
+  }
+
+  void printValidation (Mesh const& mesh, unsigned int numThreads)
+  {
+    std::vector<stl_reader::MeshValidation> reports;
+    stl_reader::ValidateMesh (mesh.tris, mesh.solids, reports, numThreads);
+    for (size_t isolid = 0; isolid < reports.size (); ++isolid)
+    {
+      auto const& r = reports [isolid];
+      if (mesh.solids [isolid] == mesh.solids [isolid + 1])
+      {
+        std::printf ("  solid %zu: empty\n", isolid);
+        continue;
+      }
+      std::printf ("  solid %zu: triangles [%u, %u), %s, %s, %s\n", isolid,
+                   mesh.solids [isolid], mesh.solids [isolid + 1],
+                   r.is_closed () ? "closed" : "open",
+                   r.is_manifold () ? "manifold" : "non-manifold",
+                   r.is_watertight () ? "watertight" : "not watertight");
+    }
+  }
+
+  int info (Options const& options)
+  {
+    if (options.args.size () != 1)
+      throw std::runtime_error ("info expects one file");
+    char const* filename = options.args [0].c_str ();
+
+    stl_reader::TraceSink sink;
+    stl_reader::SetTraceSink (&sink);
+    Mesh mesh;
+    stl_reader::StlReadInfo readInfo;
+    auto const t0 = std::chrono::steady_clock::now ();
+    readMesh (filename, mesh, &readInfo);
+    auto const t1 = std::chrono::steady_clock::now ();
+    stl_reader::SetTraceSink (nullptr);
+
+    std::printf ("file:       %s (%zu bytes)\n", filename, fileSize (filename));
+    std::printf ("format:     %s\n", stl_reader::StlFileHasASCIIFormat (filename) ? "ascii" : "binary");
+    std::printf ("triangles:  %zu\n", mesh.numTris ());
+    std::printf ("vertices:   %zu\n", mesh.numVrts ());
+
+    double lo [3], hi [3];
+    for (int i = 0; i < 3; ++i)
+    {
+      lo [i] = std::numeric_limits<double>::infinity ();
+      hi [i] = -std::numeric_limits<double>::infinity ();
+    }
+    for (size_t i = 0; i < mesh.coords.size (); ++i)
+    {
+      lo [i % 3] = std::min<double> (lo [i % 3], mesh.coords [i]);
+      hi [i % 3] = std::max<double> (hi [i % 3], mesh.coords [i]);
+    }
+    if (mesh.numVrts () > 0)
+      std::printf ("bbox:       (%g, %g, %g) - (%g, %g, %g)\n", lo [0], lo [1], lo [2], hi [0], hi [1], hi [2]);
+
+    std::printf ("hash:       %016llx\n", readInfo.geometryHash);
+    std::printf ("solids:     %zu\n", mesh.numSolids ());
+    printValidation (mesh, options.numThreads);
+
+    std::printf ("load time:  %.3f ms\n", seconds (t1 - t0) * 1e3);
+    for (char const* phase : loadPhases)
+      if (long long const us = sink.total_duration (phase))
+        std::printf ("  %-10s %.3f ms\n", phase, us * 1e-3);
+    return 0;
+  }
+
+  int convert (Options const& options)
+  {
+    if (options.args.size () != 2)
+      throw std::runtime_error ("convert expects an input and an output file");
+    if (options.image)
+    {
+      stl_reader::StlMesh<float, unsigned int> mesh (options.args [0]);
+      writeImage (options.args [1].c_str (), mesh);
+      std::printf ("wrote image of %zu triangles (%zu bytes) to %s\n",
+                   mesh.num_tris (), mesh.image_size (), options.args [1].c_str ());
+      return 0;
+    }
+
+    Mesh mesh;
+    readMesh (options.args [0].c_str (), mesh);
+    writeMesh (options.args [1].c_str (), mesh, options.ascii);
+    std::printf ("wrote %zu triangles to %s\n", mesh.numTris (), options.args [1].c_str ());
+    return 0;
+  }
+
+  int weld (Options const& options)
+  {
+    if (options.args.size () != 2)
+      throw std::runtime_error ("weld expects an input and an output file");
+    Mesh mesh;
+    readMesh (options.args [0].c_str (), mesh);
+    size_t const numTris = mesh.numTris ();
+    size_t const numMerged = weldVertices (mesh, options.tolerance);
+    writeMesh (options.args [1].c_str (), mesh, options.ascii);
+
+    std::printf ("merged %zu vertices, removed %zu triangles, wrote %zu triangles to %s\n",
+                 numMerged, numTris - mesh.numTris (), mesh.numTris (), options.args [1].c_str ());
+    printValidation (mesh, options.numThreads);
+    return 0;
+  }
+
+  int bench (Options const& options)
+  {
+    if (options.args.size () != 1)
+      throw std::runtime_error ("bench expects one file");
+    char const* filename = options.args [0].c_str ();
+
+    stl_reader::TraceSink sink;
+    stl_reader::SetTraceSink (&sink);
+    std::vector<double> times;
+    size_t numTris = 0;
+    for (int i = 0; i < options.numRepeats; ++i)
+    {
+      Mesh mesh;
+      auto const t0 = std::chrono::steady_clock::now ();
+      readMesh (filename, mesh);
+      times.push_back (seconds (std::chrono::steady_clock::now () - t0));
+      numTris = mesh.numTris ();
+    }
+    stl_reader::SetTraceSink (nullptr);
+
+    std::sort (times.begin (), times.end ());
+    double const mean = std::accumulate (times.begin (), times.end (), 0.) / times.size ();
+    double variance = 0;
+    for (double t : times)
+      variance += (t - mean) * (t - mean);
+    double const stddev = std::sqrt (variance / times.size ());
+    double const median = times [times.size () / 2];
+
+    std::printf ("%d loads of %s (%zu triangles)\n", options.numRepeats, filename, numTris);
+    std::printf ("  min %.3f ms, median %.3f ms, mean %.3f ms, max %.3f ms, stddev %.3f ms\n",
+                 times.front () * 1e3, median * 1e3, mean * 1e3, times.back () * 1e3, stddev * 1e3);
+    std::printf ("  %.1f MB/s, %.2f Mtris/s (median)\n",
+                 fileSize (filename) / median * 1e-6, numTris / median * 1e-6);
+    for (char const* phase : loadPhases)
+      if (long long const us = sink.total_duration (phase))
+        std::printf ("  %-10s %.3f ms per load\n", phase, us * 1e-3 / options.numRepeats);
+    return 0;
+  }
+
+  int thumbnail (Options const& options)
+  {
+    if (options.args.size () != 2)
+      throw std::runtime_error ("thumbnail expects an input and an output file");
+    char const* filename = options.args [1].c_str ();
+
+    Mesh mesh;
+    auto const t0 = std::chrono::steady_clock::now ();
+    readMesh (options.args [0].c_str (), mesh);
+    auto const t1 = std::chrono::steady_clock::now ();
+    stl_reader::ThumbnailOptions thumbnailOptions;
+    thumbnailOptions.width = thumbnailOptions.height = options.thumbnailSize;
+    stl_reader::Thumbnail image;
+    stl_reader::RenderThumbnail (mesh.coords, mesh.tris, thumbnailOptions, image, options.numThreads);
+    auto const t2 = std::chrono::steady_clock::now ();
+
+    std::ofstream out (filename, std::ios::binary);
+    out << "P6\n" << image.width << " " << image.height << "\n255\n";
+    out.write (reinterpret_cast<char const*> (image.rgb.data ()), image.rgb.size ());
+    if (!out)
+      throw std::runtime_error (std::string ("could not write ") + filename);
+
+    std::printf ("wrote %zux%zu thumbnail of %zu triangles to %s\n",
+                 image.width, image.height, mesh.numTris (), filename);
+    std::printf ("load time:    %.3f ms\n", seconds (t1 - t0) * 1e3);
+    std::printf ("render time:  %.3f ms\n", seconds (t2 - t1) * 1e3);
+    return 0;
+  }
+
+  // parses a non-negative number and throws if 'str' holds anything else
+  double parseNumber (std::string const& option, char const* str)
+  {
+    char* end = nullptr;
+    double const value = std::strtod (str, &end);
+    if (end == str || *end != '\0' || !(value >= 0) || std::isinf (value))
+      throw std::invalid_argument ("invalid value for " + option + ": " + str);
+    return value;
+  }
+
+  // parses a non-negative integer and throws if 'str' holds anything else
+  unsigned long parseCount (std::string const& option, char const* str)
+  {
+    char* end = nullptr;
+    errno = 0;
+    unsigned long const value = std::strtoul (str, &end, 10);
+    if (!std::isdigit (static_cast<unsigned char> (str [0])) || *end != '\0' || errno == ERANGE)
+      throw std::invalid_argument ("invalid value for " + option + ": " + str);
+    return value;
+  }
+
+  void printUsage (char const* program)
+  {
+    std::fprintf (stderr,
+                  "usage: %s info FILE\n"
+                  "       %s convert IN OUT [--ascii | --binary | --image]\n"
+                  "       %s weld IN OUT [--tolerance T] [--ascii | --binary]\n"
+                  "       %s bench FILE [--repeat N]\n"
+                  "       %s thumbnail IN OUT.ppm [--size N]\n"
+                  "options: --threads N   threads used for validation and rendering (0: all hardware threads)\n",
+                  program, program, program, program, program);
+  }
+}
+
+int main (int argc, char** argv)
+{
+  if (argc < 2)
+  {
+    printUsage (argv [0]);
+    return 1;
+  }
+
+  std::string const command = argv [1];
+  Options options;
+  try
+  {
+    for (int i = 2; i < argc; ++i)
+    {
+      std::string const arg = argv [i];
+      if (arg == "--threads" && i + 1 < argc)
+        options.numThreads = static_cast<unsigned int> (parseCount (arg, argv [++i]));
+      else if (arg == "--tolerance" && i + 1 < argc)
+        options.tolerance = parseNumber (arg, argv [++i]);
+      else if (arg == "--repeat" && i + 1 < argc)
+        options.numRepeats = static_cast<int> (std::max (1ul, std::min<unsigned long> (parseCount (arg, argv [++i]), std::numeric_limits<int>::max ())));
+      else if (arg == "--size" && i + 1 < argc)
+        options.thumbnailSize = std::max (1ul, parseCount (arg, argv [++i]));
+      else if (arg == "--ascii")
+        options.ascii = true;
+      else if (arg == "--binary")
+        options.ascii = false;
+      else if (arg == "--image")
+        options.image = true;
+      else if (arg.compare (0, 2, "--") == 0)
+        throw std::invalid_argument ("unknown option " + arg);
+      else
+        options.args.push_back (arg);
+    }
+  }
+  catch (std::invalid_argument& e)
+  {
+    std::fprintf (stderr, "%s\n", e.what ());
+    printUsage (argv [0]);
+    return 1;
+  }
+
+  try
+  {
+    if (command == "info")
+      return info (options);
+    if (command == "convert")
+      return convert (options);
+    if (command == "weld")
+      return weld (options);
+    if (command == "bench")
+      return bench (options);
+    if (command == "thumbnail")
+      return thumbnail (options);
+  }
+  catch (std::exception& e)
+  {
+    std::fprintf (stderr, "%s\n", e.what ());
+    return 1;
+  }
+
+  printUsage (argv [0]);
+  return 1;
+}